@@ -10,7 +10,7 @@ namespace robosub
 	private:
 		static const int BUFFER_LENGTH = 7;
 
-		double _freqBuffer[BUFFER_LENGTH]; //list of time deltas
+		double _freqBuffer[BUFFER_LENGTH]; //list of time deltas (microseconds)
 		long long _currentSum = 0; //sum of time deltas
 		long long _prevTime = 0;
 		int _bufferPos = 0;
@@ -0,0 +1,173 @@
+#pragma once
+
+#include "common.h"
+#include "timeutil.h"
+#include "framesource.h"
+#include <opencv2/opencv.hpp>
+#include <cstdint>
+#include <mutex>
+
+namespace robosub {
+    ///Frame log file layout (all integers little-endian, as written by the host):
+    ///  FileHeader
+    ///  FrameHeader + payload (padded to 16 bytes), repeated for every frame
+    ///  IndexEntry for every frame, in the order written
+    ///  Footer
+    ///A log that was never closed has no index; the reader rebuilds it by scanning the frames.
+    namespace framelog {
+        enum Format : uint32_t {
+            ///Pixels exactly as in memory, rows packed
+            RAW = 0,
+            ///JPEG-compressed image
+            JPEG = 1
+        };
+
+        struct FileHeader {
+            char magic[8];
+            uint32_t version;
+            uint32_t headerSize;
+            uint64_t reserved[2];
+        };
+
+        struct FrameHeader {
+            uint32_t magic;
+            uint32_t streamId;
+            ///Monotonic capture time in microseconds (Time::micros())
+            int64_t timestamp;
+            uint32_t format;
+            int32_t rows;
+            int32_t cols;
+            int32_t type;
+            uint64_t payloadSize;
+            uint64_t reserved;
+        };
+
+        struct IndexEntry {
+            int64_t timestamp;
+            uint64_t offset;
+            uint32_t streamId;
+            uint32_t format;
+        };
+
+        struct Footer {
+            uint64_t indexOffset;
+            uint64_t count;
+            char magic[8];
+        };
+    }
+
+    ///Append-only writer for frame logs
+    class FrameLogWriter {
+    private:
+        int fd = -1;
+        uint64_t offset = 0;
+        vector<framelog::IndexEntry> index;
+        vector<uchar> encodeBuffer;
+        std::mutex lock;
+
+        bool writeAll(const void *data, size_t length);
+
+    public:
+        FrameLogWriter();
+        ~FrameLogWriter();
+
+        FrameLogWriter(const FrameLogWriter &) = delete;
+        FrameLogWriter &operator=(const FrameLogWriter &) = delete;
+
+        ///Create (or truncate) a log file
+        ///preallocateBytes reserves disk space up front with fallocate (0 to disable)
+        bool open(const string &path, long long preallocateBytes = 0);
+        bool isOpen();
+
+        ///Append a frame. Timestamps are in microseconds (Time::micros()); -1 stamps the current time.
+        bool write(uint32_t streamId, const Mat &frame, long long timestamp = -1,
+                   framelog::Format format = framelog::RAW, int jpegQuality = 90);
+
+        ///Number of frames written so far
+        size_t count();
+
+        ///Write the index and close the file
+        bool close();
+    };
+
+    ///Memory-mapped, read-only access to a frame log
+    class FrameLogReader {
+    private:
+        int fd = -1;
+        const uchar *map = nullptr;
+        size_t mapSize = 0;
+
+        //entries sorted by timestamp
+        vector<framelog::IndexEntry> index;
+        //bucket b holds the first index entry at or after firstTimestamp + b * bucketWidth
+        vector<uint32_t> buckets;
+        long long bucketWidth = 1;
+
+        bool loadIndex();
+        void scanIndex();
+        void buildBuckets();
+        const framelog::FrameHeader *header(size_t i);
+
+    public:
+        FrameLogReader();
+        ~FrameLogReader();
+
+        FrameLogReader(const FrameLogReader &) = delete;
+        FrameLogReader &operator=(const FrameLogReader &) = delete;
+
+        bool open(const string &path);
+        bool isOpen();
+        void close();
+
+        ///Number of frames in the log
+        size_t size();
+        ///Index entry of frame i, in timestamp order
+        const framelog::IndexEntry &entry(size_t i);
+        ///Stream ids present in the log
+        vector<uint32_t> streams();
+
+        long long firstTimestamp();
+        long long lastTimestamp();
+
+        ///Find the last frame at or before a timestamp (or the first frame, if the timestamp is earlier)
+        ///Runs in constant time for logs with roughly even frame spacing.
+        ///If streamId is not -1, only frames of that stream are considered. Returns -1 if there are none.
+        long seek(long long timestamp, int streamId = -1);
+
+        ///Decode frame i into img (copies RAW frames)
+        bool read(size_t i, Mat &img);
+        ///Zero-copy view of a RAW frame inside the mapped file
+        ///The data is read-only and only valid while the reader is open.
+        bool view(size_t i, Mat &img);
+    };
+
+    ///Replays one stream of a frame log with its original timing
+    class FrameLogFrameSource : public ReplayFrameSource {
+    private:
+        FrameLogReader reader;
+        uint32_t stream = 0;
+        //log entries of the selected stream, in timestamp order
+        vector<size_t> frames;
+        long long duration = 0;
+        Size size;
+
+    protected:
+        bool loadFrame(long index, Mat &img) override;
+        long frameCount() override;
+        long long frameTimeMicros(long index) override;
+        long long durationMicros() override;
+
+    public:
+        ///Open a log and replay one of its streams (-1 selects the first stream in the file)
+        EXPORT FrameLogFrameSource(const string &path, int streamId = -1, Playback playback = REALTIME,
+                                   bool loop = true);
+
+        EXPORT bool isOpen() override;
+        EXPORT Size getFrameSize() override;
+
+        ///Capture timestamp (microseconds) of the most recently grabbed frame
+        EXPORT long long getTimestamp();
+        ///Jump to the frame that was current at a given capture timestamp
+        EXPORT bool seekTimestamp(long long timestamp);
+    };
+}
@@ -0,0 +1,231 @@
+#pragma once
+
+#include "common.h"
+#include "timeutil.h"
+#include <opencv2/opencv.hpp>
+
+namespace robosub {
+    ///Backend that produces frames for a Camera
+    class FrameSource {
+    public:
+        virtual ~FrameSource() {}
+
+        ///Check if the source is open
+        virtual bool isOpen() = 0;
+        ///Advance to the next frame without decoding it
+        virtual bool grab() = 0;
+        ///Decode the most recently grabbed frame (BGR)
+        virtual bool retrieve(Mat &img) = 0;
+
+        ///Nominal frame rate of the source
+        virtual double getFrameRate() = 0;
+        ///Get frame size
+        virtual Size getFrameSize() = 0;
+        ///Attempt to set frame size. Returns actual size set.
+        virtual Size setFrameSize(Size size) { return getFrameSize(); }
+        ///Index of the most recently grabbed frame
+        virtual long getPositionFrame() = 0;
+        ///Position of the most recently grabbed frame in seconds
+        virtual double getPositionSeconds() = 0;
+        ///Number of frames, or 0 if unknown or unbounded
+        virtual long getFrameCount() = 0;
+        ///Returns true if frames arrive in real time from a device or network stream
+        virtual bool isLiveStream() = 0;
+    };
+
+    ///Live camera, video file or IP stream read through cv::VideoCapture
+    class CaptureFrameSource : public FrameSource {
+    private:
+        VideoCapture cap;
+        bool liveStream = false;
+
+        void testLiveStream();
+
+    public:
+        ///Open a live camera by index. Index 0 is the primary camera, 1 is secondary, etc.
+        EXPORT explicit CaptureFrameSource(int index);
+        ///Open a recorded file, device path or IP camera
+        EXPORT explicit CaptureFrameSource(const string &file);
+
+        EXPORT bool isOpen() override;
+        EXPORT bool grab() override;
+        EXPORT bool retrieve(Mat &img) override;
+        EXPORT double getFrameRate() override;
+        EXPORT Size getFrameSize() override;
+        EXPORT Size setFrameSize(Size size) override;
+        EXPORT long getPositionFrame() override;
+        EXPORT double getPositionSeconds() override;
+        EXPORT long getFrameCount() override;
+        EXPORT bool isLiveStream() override;
+    };
+
+    ///Plays back a finite list of frames at a fixed rate, or at the rate reported by frameTimeMicros()
+    ///Subclasses only need to know how to load frame n.
+    class ReplayFrameSource : public FrameSource {
+    public:
+        enum Playback {
+            ///Pace frames at the source frame rate and skip frames when the consumer falls behind, like a camera
+            REALTIME,
+            ///Deliver every frame as soon as it is requested
+            AS_FAST_AS_POSSIBLE
+        };
+
+    private:
+        vector<Mat> preloaded;
+        long long startNanos = 0;
+        long long tick = -1;
+        double speed = 1.0;
+
+        long available();
+        long long tickTimeMicros(long long tick);
+
+    protected:
+        Playback playback;
+        bool loop;
+        double frameRate;
+        long position = -1;
+
+        ///Load frame n (0 <= n < frameCount()) into img
+        virtual bool loadFrame(long index, Mat &img) = 0;
+        ///Total number of frames available to loadFrame
+        virtual long frameCount() = 0;
+        ///Presentation time of frame n relative to the first frame, in microseconds
+        ///Defaults to a fixed rate of frameRate.
+        virtual long long frameTimeMicros(long index);
+        ///Length of one pass through the frames, in microseconds
+        virtual long long durationMicros();
+
+        ///Decode every frame into memory so that playback never touches the disk
+        void preload();
+
+    public:
+        EXPORT ReplayFrameSource(double frameRate, Playback playback, bool loop);
+
+        ///Restart playback from the first frame
+        EXPORT void rewind();
+        ///Returns true once a non-looping source has delivered its last frame
+        EXPORT bool isFinished();
+        ///Scale REALTIME playback, e.g. 2.0 plays twice as fast as recorded
+        EXPORT void setSpeed(double speed);
+        ///Make frame n the next frame delivered by grab()
+        EXPORT bool seek(long index);
+
+        EXPORT bool grab() override;
+        EXPORT bool retrieve(Mat &img) override;
+        EXPORT double getFrameRate() override;
+        EXPORT Size getFrameSize() override;
+        EXPORT long getPositionFrame() override;
+        EXPORT double getPositionSeconds() override;
+        EXPORT long getFrameCount() override;
+        EXPORT bool isLiveStream() override;
+    };
+
+    ///Replays a video file with accurate timing, optionally preloaded into RAM
+    class FileReplayFrameSource : public ReplayFrameSource {
+    private:
+        VideoCapture cap;
+        long count = 0;
+        long nextDecoded = 0;
+        Size size;
+
+    protected:
+        bool loadFrame(long index, Mat &img) override;
+        long frameCount() override;
+
+    public:
+        ///Open a video file
+        ///If preloadFrames is set, every frame is decoded at construction (mind the memory footprint)
+        EXPORT FileReplayFrameSource(const string &file, Playback playback = REALTIME, bool loop = true,
+                                     bool preloadFrames = true);
+
+        EXPORT bool isOpen() override;
+        EXPORT Size getFrameSize() override;
+    };
+
+    ///Replays a sorted sequence of still images, e.g. "samples/*.png"
+    class ImageSequenceFrameSource : public ReplayFrameSource {
+    private:
+        vector<String> files;
+
+    protected:
+        bool loadFrame(long index, Mat &img) override;
+        long frameCount() override;
+
+    public:
+        EXPORT ImageSequenceFrameSource(const string &pattern, double frameRate = 30.0,
+                                        Playback playback = REALTIME, bool loop = true, bool preloadFrames = true);
+
+        EXPORT bool isOpen() override;
+    };
+
+    ///Procedurally rendered test frames: dark shapes drifting over a noisy, water-colored background
+    ///Frame n only depends on the seed and n, so runs are reproducible on any machine.
+    class SyntheticFrameSource : public ReplayFrameSource {
+    public:
+        enum ShapeType {
+            TRIANGLE,
+            SQUARE,
+            RECTANGLE,
+            CIRCLE
+        };
+
+        ///Ground truth for one rendered shape
+        struct Shape {
+            ShapeType type;
+            Point2d center;
+            double size;
+            double angle;
+        };
+
+        struct Settings {
+            Size frameSize = Size(1280, 720);
+            double frameRate = 30.0;
+            ///Number of frames before looping, or 0 for an endless stream
+            long frameCount = 0;
+            int shapeCount = 6;
+            ///Standard deviation of the per-pixel sensor noise
+            double noise = 6.0;
+            ///Maximum shape motion in pixels per frame
+            double maxSpeed = 4.0;
+            Scalar waterTop = Scalar(150, 125, 40);
+            Scalar waterBottom = Scalar(95, 80, 25);
+            Scalar shapeColor = Scalar(20, 20, 20);
+            unsigned long long seed = 0x5eed;
+        };
+
+    private:
+        static const int NOISE_FRAMES = 8;
+
+        struct Motion {
+            Shape start;
+            Point2d velocity;
+            double spin;
+        };
+
+        Settings settings;
+        vector<Motion> motion;
+        vector<Shape> shapes;
+        Mat background;
+        Mat noise[NOISE_FRAMES];
+
+        void prepare();
+        void render(long index, Mat &img);
+
+    protected:
+        bool loadFrame(long index, Mat &img) override;
+        long frameCount() override;
+
+    public:
+        EXPORT SyntheticFrameSource();
+        EXPORT explicit SyntheticFrameSource(Settings settings, Playback playback = AS_FAST_AS_POSSIBLE);
+
+        EXPORT bool isOpen() override;
+        EXPORT Size getFrameSize() override;
+        EXPORT Size setFrameSize(Size size) override;
+
+        ///Shapes drawn in the most recently retrieved frame
+        EXPORT const vector<Shape> &getShapes();
+        ///Count of rendered shapes of a given type in the most recently retrieved frame
+        EXPORT int countShapes(ShapeType type);
+    };
+}
@@ -0,0 +1,88 @@
+#pragma once
+
+#include "common.h"
+#include "image.h"
+#include <opencv2/opencv.hpp>
+#include <map>
+#include <vector>
+
+namespace robosub {
+    ///Layer of text labels drawn over video frames
+    ///Each label is rasterized into a small BGRA image that is only rebuilt when its text changes. Rebuilding
+    ///copies cached glyph rasters instead of calling putText, so labels with changing numbers stay cheap.
+    ///Drawing blends just the label rectangles onto the frame. Not thread safe.
+    class HudOverlay {
+    public:
+        struct Style {
+            ///BGR text color
+            Scalar color = Scalar(255, 255, 255);
+            double scale = 0.5;
+            int thickness = 1;
+            int font = FONT_HERSHEY_SIMPLEX;
+        };
+
+    private:
+        struct Glyph {
+            ///Coverage of the glyph, with its origin at (padding, padding + ascent)
+            Mat alpha;
+            int advance;
+        };
+
+        struct Font {
+            Style style;
+            int ascent, descent, padding;
+            std::map<char, Glyph> glyphs;
+        };
+
+        struct Label {
+            Point origin;
+            Drawing::Anchor anchor;
+            int font;
+            String text;
+            bool visible = true;
+            ///BGRA raster of the text
+            Mat raster;
+            ///Position of the text origin inside the raster
+            Point rasterOrigin;
+        };
+
+        //room for strokes that reach outside the advance of a glyph, added to the stroke thickness
+        static const int GLYPH_PADDING = 2;
+
+        vector<Font> fonts;
+        vector<Label> labels;
+        Mat alphaScratch;
+
+        int findFont(const Style &style);
+
+        const Glyph &getGlyph(Font &font, char c);
+
+        void rasterize(Label &label);
+
+        Point getRasterLocation(const Label &label, Size frameSize);
+
+    public:
+        ///Add a label and return its index
+        ///The origin is the left end of the text baseline, as in putText. With Anchor::BOTTOM_LEFT the
+        ///origin's y is measured up from the bottom of the frame instead.
+        EXPORT int addLabel(Point origin, Drawing::Anchor anchor, Style style);
+
+        ///Add a label with the default style
+        EXPORT int addLabel(Point origin, Drawing::Anchor anchor = Drawing::TOP_LEFT);
+
+        EXPORT int getLabelCount();
+
+        ///Change a label's text; the label is only rasterized again if the text differs
+        EXPORT void setText(int label, const String &text);
+
+        EXPORT void setVisible(int label, bool visible);
+
+        EXPORT void setOrigin(int label, Point origin);
+
+        ///Area of the frame covered by a label
+        EXPORT Rect getBounds(int label, Size frameSize);
+
+        ///Blend every visible label onto a 3 or 4 channel frame
+        EXPORT void draw(Mat &frame);
+    };
+}
@@ -0,0 +1,99 @@
+#ifndef LIBROBOSUB_COLOR_SEGMENTATION_H
+#define LIBROBOSUB_COLOR_SEGMENTATION_H
+
+#include "../common.h"
+#include <opencv2/opencv.hpp>
+#include <vector>
+
+namespace robosub {
+    ///Labels every pixel of a BGR frame with one of several named color classes and finds the blobs of each class
+    ///The HSV ranges of all classes are compiled into one quantized BGR lookup table, so a frame is labeled in
+    ///a single pass without converting it to HSV, instead of one cvtColor + inRange pass per color.
+    class ColorSegmenter {
+    public:
+        ///Label of pixels that match no class
+        static const uchar BACKGROUND = 0;
+        ///Bits kept per BGR channel in the lookup table (32 levels, 32768 cells)
+        static const int LUT_BITS = 5;
+
+        struct ColorClass {
+            String name;
+            ///Inclusive OpenCV HSV ranges (hue 0-180); a hue range with low > high wraps around red
+            Scalar hsvLow, hsvHigh;
+        };
+
+        ///One 8-connected blob of a single class
+        struct Component {
+            ///Label of the class, 1 for the first class added
+            int classId;
+            int area;
+            Point2d centroid;
+            Rect bounds;
+        };
+
+    private:
+        struct Run {
+            int row, start, end;
+            uchar classId;
+        };
+
+        struct Accumulator {
+            int area;
+            double sumX, sumY;
+            int minX, minY, maxX, maxY;
+        };
+
+        static const int LUT_SIZE = 1 << (3 * LUT_BITS);
+
+        vector<ColorClass> classes;
+        vector<uchar> lut;
+        bool compiled = false;
+
+        //scratch space of findComponents, reused between frames
+        vector<Run> runs;
+        vector<int> parent;
+        vector<int> rowStart;
+        vector<int> componentIndex;
+        vector<Accumulator> accumulators;
+
+        int findRoot(int run);
+
+        void unite(int a, int b);
+
+    public:
+        ///Blobs smaller than this many pixels are dropped
+        int MIN_AREA = 400;
+
+        EXPORT ColorSegmenter();
+
+        ///Add a class and return its label; earlier classes win where ranges overlap
+        EXPORT int addClass(const String &name, Scalar hsvLow, Scalar hsvHigh);
+
+        EXPORT void clearClasses();
+
+        EXPORT int getClassCount();
+
+        EXPORT const ColorClass &getClass(int classId);
+
+        ///Label of a class by name, or -1 if there is none
+        EXPORT int getClassId(const String &name);
+
+        ///Build the lookup table; called automatically by label() after classes change
+        ///Each cell is classified by the HSV value of its center color.
+        EXPORT void compile();
+
+        ///Class of a single BGR color, as the lookup table sees it
+        EXPORT uchar classify(const Vec3b &bgr);
+
+        ///Write the class of every pixel of a CV_8UC3 BGR frame to labels (CV_8UC1)
+        EXPORT void label(const Mat &bgr, Mat &labels);
+
+        ///Find the blobs of every class in a label image, ordered by class and then by decreasing area
+        EXPORT void findComponents(const Mat &labels, vector<Component> &components);
+
+        ///label() followed by findComponents(); labels is scratch space that can be reused between frames
+        EXPORT void segment(const Mat &bgr, vector<Component> &components, Mat &labels);
+    };
+}
+
+#endif //LIBROBOSUB_COLOR_SEGMENTATION_H
@@ -0,0 +1,53 @@
+#ifndef LIBROBOSUB_FRAME_PYRAMID_H
+#define LIBROBOSUB_FRAME_PYRAMID_H
+
+#include "../common.h"
+#include <opencv2/opencv.hpp>
+#include <mutex>
+
+namespace robosub {
+    ///Gaussian pyramid of one captured frame, built lazily and shared by every stage that needs a smaller copy
+    ///Level 0 is the frame itself and level i + 1 is pyrDown of level i. A level is computed the first time
+    ///any stage asks for it and reused after that, so each scale costs one pyrDown per frame however many
+    ///stages read it. Returned levels are read-only views that stay valid until the next reset().
+    class FramePyramid {
+    public:
+        ///Levels past this are never built
+        static const int MAX_LEVELS = 8;
+
+    private:
+        Mat levels[MAX_LEVELS];
+        int built = 0;
+        //levels are added under the lock, so stages on other threads can share the pyramid
+        std::mutex lock;
+
+    public:
+        EXPORT FramePyramid();
+
+        ///Start a pyramid over frame; level 0 shares its data, nothing else is computed yet
+        EXPORT explicit FramePyramid(const Mat &frame);
+
+        ///Move to a new frame, reusing the buffers of the previous levels
+        ///Views handed out for the previous frame may be overwritten.
+        EXPORT void reset(const Mat &frame);
+
+        ///Level i, building it and any missing levels above it first
+        EXPORT const Mat &level(int i);
+
+        ///Largest level no wider than maxWidth (level 0 if the frame already is)
+        EXPORT const Mat &levelAtMost(int maxWidth);
+
+        ///Index of the level with exactly this size, or -1; computed from the sizes, nothing is built
+        EXPORT int findLevel(Size size);
+
+        ///Size of level i as pyrDown produces it, without building it
+        EXPORT Size levelSize(int i);
+
+        ///Number of levels computed so far for this frame, including level 0
+        EXPORT int getBuiltLevels();
+
+        EXPORT bool empty();
+    };
+}
+
+#endif //LIBROBOSUB_FRAME_PYRAMID_H
@@ -0,0 +1,90 @@
+#ifndef LIBROBOSUB_FRAME_QUALITY_H
+#define LIBROBOSUB_FRAME_QUALITY_H
+
+#include "../common.h"
+#include "frame_pyramid.h"
+#include <opencv2/opencv.hpp>
+
+namespace robosub {
+    ///Cheap per-frame image quality metrics, computed on a small pyramid level
+    ///Meant to run on every frame of every camera so later stages can skip frames that are blurred,
+    ///badly exposed or washed out by murky water.
+    class FrameQualityMonitor {
+    public:
+        enum Problem {
+            BLURRY = 1,
+            UNDEREXPOSED = 2,
+            OVEREXPOSED = 4,
+            LOW_CONTRAST = 8,
+            TURBID = 16
+        };
+
+        struct Settings {
+            ///Frames are halved with pyrDown until they are at most this wide
+            int analysisWidth = 320;
+            ///Minimum variance of the Laplacian of the analyzed luma
+            double minFocus = 10;
+            ///Allowed range of the median luma
+            int minMedian = 25;
+            int maxMedian = 225;
+            ///Largest fraction of pixels that may be clipped to black (<= 5) or white (>= 250)
+            double maxClipped = 0.3;
+            ///Minimum spread between the 5th and 95th luma percentiles
+            int minContrast = 20;
+            ///Largest allowed turbidity (see Metrics::turbidity)
+            double maxTurbidity = 0.75;
+        };
+
+        struct Metrics {
+            ///Variance of the 4-neighbor Laplacian of the analyzed luma; higher is sharper
+            double focus = 0;
+            double meanLuma = 0;
+            ///Luma percentiles
+            int p5 = 0, p50 = 0, p95 = 0;
+            ///p95 - p5
+            int contrast = 0;
+            double darkFraction = 0, brightFraction = 0;
+            ///Mean of the darkest channel over mean of the brightest channel, 0 to 1
+            ///Scattering in murky water lifts every channel towards the same gray, pushing this towards 1.
+            ///Always 0 for grayscale frames.
+            double turbidity = 0;
+            ///Bitmask of Problem values; 0 when the frame is usable
+            int problems = 0;
+            ///Size of the level that was analyzed
+            Size analysisSize;
+
+            bool usable() const { return problems == 0; }
+        };
+
+    private:
+        Settings settings;
+        Metrics metrics;
+        Mat levels[2];
+        Mat luma;
+
+    public:
+        EXPORT FrameQualityMonitor();
+
+        EXPORT explicit FrameQualityMonitor(Settings settings);
+
+        ///Measure a BGR or grayscale 8-bit frame; the frame is not modified
+        ///A frame that is already small (e.g. a pyramid level) is analyzed without further downsampling.
+        EXPORT Metrics analyze(const Mat &frame);
+
+        ///Measure the largest level of a shared pyramid that fits analysisWidth, building it if needed
+        ///Gives the same metrics as analyze() on the frame itself.
+        EXPORT Metrics analyze(FramePyramid &pyramid);
+
+        ///Metrics of the last analyzed frame
+        EXPORT Metrics getMetrics();
+
+        EXPORT Settings getSettings();
+
+        EXPORT void setSettings(Settings settings);
+
+        ///Names of the problems in a bitmask, comma separated
+        EXPORT static String describe(int problems);
+    };
+}
+
+#endif //LIBROBOSUB_FRAME_QUALITY_H
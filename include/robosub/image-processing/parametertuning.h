@@ -1,11 +1,23 @@
 #ifndef LIBROBOSUB_PARAMETER_TUNING_GENETIC_ALGORITHM_H
 #define LIBROBOSUB_PARAMETER_TUNING_GENETIC_ALGORITHM_H
 
+#include "../threadpool.h"
+#include "tuning_dataset.h"
+#include <cstdio>
+#include <functional>
+#include <memory>
+#include <unordered_map>
+
 using namespace std;
 
 namespace robosub {
     enum TuningMethods {
-        GENETIC_ALGORITHM
+        ///Fixed number of generations bred from the fittest members
+        GENETIC_ALGORITHM,
+        ///Covariance matrix adaptation evolution strategy; runs until the evaluation budget is spent or it converges
+        CMA_ES,
+        ///Random candidates scored on a growing part of the samples, keeping the best third at every step
+        SUCCESSIVE_HALVING
     };
 
     class ParameterMetadata {
@@ -17,56 +29,224 @@ namespace robosub {
         ParameterMetadata(double initValue, double minValue, double maxValue);
     };
 
-    class ParameterTuner {
+    ///Parameter names compiled to indices, so a parameter set can be a plain array of doubles
+    ///Indices follow the name order of the map the schema was built from.
+    class ParameterSchema {
+    private:
+        vector<string> names;
+        vector<ParameterMetadata> metadata;
+        map<string, int> indices;
+
+    public:
+        EXPORT ParameterSchema();
+
+        EXPORT explicit ParameterSchema(const map<string, ParameterMetadata> &parameters);
+
+        EXPORT int size() const;
+
+        ///Index of a parameter, or -1 if the schema has no parameter of that name
+        EXPORT int indexOf(const string &name) const;
+
+        EXPORT const string &getName(int index) const;
+
+        EXPORT const ParameterMetadata &getMetadata(int index) const;
+
+        ///Write the initial value of every parameter to values
+        EXPORT void initialValues(double *values) const;
+
+        EXPORT map<string, double> toMap(const double *values) const;
+
+        ///Copy the named values into values; parameters missing from the map keep their current value
+        EXPORT void fromMap(const map<string, double> &parameters, double *values) const;
+    };
+
+    ///Read-only view of one parameter set, by index or by name
+    ///Converts to map<string, double>, so evaluation functions written for maps keep working.
+    class ParameterSet {
     private:
-        map<string, ParameterMetadata> parameterMetadata;
+        const ParameterSchema *schema;
+        const double *values;
+
+    public:
+        EXPORT ParameterSet(const ParameterSchema &schema, const double *values);
+
+        EXPORT int size() const;
+
+        double operator[](int index) const { return values[index]; }
+
+        ///Throws std::out_of_range for a name that is not in the schema, like map::at
+        EXPORT double at(const string &name) const;
 
-        double (*evaluationFunction)(map<string, double>);
+        EXPORT const double *data() const;
+
+        EXPORT map<string, double> toMap() const;
+
+        operator map<string, double>() const { return toMap(); }
+    };
+
+    class ParameterTuner {
+    public:
+        ///Error of a parameter set, lower is better
+        ///Called from several threads at once, so it must not modify state shared between calls
+        ///(e.g. give every call its own ShapeFinder and copies of the sample images). Functions taking a
+        ///map<string, double> are accepted too; the set is converted for them on every call.
+        typedef std::function<double(const ParameterSet &)> EvaluationFunction;
+
+        ///Error of a parameter set on one of the samples, with the same thread-safety rules
+        ///The error of a set is the sum over the samples, so tuners can estimate it from part of them.
+        typedef std::function<double(const ParameterSet &, int)> SampleEvaluationFunction;
+
+        ///Progress of a run, one point per generation (or per successive halving step)
+        struct TracePoint {
+            int iteration;
+            ///Evaluations spent so far, counting a set scored on part of the samples as that fraction of one
+            double cost;
+            ///Lowest and mean error of the sets scored in this iteration
+            double bestError;
+            double meanError;
+        };
+
+        static const unsigned long long DEFAULT_SEED = 0x5eed;
+
+    private:
+        ParameterSchema schema;
+
+        //a whole-set evaluation function is kept as a sample function with one sample
+        SampleEvaluationFunction sampleFunction;
+        int sampleCount = 1;
+
+        //breeding and mutation draw from one seeded generator on the calling thread, so a seed gives the
+        //same populations whatever the thread count; only the scoring runs on the pool
+        int threadCount;
+        unsigned long long seed;
+        std::unique_ptr<ThreadPool> pool;
+
+        //every member is a row of schema.size() values; the population and the parents it was bred from
+        //are flat blocks that keep their memory from one generation to the next
+        vector<double> population, parents;
+        vector<double> populationErrorLevels, selectionWeights;
+
+        //every parameter set scored in this run, so duplicates and survivors are never scored twice; the
+        //sets are stored back to back in cachedSets and found by the hash of their values, along with the
+        //error summed over the first cachedSampleCounts samples
+        vector<double> cachedSets, cachedErrorSums;
+        vector<int> cachedSampleCounts;
+        unordered_multimap<size_t, int> cacheIndex;
+        //cache slot of every member and the (slot, sample) pairs handed to the pool
+        vector<int> memberSlots;
+        vector<pair<int, int>> sampleTasks;
+        vector<double> sampleErrors;
+        int evaluations = 0, cacheHits = 0;
+        long long sampleEvaluations = 0;
+        double evaluationBudget = 100;
+        double bestError = 0;
+        vector<TracePoint> trace;
 
         default_random_engine generator;
         normal_distribution<double> norm_distribution;
         bernoulli_distribution bern_dist;
 
         static constexpr double mutationRate = 0.5;
-        static constexpr int generationSize = 30;
+        static constexpr int halvingRate = 3;
+        int generationSize = 30;
         double difficultyConstant = 0.125;
         double initialPopulationAvgError, lastAvgError;
 
-        double mutateParameter(double currentValue, ParameterMetadata data);
+        map<string, double> tune(TuningMethods method);
+
+        double mutateParameter(double currentValue, const ParameterMetadata &data);
 
         map<string, double>
         tuneWithGeneticAlgorithm();
 
-        map<string, double> mutateParameters(map<string, double> parameters, double mutRate = mutationRate);
+        map<string, double> tuneWithCmaEs();
+
+        map<string, double> tuneWithSuccessiveHalving();
+
+        void mutateParameters(double *values, double mutRate = mutationRate);
+
+        double *member(vector<double> &block, int index);
+
+        size_t hashValues(const double *values);
+
+        //cache slot holding this parameter set, adding an unscored one if there is none
+        int findOrAddSlot(const double *values);
+
+        const double *slotValues(int slot);
+
+        //error over all samples, estimated from the samples scored so far
+        double slotError(int slot);
+
+        //score the slots on the pool until each has the first samples scored
+        void scoreSlots(const vector<int> &slots, int samples);
+
+        void recordTrace(int iteration, const vector<int> &slots);
+
+        double generateInitialPopulation();
 
-        double generateInitialPopulation(map<string, double> *populationBuffer, vector<double> &populationFitnessLevels,
-                                         int populationSize);
+        double generateNewPopulation();
 
-        double generateNewPopulation(map<string, double> *populationBuffer, vector<double> &populationErrorLevels,
-                                     int populationSize);
+        map<string, double> getBestParameterSet();
 
-        map<string, double> getBestParameterSet(map<string, double> *population, int populationSize);
+        //score every member not in the cache on the pool, then fill in the raw errors of all members
+        void evaluatePopulation();
 
     public:
+        ///Tuner that scores on one thread per hardware core
         ParameterTuner();
 
+        ///Tuner that scores on a number of threads (0 for one per core), breeding from a seed
+        explicit ParameterTuner(int threads, unsigned long long seed = DEFAULT_SEED);
+
         map<string, double>
-        tuneParameters(map<string, ParameterMetadata> parameters, double (*evalFunction)(map<string, double>),
+        tuneParameters(map<string, ParameterMetadata> parameters, EvaluationFunction evalFunction,
                        TuningMethods method = TuningMethods::GENETIC_ALGORITHM);
 
+        ///Tune with an evaluation function that scores one sample at a time
+        ///Successive halving needs this to discard poor candidates after a few samples; the other methods
+        ///score every set on all samples.
+        map<string, double>
+        tuneOnSamples(map<string, ParameterMetadata> parameters, SampleEvaluationFunction evalFunction,
+                      int samples, TuningMethods method = TuningMethods::SUCCESSIVE_HALVING);
+
         double difficultyModifier();
 
+        ///Parameter sets scored by the evaluation function in the last run, and lookups the cache answered
+        int getEvaluationCount();
+
+        int getCacheHitCount();
+
+        ///Cost of the last run in full evaluations, a set scored on part of the samples counting as that fraction
+        double getEvaluationCost();
+
+        ///Error of the parameter set returned by the last run, over all samples
+        double getBestError();
+
+        ///Members of every genetic algorithm generation (30 by default); successive halving starts from three
+        ///times as many candidates
+        void setPopulationSize(int size);
+
+        int getPopulationSize();
+
+        ///Full evaluations CMA-ES may spend before it stops (100 by default)
+        void setEvaluationBudget(double evaluations);
+
+        double getEvaluationBudget();
+
+        const vector<TracePoint> &getTrace();
+
+        ///Write the trace of the last run as CSV: iteration, cost, best error, mean error
+        bool writeTrace(const string &path);
+
     };
 
     template<typename T>
     class TuningSample {
     public:
         Mat image;
-        map<string, T> *sampleData;
-
-        TuningSample() {
-            sampleData = new map<string, T>();
-        }
+        map<string, T> sampleData;
+        ///Packed dataset the image points into, if it was loaded from one; keeps the mapping open
+        std::shared_ptr<TuningDataset> dataset;
 
         bool saveToFiles(const string &filePrefix, string (*toString)(T));
 
@@ -85,13 +265,32 @@ namespace robosub {
                 this->rootPath = rootPath;
         }
 
+        ///Save every sample in a directory of its own; removes the packed dataset, which no longer matches
         bool save(TuningSample<T> *samples, int size, string (*toString)(T));
 
+        ///Load the samples from the packed dataset if there is one, otherwise from the sample directories
+        ///The images of a packed dataset all point into one read-only mapping of the file; sample directories
+        ///are decoded in parallel.
         vector<TuningSample<T>> load(T (*fromString)(string));
+
+        ///Convert the sample directories to a packed dataset, which load() uses from then on
+        ///Labels are stored as doubles, so T must convert to and from double without loss.
+        bool pack(T (*fromString)(string));
+
+        string getPackedPath() {
+            return rootPath + "samples.pack";
+        }
+
+    private:
+        vector<TuningSample<T>> loadDirectories(T (*fromString)(string));
+
+        bool loadPacked(vector<TuningSample<T>> &samples);
     };
 
     template<typename T>
     bool TuningSampleManager<T>::save(TuningSample<T> *samples, int size, string (*toString)(T)) {
+        remove(getPackedPath().c_str());
+
         ofstream sizeFile(rootPath + "sizeFile.dat");
         if (sizeFile.is_open())
             sizeFile << size;
@@ -114,7 +313,7 @@ namespace robosub {
         ofstream dataFile(directory + "sampleData.txt");
 
         if (dataFile.is_open()) {
-            for (auto const &data: *sampleData) {
+            for (auto const &data: sampleData) {
                 dataFile << data.first << ":" << toString(data.second) << endl;
             }
         } else {
@@ -137,7 +336,7 @@ namespace robosub {
                 size_t divider = line.find(':');
                 string paramName = line.substr(0, divider);
                 T value = fromString(line.substr(divider + 1, line.size() - divider - 1));
-                sampleData->insert({paramName, value});
+                sampleData.insert({paramName, value});
             }
         } else {
             return false;
@@ -151,6 +350,17 @@ namespace robosub {
 
     template<typename T>
     vector<TuningSample<T>> TuningSampleManager<T>::load(T (*fromString)(string)) {
+        struct stat buffer;
+        if (stat(getPackedPath().c_str(), &buffer) == 0) {
+            vector<TuningSample<T>> samples;
+            if (loadPacked(samples)) return samples;
+            cout << getPackedPath() << " is not a valid packed dataset, loading the sample directories" << endl;
+        }
+        return loadDirectories(fromString);
+    }
+
+    template<typename T>
+    vector<TuningSample<T>> TuningSampleManager<T>::loadDirectories(T (*fromString)(string)) {
         ifstream sizeFile(rootPath + "sizeFile.dat");
         int size;
         if (sizeFile.is_open())
@@ -163,13 +373,47 @@ namespace robosub {
 
         vector<TuningSample<T>> samples(size);
 
-        for (int i = 0; i < size; ++i) {
+        //every sample is read and decoded on its own, so they can all load at once
+        ThreadPool pool;
+        pool.parallelFor(0, size, [this, &samples, fromString](int i) {
             string directory = rootPath + "Sample" + to_string(i) + "/";
             samples.at(i).loadFromFiles(directory, fromString);
-        }
+        });
 
         return samples;
     }
+
+    template<typename T>
+    bool TuningSampleManager<T>::loadPacked(vector<TuningSample<T>> &samples) {
+        std::shared_ptr<TuningDataset> dataset = std::make_shared<TuningDataset>();
+        if (!dataset->open(getPackedPath())) return false;
+
+        samples.resize(dataset->size());
+        for (int i = 0; i < dataset->size(); ++i) {
+            samples[i].image = dataset->getImage(i);
+            for (auto const &label : dataset->getLabels(i)) {
+                samples[i].sampleData[label.first] = (T) label.second;
+            }
+            samples[i].dataset = dataset;
+        }
+        return true;
+    }
+
+    template<typename T>
+    bool TuningSampleManager<T>::pack(T (*fromString)(string)) {
+        vector<TuningSample<T>> samples = loadDirectories(fromString);
+        if (samples.empty()) return false;
+
+        vector<Mat> images;
+        vector<map<string, double>> labels;
+        for (const TuningSample<T> &sample : samples) {
+            images.push_back(sample.image);
+            map<string, double> values;
+            for (auto const &data : sample.sampleData) values[data.first] = (double) data.second;
+            labels.push_back(values);
+        }
+        return TuningDataset::write(getPackedPath(), images, labels);
+    }
 }
 
 
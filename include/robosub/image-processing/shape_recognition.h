@@ -1,6 +1,10 @@
 #ifndef LIBROBOSUB_SHAPE_RECOGNITION_H
 #define LIBROBOSUB_SHAPE_RECOGNITION_H
 
+#include <map>
+#include <memory>
+#include "../threadpool.h"
+
 namespace robosub {
     class ShapeFindResult {
     private:
@@ -21,6 +25,9 @@ namespace robosub {
 
         static int getCountMode(const deque<int> &previousCounts);
 
+        ///Clear the shapes of the last frame, keeping the counts
+        void clearShapes();
+
         void addCount(deque<int> &previousCounts, int newCount);
 
         int getLastTriangleCount();
@@ -34,18 +41,64 @@ namespace robosub {
 
 
     class ShapeFinder {
+    public:
+        ///Time spent in each stage of the last processed frame, in microseconds
+        struct Timings {
+            ///Undistortion, grayscale conversion, threshold and image statistics
+            long long convert = 0;
+            ///Noise removal (pyrDown + pyrUp)
+            long long blur = 0;
+            long long edges = 0;
+            long long morphology = 0;
+            long long contours = 0;
+            long long classify = 0;
+            long long total = 0;
+        };
+
     private:
         bool running = true;
 
         Camera::CalibrationData calibrationData;
 
         Mat outputImage, processedImage;
+
+        //rows per band of the tiled preprocessing; a band of a 1280 wide BGR frame stays in L2 cache
+        static const int TILE_ROWS = 64;
+        //extra rows around a band for pyrDown + pyrUp; even so that band halves line up with the full frame
+        static const int PYRAMID_HALO = 8;
+
+        //undistortion tables, built once per frame size
+        Mat undistortMap1, undistortMap2;
+        Size undistortMapSize;
+        //intermediate images, reused between frames
+        Mat undistortedImage, grayImage, thresholdImage, blurredImage, edgeImage;
+        Timings timings;
+        //contours are classified in chunks of this size; chunk boundaries never depend on the thread count
+        static const int CLASSIFY_CHUNK_SIZE = 32;
+
+        //per-chunk shape buffers and contour mask scratch, reused between frames
+        vector<ShapeFindResult> chunkResults;
+        vector<Mat> chunkMasks;
+        //gray level statistics of the last full frame; region searches reuse them for their edge thresholds
         Scalar mu, sigma;
+        bool frameStatistics = false;
 
         void classifyShape(ShapeFindResult &result, vector<Point> &approx);
 
+        void classifyContours(vector<vector<Point>> &contours, const Mat &thresholdImage, ShapeFindResult &result);
+
         Mat preprocessImage(Mat &input);
 
+        void processLegacy(Mat &input);
+
+        bool canProcessTiled(const Mat &input);
+
+        void processTiled(Mat &input);
+
+        void ensureUndistortMaps(Size size);
+
+        void processRegion(const Mat &input, Rect region, ShapeFindResult &result);
+
     public:
         double EPSILON_APPROX_TOLERANCE_FACTOR = 0.0425;
         double MIN_AREA = 50;
@@ -58,9 +111,76 @@ namespace robosub {
         double IMAGE_BLACK_THRESHOLD = 38;
         double CONTOUR_BLACK_THRESHOLD = 150;
 
+        ///Run preprocessing as multi-threaded bands that stay in cache
+        ///Matches the full-frame path exactly, except that pinhole undistortion uses whole-frame remap tables.
+        ///Those can differ from cv::undistort's per-stripe tables by one 1/32 pixel interpolation step,
+        ///changing isolated gray values by at most one level. Frames with an odd height use the full-frame path.
+        bool TILED_PREPROCESSING = true;
+
         explicit ShapeFinder(Camera::CalibrationData calibrationData);
 
+        ///Find shapes in a BGR frame
+        ///On return, input holds the undistorted grayscale frame.
         void processFrame(Mat &input, ShapeFindResult &result);
+
+        ///Find shapes only inside regions of the undistorted frame, e.g. around tracked objects
+        ///Regions are grown by padding, merged where they overlap and undistorted straight from the BGR input
+        ///through the matching part of the cached remap tables, so the cost scales with their area.
+        ///Shapes are returned in full-frame coordinates; the count history is not updated and input is unchanged.
+        void processRegions(const Mat &input, const vector<Rect> &regions, ShapeFindResult &result, int padding = 0);
+
+        Timings getTimings();
+
+        Camera::CalibrationData getCalibrationData() const;
+
+        ///Copy the tunable parameters of another finder, leaving calibration and buffers alone
+        void copySettings(const ShapeFinder &other);
+    };
+
+    ///One frame of a batch, e.g. the latest frame of every camera
+    struct ShapeFindJob {
+        int sourceId;
+        ///Capture time in microseconds (Time::micros())
+        long long timestamp;
+        ///BGR frame; replaced by the undistorted grayscale frame during processing
+        Mat frame;
+    };
+
+    struct ShapeFindBatchResult {
+        int sourceId;
+        long long timestamp;
+        ///Shapes of this frame; the count history covers every frame of the same source so far
+        ShapeFindResult result;
+    };
+
+    ///Runs ShapeFinder on batches of frames from several cameras (or consecutive frames of one camera)
+    ///Frames are spread over a thread pool. Every worker keeps its own ShapeFinder per source, so scratch
+    ///buffers and undistortion tables are never shared between threads. OpenCV's own parallel loops
+    ///inside a finder (e.g. contour classification) run serially while the pool keeps every core busy.
+    class ShapeFinderBatch {
+    private:
+        ShapeFinder prototype;
+        std::map<int, Camera::CalibrationData> calibrations;
+        std::map<int, ShapeFindResult> history;
+        //finders[worker][sourceId]; the last set serves threads outside the pool
+        vector<std::map<int, std::unique_ptr<ShapeFinder>>> finders;
+        ThreadPool pool;
+
+        ShapeFinder &getFinder(int worker, int sourceId);
+
+    public:
+        ///Settings and default calibration are taken from the prototype
+        ///threads = 0 uses one worker per hardware core.
+        explicit ShapeFinderBatch(const ShapeFinder &prototype, int threads = 0);
+
+        ///Finder whose settings are applied to every worker at the start of each batch
+        ShapeFinder &getPrototype();
+
+        ///Use a separate calibration for one source
+        void setCalibration(int sourceId, Camera::CalibrationData calibrationData);
+
+        ///Process every job and wait for the results, which are returned in job order
+        void process(vector<ShapeFindJob> &jobs, vector<ShapeFindBatchResult> &results);
     };
 
 }
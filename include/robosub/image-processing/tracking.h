@@ -0,0 +1,151 @@
+#ifndef LIBROBOSUB_TRACKING_H
+#define LIBROBOSUB_TRACKING_H
+
+#include "../common.h"
+#include "shape_recognition.h"
+#include <opencv2/opencv.hpp>
+#include <vector>
+
+namespace robosub {
+    ///Keeps identities of detected objects between frames with a constant-velocity Kalman filter per object
+    ///Tracks coast on their prediction when a frame has no detection for them, so detectors only need to
+    ///run every few frames; needsDetection() says when a full detection is due.
+    class ObjectTracker {
+    public:
+        struct Detection {
+            ///Class of the object; detections only match tracks of the same type
+            int type;
+            Rect bounds;
+        };
+
+        struct Track {
+            int id;
+            int type;
+            ///Estimated bounds and center in the current frame
+            Rect bounds;
+            Point2f center;
+            ///Pixels per frame
+            Point2f velocity;
+            ///Frames since the track was created
+            int age = 0;
+            ///Frames with a matching detection, and consecutive frames without one
+            int hits = 0;
+            int misses = 0;
+
+            bool confirmed(int minHits) const { return hits >= minHits; }
+        };
+
+        struct Settings {
+            ///Run a full detection at least every this many frames
+            int detectionInterval = 5;
+            ///Overlap needed to match a detection with a predicted track
+            double minIoU = 0.2;
+            ///Detections whose center is this close to a prediction still match when they do not overlap
+            double maxCenterDistance = 40;
+            ///Tracks are dropped after this many frames without a match
+            int maxMisses = 10;
+            ///Matches needed before a track counts as confirmed
+            int minHits = 2;
+            ///Variance of the unmodeled motion per frame, in pixels squared
+            double processNoise = 1.0;
+            ///Variance of detected centers and sizes, in pixels squared
+            double measurementNoise = 4.0;
+        };
+
+    private:
+        struct Filter {
+            Track track;
+            KalmanFilter kalman;
+        };
+
+        Settings settings;
+        vector<Filter> filters;
+        int nextId = 1;
+        int framesSinceDetection = 0;
+        bool lostSinceDetection = false;
+        vector<Track> tracks;
+
+        void initFilter(Filter &filter, const Detection &detection);
+
+        //greedily pair detections with eligible filters, best overlap first; returns the detection of each filter
+        vector<int> match(const vector<Detection> &detections, const vector<bool> &eligible);
+
+        void correctFilter(Filter &filter, const Detection &detection);
+
+        void removeLost();
+
+        void updateTrack(Filter &filter);
+
+        void refreshTracks();
+
+    public:
+        EXPORT ObjectTracker();
+
+        EXPORT explicit ObjectTracker(Settings settings);
+
+        ///Advance every track to the next frame
+        ///Call once per frame, before update() or correct().
+        EXPORT void predict();
+
+        ///Match a full detection of the frame with the tracks
+        ///Unmatched detections start new tracks; tracks without a match count a miss.
+        EXPORT void update(const vector<Detection> &detections);
+
+        ///Match detections that only cover part of the frame (e.g. searched near predictions)
+        ///Unlike update(), no new tracks are started and only the tracks listed in searched can miss.
+        EXPORT void correct(const vector<Detection> &detections, const vector<int> &searched);
+
+        ///True when the detector should search the whole frame: the interval is up, a track was lost,
+        ///or a new track still needs to be confirmed
+        EXPORT bool needsDetection();
+
+        EXPORT const vector<Track> &getTracks();
+
+        ///Predicted bounds of every track, grown by padding on each side and clipped to the frame
+        EXPORT vector<Rect> getSearchRegions(int padding, Size frameSize);
+
+        EXPORT void reset();
+
+        EXPORT static double intersectionOverUnion(const Rect &a, const Rect &b);
+    };
+
+    ///Runs ShapeFinder on full frames at a reduced rate and only around the tracked shapes in between
+    class ShapeTracker {
+    public:
+        enum ShapeType {
+            TRIANGLE,
+            SQUARE,
+            RECTANGLE,
+            CIRCLE
+        };
+
+    private:
+        ShapeFinder &finder;
+        ObjectTracker tracker;
+        bool detected = false;
+
+    public:
+        ///Pixels searched around each predicted shape on frames without a full detection
+        int SEARCH_PADDING = 24;
+
+        EXPORT explicit ShapeTracker(ShapeFinder &finder);
+
+        EXPORT ShapeTracker(ShapeFinder &finder, ObjectTracker::Settings settings);
+
+        ///Track shapes in a BGR frame, running the finder on the whole frame when the tracker needs a detection
+        ///and on the padded predictions otherwise. input is only converted by full detections.
+        EXPORT void processFrame(Mat &input, ShapeFindResult &result);
+
+        ///True if the last processFrame() ran a full detection
+        EXPORT bool ranDetection();
+
+        EXPORT const vector<ObjectTracker::Track> &getTracks();
+
+        EXPORT ObjectTracker &getTracker();
+
+        ///Detections for every shape in a result
+        EXPORT static vector<ObjectTracker::Detection> toDetections(const ShapeFindResult &result);
+    };
+}
+
+#endif //LIBROBOSUB_TRACKING_H
@@ -0,0 +1,88 @@
+#ifndef LIBROBOSUB_TUNING_DATASET_H
+#define LIBROBOSUB_TUNING_DATASET_H
+
+#include "../common.h"
+#include <opencv2/opencv.hpp>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace robosub {
+    ///Tuning samples packed into one file: decoded images and numeric labels behind an index
+    ///The file is memory-mapped, so opening it only reads the index, images are Mats pointing into the mapping,
+    ///and every thread and process using the dataset shares one copy in the page cache. The mapping is private:
+    ///writing to an image copies the pages it touches and never changes the file.
+    ///
+    ///Layout, in native byte order: header, label names, one index entry per sample, the labels of every sample,
+    ///then the pixels of every image, each starting on a 64 byte boundary.
+    class TuningDataset {
+    public:
+        static const uint32_t VERSION = 1;
+
+    private:
+        struct Header {
+            char magic[8];
+            uint32_t version;
+            uint32_t sampleCount;
+            uint32_t nameCount;
+            uint32_t reserved;
+            uint64_t labelCount;
+            uint64_t namesOffset;
+            uint64_t indexOffset;
+            uint64_t labelsOffset;
+        };
+
+        struct IndexEntry {
+            uint64_t imageOffset;
+            int32_t rows, cols, type;
+            uint32_t labelCount;
+            uint64_t firstLabel;
+        };
+
+        struct Label {
+            uint32_t name;
+            uint32_t reserved;
+            double value;
+        };
+
+        unsigned char *data = nullptr;
+        size_t length = 0;
+        const IndexEntry *index = nullptr;
+        const Label *labels = nullptr;
+        vector<string> names;
+        int sampleCount = 0;
+
+        //check every offset in the file before anything points into it
+        bool validate();
+
+    public:
+        EXPORT TuningDataset();
+
+        EXPORT ~TuningDataset();
+
+        TuningDataset(const TuningDataset &) = delete;
+        TuningDataset &operator=(const TuningDataset &) = delete;
+
+        ///Map a packed dataset; returns false if the file cannot be read or is not a valid dataset
+        EXPORT bool open(const string &path);
+
+        ///Unmap the file; images returned before must not be used after this
+        EXPORT void close();
+
+        EXPORT bool isOpen() const;
+
+        EXPORT int size() const;
+
+        ///Image of a sample, pointing into the mapping; valid until close()
+        EXPORT Mat getImage(int index) const;
+
+        EXPORT map<string, double> getLabels(int index) const;
+
+        ///Write samples as a packed dataset; images and labels are matched by position
+        EXPORT static bool write(const string &path, const vector<Mat> &images,
+                                 const vector<map<string, double>> &labels);
+    };
+}
+
+#endif //LIBROBOSUB_TUNING_DATASET_H
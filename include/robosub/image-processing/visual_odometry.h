@@ -0,0 +1,111 @@
+#ifndef LIBROBOSUB_VISUAL_ODOMETRY_H
+#define LIBROBOSUB_VISUAL_ODOMETRY_H
+
+#include "../common.h"
+#include "../timeutil.h"
+#include "frame_pyramid.h"
+#include <opencv2/opencv.hpp>
+#include <vector>
+
+namespace robosub {
+    ///Frame-to-frame camera motion from sparse optical flow, meant for the downward-facing camera
+    ///Corners are followed with pyramidal Lucas-Kanade on a small pyramid level, and a rotation plus translation
+    ///(with a little scale for altitude changes) is fitted to them with RANSAC. Corners that agree with the fit
+    ///are kept for the next frame; new ones are only detected when too few are left.
+    ///
+    ///Every frame has to fit in a CPU budget: when it does not, fewer corners are tracked, and once at the
+    ///minimum the flow moves to the next smaller level. Both recover when frames get cheap again.
+    class VisualOdometry {
+    public:
+        struct Settings {
+            ///Flow runs on the largest pyramid level no wider than this
+            int analysisWidth = 320;
+            ///Corners tracked at most, and the count below which new corners are detected
+            int maxFeatures = 200;
+            int minFeatures = 60;
+            ///goodFeaturesToTrack quality level, and minimum distance between corners in analyzed pixels
+            double featureQuality = 0.01;
+            double minFeatureDistance = 7;
+            ///Lucas-Kanade window side and pyramid levels
+            int windowSize = 15;
+            int flowLevels = 2;
+            ///Largest distance from the fit, in analyzed pixels, for a corner to count as an inlier
+            double ransacThreshold = 1.0;
+            ///Inliers needed for a valid estimate
+            int minInliers = 12;
+            ///CPU time allowed per frame
+            double budgetMillis = 4;
+        };
+
+        struct Motion {
+            ///Capture time of the frame in microseconds (Time::micros()), and seconds since the previous frame
+            long long timestamp = 0;
+            double dt = 0;
+            ///Camera motion since the previous frame, in full-resolution pixels along the previous frame's axes
+            ///The scene moves the opposite way in the image. For meters, scale by distance to the floor over the
+            ///focal length in pixels.
+            Point2d translation;
+            ///Camera rotation since the previous frame in radians, positive from the image x axis towards y
+            double yaw = 0;
+            ///translation / dt and yaw / dt
+            Point2d velocity;
+            double yawRate = 0;
+            ///Corners followed from the previous frame, and how many of them agree with the estimate
+            int tracked = 0;
+            int inliers = 0;
+            ///False when there was no previous frame or too few inliers; the motion is zero then
+            bool valid = false;
+            ///CPU time spent on the frame
+            long long processingMicros = 0;
+            ///Size of the level the flow ran on
+            Size analysisSize;
+        };
+
+    private:
+        Settings settings;
+        Motion lastMotion;
+        FramePyramid ownPyramid;
+        Mat gray, previousGray;
+        vector<Point2f> previousPoints, points, from, to;
+        vector<uchar> status, inlierMask;
+        vector<float> errors;
+        long long previousTimestamp = -1;
+        //reduced to meet the budget: corners tracked at most, and levels below the one analysisWidth picks
+        int featureLimit;
+        int levelOffset = 0;
+        //levels below the one analysisWidth picks that are still wide enough to track on, as of the last frame
+        int maxLevelOffset = 0;
+
+        Motion estimate(const Mat &image, double scale, long long timestamp, Stopwatch &stopwatch);
+
+        void adaptToBudget(long long micros);
+
+    public:
+        EXPORT VisualOdometry();
+
+        EXPORT explicit VisualOdometry(Settings settings);
+
+        ///Estimate the motion since the previous frame from a BGR or grayscale 8-bit frame
+        EXPORT Motion process(const Mat &frame, long long timestamp);
+
+        ///Same, reading the level from a pyramid shared with other stages
+        EXPORT Motion process(FramePyramid &pyramid, long long timestamp);
+
+        ///Forget the previous frame, e.g. after the camera was switched or paused
+        EXPORT void reset();
+
+        EXPORT Motion getLastMotion();
+
+        ///Corner limit and extra pyramid levels currently used to stay within the budget
+        EXPORT int getFeatureLimit();
+
+        EXPORT int getLevelOffset();
+
+        EXPORT Settings getSettings();
+
+        ///Apply new settings; also lifts any reduction made for the budget
+        EXPORT void setSettings(Settings settings);
+    };
+}
+
+#endif //LIBROBOSUB_VISUAL_ODOMETRY_H
@@ -45,6 +45,72 @@ namespace robosub
 		EXPORT static void upsample(Mat& image, double scale);
 	};
 
+	///Removes the blue-green cast of underwater footage and stretches its contrast
+	///Channel gains and a contrast-limited tone curve are estimated on a small copy of the frame every few
+	///frames and folded into one 256-entry table per channel, so correcting a frame is a single LUT pass.
+	class ColorCorrector
+	{
+	public:
+		enum Method
+		{
+			///Scale channels so their means are equal
+			GRAY_WORLD,
+			///Scale channels so a bright percentile of each maps to white
+			WHITE_PATCH
+		};
+
+		struct Settings
+		{
+			Method method = GRAY_WORLD;
+			///Frames between estimates; the tables are reused in between
+			int updateInterval = 10;
+			///Width of the copy the estimate is computed on
+			int analysisWidth = 160;
+			///Percentile used as white by WHITE_PATCH
+			double whitePercentile = 0.99;
+			///Largest gain applied to any channel (the smallest is its inverse)
+			double maxGain = 4.0;
+			///Weight of a new estimate against the previous one, to avoid flicker
+			double smoothing = 0.3;
+			///Blend between no tone curve (0) and full equalization (1)
+			double contrast = 0.5;
+			///Histogram bins are clipped at this multiple of the average bin, as in CLAHE
+			double clipLimit = 3.0;
+		};
+
+	private:
+		Settings settings;
+		Vec3d gains = Vec3d(1, 1, 1);
+		Mat lut;
+		Mat small;
+		long long frames = 0;
+		bool estimated = false;
+
+		void buildTable(const int* lumaHistogram, int total);
+
+	public:
+		EXPORT ColorCorrector();
+		EXPORT explicit ColorCorrector(Settings settings);
+
+		///Correct a BGR frame (src and dst may be the same), re-estimating every updateInterval frames
+		EXPORT void apply(const Mat& src, Mat& dst);
+
+		///Estimate gains and tone curve from a BGR frame now
+		EXPORT void estimate(const Mat& frame);
+
+		///Forget previous estimates; the next frame starts a new one
+		EXPORT void reset();
+
+		EXPORT Vec3d getGains();
+
+		///Current tables as a 1x256 CV_8UC3 Mat, for cv::LUT
+		EXPORT Mat getLookupTable();
+
+		EXPORT Settings getSettings();
+
+		EXPORT void setSettings(Settings settings);
+	};
+
 	class Drawing
 	{
 	public:
@@ -57,6 +123,8 @@ namespace robosub
 
 		EXPORT static Size getTextSize(String text, double scale, int thickness);
 
+		///Alpha-blend a 4 channel overlay onto src at location, using the overlay's 4th channel as opacity
+		///The overlay may extend past the edges of src; only the overlapping part is drawn.
 		EXPORT static void transparentImage(Mat* src, Mat* overlay, const Point& location);
 
 		EXPORT static void rectangle(Mat& img, Point one, Point two, Scalar borderColor, Scalar fillColor = Scalar(), int thickness = 1, int lineType = LINE_8);
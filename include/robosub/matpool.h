@@ -0,0 +1,107 @@
+#pragma once
+
+#include "common.h"
+#include <opencv2/opencv.hpp>
+#include <map>
+#include <mutex>
+#include <vector>
+
+namespace robosub {
+    ///cv::MatAllocator that keeps the buffers of released Mats and hands them out again
+    ///Buffers are kept by size, rounded up to 64 bytes (4 KiB from 4 KiB up), so a frame loop that
+    ///creates the same images every frame stops allocating after the first one. Buffers of 2 MiB and up
+    ///are 2 MiB aligned and marked for transparent huge pages, smaller ones are cache line aligned.
+    ///
+    ///Install it globally with install(), or only for some Mats by setting their allocator member
+    ///before they are created (see Pipeline::setAllocator). The pool must outlive every Mat it allocated.
+    class MatPool : public MatAllocator {
+    public:
+        struct Settings {
+            ///Free buffers kept for reuse; buffers released beyond this go back to the system
+            size_t maxCachedBytes = (size_t) 512 << 20;
+            ///Buffers at least this large are aligned to it and marked for huge pages
+            size_t hugePageSize = (size_t) 2 << 20;
+        };
+
+        struct Stats {
+            ///Buffers handed out, and how many of those were reused
+            unsigned long long allocations = 0;
+            unsigned long long hits = 0;
+            ///Buffers taken from and returned to the system
+            unsigned long long systemAllocations = 0;
+            unsigned long long systemFrees = 0;
+            ///Bytes held by live Mats, and bytes kept free for reuse
+            size_t bytesInUse = 0;
+            size_t bytesCached = 0;
+            size_t peakBytesInUse = 0;
+            ///Largest bytesInUse + bytesCached, i.e. the most memory the pool has held
+            size_t peakBytes = 0;
+
+            double hitRate() const { return allocations > 0 ? (double) hits / allocations : 0; }
+        };
+
+    private:
+        Settings settings;
+        mutable std::mutex lock;
+        //free buffers by rounded size, and storage for UMatData headers, so neither needs the heap again
+        mutable std::map<size_t, vector<void *>> freeBuffers;
+        mutable vector<void *> freeHeaders;
+        mutable Stats stats;
+        MatAllocator *previous = nullptr;
+        bool installed = false;
+
+        size_t bucketSize(size_t bytes) const;
+
+        void *takeBuffer(size_t bucket) const;
+
+        void returnBuffer(void *buffer, size_t bucket) const;
+
+        UMatData *newHeader() const;
+
+        void deleteHeader(UMatData *u) const;
+
+        void *systemAllocate(size_t bucket) const;
+
+        void systemFree(void *buffer) const;
+
+    public:
+        EXPORT MatPool();
+
+        EXPORT explicit MatPool(Settings settings);
+
+        ///Frees the cached buffers; uninstalls the pool if it is still the default allocator
+        EXPORT ~MatPool();
+
+        MatPool(const MatPool &) = delete;
+        MatPool &operator=(const MatPool &) = delete;
+
+        ///Process-wide pool that is never destroyed, so Mats in static objects can still release into it
+        EXPORT static MatPool &shared();
+
+        ///Make this the allocator of every new Mat (Mat::setDefaultAllocator), remembering the previous one
+        EXPORT void install();
+
+        ///Restore the allocator that was the default before install()
+        ///Mats already allocated by the pool still return their buffers to it.
+        EXPORT void uninstall();
+
+        ///Return every cached buffer to the system
+        EXPORT void trim();
+
+        EXPORT Stats getStats();
+
+        ///Zero the counters and restart the peaks from the current usage
+        EXPORT void resetStats();
+
+        EXPORT Settings getSettings();
+
+        EXPORT void setSettings(Settings settings);
+
+        EXPORT UMatData *allocate(int dims, const int *sizes, int type, void *data, size_t *step, int flags,
+                                  UMatUsageFlags usageFlags) const override;
+
+        EXPORT bool allocate(UMatData *data, int accessflags, UMatUsageFlags usageFlags) const override;
+
+        EXPORT void deallocate(UMatData *data) const override;
+    };
+}
@@ -15,6 +15,11 @@
 #else
     #include <unistd.h>
     #include <arpa/inet.h>
+    #include <sys/ioctl.h>
+#endif
+
+#ifdef __linux__
+    #include <linux/sockios.h>
 #endif
 
 #ifdef NETWORKTCP_WINSOCK
@@ -50,7 +55,11 @@ namespace robosub{
 		int acceptClient();
 		int dropClient();
 		int receiveBuffer(char* data, int maxlen);
+		//read whatever the client has sent without blocking; returns bytes read, 0 if none or -1 on error
+		int pollBuffer(char* data, int maxlen);
 		int sendBuffer(char* data, int datalen);
+		//bytes sent but not yet acknowledged by the client, or -1 if unknown
+		int getSendQueueBytes();
 	};
 	
 	///////////////////////////////////////////////////////////
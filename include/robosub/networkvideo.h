@@ -26,7 +26,20 @@ namespace robosub{
 		int packetsPerFrame;
 		UDPR *udpr;
 		
+		//frees the buffers of the current frame size
+		void release(){
+			if(!initialized) return;
+			for(int i=0; i<NetworkVideo_MostRecentFrameCount; i++){
+				delete bufferFrames[i];
+				delete[] bufferFramesReceivedPacket[i];
+				delete[] bufferFramesMostRecentFrameId[i];
+			}
+			delete bufferFrameLatest;
+			initialized = false;
+		}
+
 		void uninitialize(){
+			release();
 			for(int i=0; i<NetworkVideo_MostRecentFrameCount; i++){
 				bufferFrames[i] = 0;
 				bufferFramesReceivedPacket[i] = 0;
@@ -44,18 +57,12 @@ namespace robosub{
 		
 		public:
 		NetworkVideoFrameReceiver(UDPR& iudpr){
+			initialized = false;
 			uninitialize();
 			udpr = &iudpr;
 		}
 		~NetworkVideoFrameReceiver(){
-			if(initialized){
-				for(int i=0; i<NetworkVideo_MostRecentFrameCount; i++){
-					delete(bufferFrames[i]);
-					delete(bufferFramesReceivedPacket[i]);
-					delete(bufferFramesMostRecentFrameId[i]);
-				}
-				delete(bufferFrameLatest);
-			}
+			release();
 		}
 		bool isInitialized();
 		Mat* getBestFrame();
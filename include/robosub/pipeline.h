@@ -0,0 +1,270 @@
+#pragma once
+
+#include "common.h"
+#include "timeutil.h"
+#include "json/json.hpp"
+#include <opencv2/opencv.hpp>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace robosub {
+    typedef nlohmann::json json;
+
+    ///Bounded multi-producer, multi-consumer ring buffer that never takes a lock
+    ///Every cell carries a sequence number telling producers and consumers whose turn it is (D. Vyukov's
+    ///bounded MPMC queue), so a push or pop is one compare-and-swap on the shared position.
+    template<class T>
+    class BoundedQueue {
+    private:
+        struct Cell {
+            std::atomic<size_t> sequence;
+            T value;
+        };
+
+        std::unique_ptr<Cell[]> cells;
+        size_t mask;
+        std::atomic<size_t> enqueuePosition;
+        //producers and consumers update different positions; keep them on separate cache lines
+        char padding[64];
+        std::atomic<size_t> dequeuePosition;
+
+    public:
+        ///Capacity is rounded up to a power of two, at least 2
+        explicit BoundedQueue(size_t capacity) {
+            size_t size = 2;
+            while (size < capacity) size <<= 1;
+            cells.reset(new Cell[size]);
+            mask = size - 1;
+            for (size_t i = 0; i < size; i++) cells[i].sequence.store(i, std::memory_order_relaxed);
+            enqueuePosition.store(0, std::memory_order_relaxed);
+            dequeuePosition.store(0, std::memory_order_relaxed);
+        }
+
+        BoundedQueue(const BoundedQueue &) = delete;
+        BoundedQueue &operator=(const BoundedQueue &) = delete;
+
+        ///Move value into the queue; returns false and leaves value alone if the queue is full
+        bool tryPush(T &value) {
+            size_t position = enqueuePosition.load(std::memory_order_relaxed);
+            while (true) {
+                Cell &cell = cells[position & mask];
+                size_t sequence = cell.sequence.load(std::memory_order_acquire);
+                intptr_t difference = (intptr_t) sequence - (intptr_t) position;
+                if (difference == 0) {
+                    if (enqueuePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                        cell.value = std::move(value);
+                        cell.sequence.store(position + 1, std::memory_order_release);
+                        return true;
+                    }
+                } else if (difference < 0) {
+                    return false;
+                } else {
+                    position = enqueuePosition.load(std::memory_order_relaxed);
+                }
+            }
+        }
+
+        ///Move the oldest value out of the queue; returns false if it is empty
+        bool tryPop(T &value) {
+            size_t position = dequeuePosition.load(std::memory_order_relaxed);
+            while (true) {
+                Cell &cell = cells[position & mask];
+                size_t sequence = cell.sequence.load(std::memory_order_acquire);
+                intptr_t difference = (intptr_t) sequence - (intptr_t) (position + 1);
+                if (difference == 0) {
+                    if (dequeuePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                        value = std::move(cell.value);
+                        //leave no reference to the value's buffers behind in the ring
+                        cell.value = T();
+                        cell.sequence.store(position + mask + 1, std::memory_order_release);
+                        return true;
+                    }
+                } else if (difference < 0) {
+                    return false;
+                } else {
+                    position = dequeuePosition.load(std::memory_order_relaxed);
+                }
+            }
+        }
+
+        ///Number of queued values; only a snapshot while other threads push and pop
+        size_t size() {
+            size_t tail = enqueuePosition.load(std::memory_order_acquire);
+            size_t head = dequeuePosition.load(std::memory_order_acquire);
+            return tail > head ? tail - head : 0;
+        }
+
+        size_t capacity() {
+            return mask + 1;
+        }
+    };
+
+    ///One frame travelling through a Pipeline
+    struct PipelineItem {
+        ///Set by the source stage, increasing by one per item it produces
+        long long sequence = 0;
+        ///Capture time in microseconds (Time::micros()); stage latency is measured from it
+        long long timestamp = 0;
+        ///Source stage that produced the item
+        int source = -1;
+        Mat image;
+        ///Intermediate images by name, e.g. "undistorted"
+        std::map<String, Mat> images;
+        ///Results for later stages and telemetry
+        json results;
+    };
+
+    ///Runs vision stages connected as a directed acyclic graph, each stage on its own worker threads
+    ///Stages pass items through bounded lock-free queues, one per edge; the edge policy decides what a
+    ///producer does when its consumer falls behind. A stage with several inputs takes items from whichever
+    ///has one, and a stage with several outputs sends each of them its own copy of the item. Copies share
+    ///pixel data, so a stage must write into a new Mat rather than into an image it received.
+    class Pipeline {
+    public:
+        ///Process an item in place; return false to drop it
+        ///For a source, fill in a new item instead; returning false ends that source worker.
+        typedef std::function<bool(PipelineItem &)> StageFunction;
+
+        ///What a stage does when the queue to its successor is full
+        enum EdgePolicy {
+            ///Wait for the successor to take an item (backpressure)
+            BLOCK,
+            ///Discard the oldest queued item to make room
+            DROP_OLDEST,
+            ///Discard everything queued, so the successor always gets the newest item
+            LATEST_ONLY
+        };
+
+        struct StageStats {
+            String name;
+            int workers = 0;
+            unsigned long long processed = 0;
+            ///Items the stage function returned false for
+            unsigned long long rejected = 0;
+            ///Items the stage function threw an exception for
+            unsigned long long errors = 0;
+            ///Items discarded by the queues into this stage
+            unsigned long long dropped = 0;
+            ///Items waiting in the queues into this stage
+            size_t queueDepth = 0;
+            ///Time spent in the stage function per item
+            double meanMicros = 0;
+            long long maxMicros = 0;
+            ///From the item's timestamp to the end of this stage, averaged over processed items
+            double meanLatencyMicros = 0;
+            ///Items processed per second between start() and the end of wait(), or now while running
+            double throughput = 0;
+        };
+
+    private:
+        //wakes idle threads; only used when there is nothing to do, never on the path of an item
+        struct Signal {
+            std::mutex lock;
+            std::condition_variable condition;
+            std::atomic<int> waiters;
+
+            Signal() : waiters(0) {}
+
+            void notify();
+
+            void wait(const std::function<bool()> &ready);
+        };
+
+        struct Edge {
+            int from, to;
+            EdgePolicy policy;
+            std::unique_ptr<BoundedQueue<PipelineItem>> queue;
+            std::atomic<unsigned long long> dropped;
+
+            Edge() : dropped(0) {}
+        };
+
+        struct Stage {
+            String name;
+            StageFunction function;
+            int workerCount;
+            bool source;
+            vector<int> inputs, outputs;
+            vector<std::thread> threads;
+            std::atomic<int> activeWorkers;
+            std::atomic<long long> nextSequence;
+            //new input items, and freed room in the input queues
+            Signal itemReady, spaceFreed;
+
+            std::atomic<unsigned long long> processed, rejected, errors;
+            std::atomic<long long> totalMicros, maxMicros, totalLatencyMicros;
+
+            Stage() : activeWorkers(0), nextSequence(0), processed(0), rejected(0), errors(0), totalMicros(0),
+                      maxMicros(0), totalLatencyMicros(0) {}
+        };
+
+        vector<std::unique_ptr<Stage>> stages;
+        vector<std::unique_ptr<Edge>> edges;
+        std::atomic<bool> stopping;
+        MatAllocator *allocator = nullptr;
+        bool started = false;
+        long long startTime = 0, finishTime = 0;
+
+        int addStage(const String &name, StageFunction function, int workers, bool source);
+
+        void runWorker(int stage, int worker);
+
+        bool takeInput(Stage &stage, size_t &nextInput, PipelineItem &item);
+
+        bool inputsFinished(Stage &stage);
+
+        void emit(Stage &stage, PipelineItem &item);
+
+        void push(Edge &edge, PipelineItem &item);
+
+        void record(Stage &stage, long long micros, const PipelineItem &item);
+
+    public:
+        EXPORT Pipeline();
+
+        ///Stops the sources and waits for every queued item to be processed
+        EXPORT ~Pipeline();
+
+        Pipeline(const Pipeline &) = delete;
+        Pipeline &operator=(const Pipeline &) = delete;
+
+        ///Add a stage that produces items, e.g. a camera; returns its id
+        ///Sequence and timestamp are filled in before the function is called; it may overwrite the timestamp.
+        EXPORT int addSource(const String &name, StageFunction produce, int workers = 1);
+
+        ///Add a stage that processes the items of its inputs; returns its id
+        EXPORT int addStage(const String &name, StageFunction process, int workers = 1);
+
+        ///Send the items of one stage to another through a queue holding up to capacity items
+        ///The capacity is rounded up to a power of two, at least 2.
+        EXPORT void connect(int from, int to, EdgePolicy policy = BLOCK, int capacity = 4);
+
+        ///Allocate the image of every new item with this allocator (e.g. a MatPool) instead of the default one
+        ///Only item.image is covered; other Mats follow the default allocator. Call before start().
+        EXPORT void setAllocator(MatAllocator *allocator);
+
+        ///Start every worker thread
+        ///Throws std::logic_error if the stages contain a cycle or a stage other than a source has no input.
+        EXPORT void start();
+
+        ///Ask the sources to stop; everything already produced still runs through the rest of the graph
+        EXPORT void stop();
+
+        ///Wait until every source has ended and the graph has drained
+        EXPORT void wait();
+
+        EXPORT bool isRunning();
+
+        EXPORT vector<StageStats> getStats();
+
+        ///Stats of every stage by name, for telemetry
+        EXPORT json getStatsJson();
+    };
+}
@@ -33,27 +33,85 @@ namespace robosub {
 
     };
 
+    ///Statistics of the pixels enclosed by a filled contour
+    struct ContourStats {
+        ///Bounding box of the contour, clipped to the image
+        Rect bounds;
+        ///Number of enclosed pixels
+        double pixels = 0;
+        Scalar meanColor;
+        ///Center of mass of the enclosed pixels, in image coordinates
+        Point2d centroid;
+        ///Moments of the enclosed pixels, relative to bounds.tl()
+        Moments moments;
+
+        ///Compute statistics for every contour in one pass over a label image
+        ///labels is scratch space that can be reused between frames. Where contours overlap, later ones win.
+        EXPORT static void compute(const Mat &img, const vector<vector<Point>> &contours,
+                                   vector<ContourStats> &stats, Mat &labels);
+    };
+
+    ///Non-owning view over a contiguous run of points
+    template<class T>
+    class PointSpan_ {
+    private:
+        const Point_<T> *first;
+        size_t count;
+
+    public:
+        PointSpan_() : first(nullptr), count(0) {}
+
+        PointSpan_(const Point_<T> *first, size_t count) : first(first), count(count) {}
+
+        size_t size() const { return count; }
+
+        bool empty() const { return count == 0; }
+
+        const Point_<T> &operator[](size_t i) const { return first[i]; }
+
+        const Point_<T> *begin() const { return first; }
+
+        const Point_<T> *end() const { return first + count; }
+    };
+
+    typedef PointSpan_<int> PointSpan;
+
+    ///Polygon or contour backed by a Mat of points
+    ///Geometry is computed on first use and cached, so the points must not change afterwards.
     template<class T>
     class Contour_ : Detectable {
 
     private:
+        static const int CACHED_SIDES = 4;
+
         Mat data;
         Size_<T> _boundingBox = Size_<T>();
         Point_<T> _topLeft = Point_<T>();
+        double _area = 0;
+        double _perimeter = 0;
+        Point2d _centroid;
+        double _sides[CACHED_SIDES];
+        bool cachedBoundingBox = false;
+        bool cachedArea = false;
+        bool cachedPerimeter = false;
+        bool cachedCentroid = false;
+        int cachedSides = 0; //bit i is set once side i is cached
 
         int type();
 
         void calculateBoundingBoxDimensions() {
-            if (this->_boundingBox.width != 0) return;
+            if (cachedBoundingBox) return;
+            cachedBoundingBox = true;
 
-            //Calculate size and topLeft at the same time
-            int minX = INT_MAX;
-            int maxX = INT_MIN;
-            int minY = INT_MAX;
-            int maxY = INT_MIN;
+            PointSpan_<T> points = getPointSpan();
+            if (points.empty()) return;
 
-            vector<Point_<T>> points = getPoints();
-            for (Point_<T> p : points) {
+            //Calculate size and topLeft at the same time
+            T minX = points[0].x;
+            T maxX = points[0].x;
+            T minY = points[0].y;
+            T maxY = points[0].y;
+            for (const Point_<T> &p : points) {
                 if (p.x < minX) {
                     minX = p.x;
                 }
@@ -68,8 +126,8 @@ namespace robosub {
                 }
             }
 
-            this->_boundingBox = Size(maxX - minX, maxY - minY);
-            this->_topLeft = Point(minX, minY);
+            this->_boundingBox = Size_<T>(maxX - minX, maxY - minY);
+            this->_topLeft = Point_<T>(minX, minY);
         }
 
 
@@ -86,43 +144,89 @@ namespace robosub {
             data = Mat(points.size(), 2, CV_32S, points.data());
         }
 
+        ///View of the points without copying them
+        ///Valid as long as the contour and the memory it was created from are alive.
+        PointSpan_<T> getPointSpan() {
+            //views need contiguous points; only copies the rare non-contiguous Mat, once
+            if (!data.isContinuous()) data = data.clone();
+            return PointSpan_<T>((const Point_<T> *) data.data, data.total() * data.channels() / 2);
+        }
+
         int points() {
-            return data.rows;
+            return (int) getPointSpan().size();
         }
 
         double area() {
-            return abs(contourArea(data));
+            if (!cachedArea) {
+                _area = abs(contourArea(data));
+                cachedArea = true;
+            }
+            return _area;
         }
 
         bool isClosed() {
             return isContourConvex(data);
         }
 
+        ///Length of the closed outline
+        double perimeter() {
+            if (!cachedPerimeter) {
+                _perimeter = cv::arcLength(data, true);
+                cachedPerimeter = true;
+            }
+            return _perimeter;
+        }
+
+        ///Distance from point i to the next point, wrapping around to the first
+        double sideLength(int i) {
+            if (i < CACHED_SIDES && (cachedSides & (1 << i))) return _sides[i];
+
+            PointSpan_<T> points = getPointSpan();
+            const Point_<T> &a = points[i];
+            const Point_<T> &b = points[(i + 1) % points.size()];
+            double length = Util::euclideanDistance(a.x, a.y, b.x, b.y);
+
+            if (i < CACHED_SIDES) {
+                _sides[i] = length;
+                cachedSides |= 1 << i;
+            }
+            return length;
+        }
+
         Point2d centroid() {
             //C_{\mathrm x} = \frac{1}{6A}\sum_{i=0}^{n-1}(x_i+x_{i+1})(x_i\ y_{i+1} - x_{i+1}\ y_i)
             //C_{\mathrm y} = \frac{1}{6A}\sum_{i=0}^{n-1}(y_i+y_{i+1})(x_i\ y_{i+1} - x_{i+1}\ y_i)
+            if (cachedCentroid) return _centroid;
+            cachedCentroid = true;
 
-            if (points() < 2)
-                return center();
+            PointSpan_<T> points = getPointSpan();
+            if (points.size() < 2) {
+                _centroid = center();
+                return _centroid;
+            }
 
             double xSum = 0.0;
             double ySum = 0.0;
             double area = 0.0;
-            vector<Point_<T>> points = getPoints();
 
-            for (unsigned int i = 0; i < points.size() - 1; i++) {
+            for (size_t i = 0; i < points.size(); i++) {
+                const Point_<T> &p0 = points[i];
+                const Point_<T> &p1 = points[(i + 1) % points.size()];
                 //cross product, (signed) double area of triangle of vertices (origin,p0,p1)
-                double signedArea = (points[i].x * points[i + 1].y) - (points[i + 1].x * points[i].y);
-                xSum += (points[i].x + points[i + 1].x) * signedArea;
-                ySum += (points[i].y + points[i + 1].y) * signedArea;
+                double signedArea = ((double) p0.x * p1.y) - ((double) p1.x * p0.y);
+                xSum += (p0.x + p1.x) * signedArea;
+                ySum += (p0.y + p1.y) * signedArea;
                 area += signedArea;
             }
 
-            if (area == 0)
-                return center();
+            if (area == 0) {
+                _centroid = center();
+                return _centroid;
+            }
 
             double coefficient = 3 * area;
-            return Point2d(xSum / coefficient, ySum / coefficient);
+            _centroid = Point2d(xSum / coefficient, ySum / coefficient);
+            return _centroid;
         }
 
         Point2d center() {
@@ -169,7 +273,14 @@ namespace robosub {
         }
 
         Rect_<T> getBoundingRect() {
-            return Rect_<T>(top(), left(), width(), height());
+            return Rect_<T>(left(), top(), width(), height());
+        }
+
+        ///Pixels covered by the contour, including its last row and column
+        Rect getPixelBounds() {
+            calculateBoundingBoxDimensions();
+            return Rect((int) _topLeft.x, (int) _topLeft.y, (int) _boundingBox.width + 1,
+                        (int) _boundingBox.height + 1);
         }
 
         Point_<T> topLeft() {
@@ -183,19 +294,14 @@ namespace robosub {
         }
 
         double arcLength(bool closed) {
+            if (closed) return perimeter();
             return cv::arcLength(data, closed);
         }
 
+        ///Copy of the points; prefer getPointSpan() where a view is enough
         vector<Point_<T>> getPoints() {
-            vector<Point_<T>> array;
-            if (data.isContinuous()) {
-                array.assign((Point_<T> *) data.datastart, (Point_<T> *) data.dataend);
-            } else {
-                for (int i = 0; i < data.rows; ++i) {
-                    array.insert(array.end(), data.ptr<Point_<T>>(i), data.ptr<Point_<T>>(i) + data.cols);
-                }
-            }
-            return array;
+            PointSpan_<T> points = getPointSpan();
+            return vector<Point_<T>>(points.begin(), points.end());
         }
 
         Mat getMask(Size size) {
@@ -207,8 +313,49 @@ namespace robosub {
             return mask;
         }
 
+        ///Binary mask (0 or 255) of the contour covering only its bounding box within an image of imageSize
+        ///The mask is a view into scratch, which grows as needed and can be reused between contours.
+        ///bounds receives the image region covered by the mask; the mask is empty if the contour is off the image.
+        Mat getMask(Size imageSize, Mat &scratch, Rect &bounds) {
+            bounds = getPixelBounds() & Rect(Point(0, 0), imageSize);
+            if (bounds.empty()) return Mat();
+
+            if (scratch.type() != CV_8U || scratch.rows < bounds.height || scratch.cols < bounds.width) {
+                scratch.create(max(scratch.rows, bounds.height), max(scratch.cols, bounds.width), CV_8U);
+            }
+            Mat mask = scratch(Rect(0, 0, bounds.width, bounds.height));
+            mask.setTo(0);
+            drawContours(mask, vector<Mat>{data}, 0, 255, cv::FILLED, LINE_8, noArray(), INT_MAX, -bounds.tl());
+            return mask;
+        }
+
         inline Scalar averageColor(Mat &img) {
-            return mean(img, getMask(Size(img.cols, img.rows)));
+            Mat scratch;
+            return averageColor(img, scratch);
+        }
+
+        ///Mean color of the enclosed pixels, reusing scratch for the mask
+        Scalar averageColor(const Mat &img, Mat &scratch) {
+            Rect bounds;
+            Mat mask = getMask(img.size(), scratch, bounds);
+            if (mask.empty()) return Scalar();
+            return mean(img(bounds), mask);
+        }
+
+        ///Area, mean color and moments of the enclosed pixels, reusing scratch for the mask
+        ContourStats stats(const Mat &img, Mat &scratch) {
+            ContourStats stats;
+            Mat mask = getMask(img.size(), scratch, stats.bounds);
+            if (mask.empty()) return stats;
+
+            stats.moments = cv::moments(mask, true);
+            stats.pixels = stats.moments.m00;
+            stats.meanColor = mean(img(stats.bounds), mask);
+            if (stats.pixels > 0) {
+                stats.centroid = Point2d(stats.bounds.x + stats.moments.m10 / stats.pixels,
+                                         stats.bounds.y + stats.moments.m01 / stats.pixels);
+            }
+            return stats;
         }
     };
 
@@ -227,19 +374,11 @@ namespace robosub {
         Rectangle_(vector<Point_<T>> &points) : Contour_<T>(points) {}
 
         double height() {
-            vector<Point_<T>> points = Contour_<T>::getPoints();
-            double side1 = Util::euclideanDistance(points.at(0).x, points.at(0).y, points.at(1).x, points.at(1).y);
-            double side2 = Util::euclideanDistance(points.at(2).x, points.at(2).y, points.at(3).x, points.at(3).y);
-
-            return (side1 + side2) / 2;
+            return (this->sideLength(0) + this->sideLength(2)) / 2;
         }
 
         double width() {
-            vector<Point_<T>> points = Contour_<T>::getPoints();
-            double side1 = Util::euclideanDistance(points.at(1).x, points.at(1).y, points.at(2).x, points.at(2).y);
-            double side2 = Util::euclideanDistance(points.at(0).x, points.at(0).y, points.at(3).x, points.at(3).y);
-
-            return (side1 + side2) / 2;
+            return (this->sideLength(1) + this->sideLength(3)) / 2;
         }
     };
 
@@ -258,27 +397,17 @@ namespace robosub {
 
         Triangle_(vector<Point_<T>> &points) : Contour_<T>(points) {}
 
-        double height() {
-            vector<Point_<T>> points = Contour_<T>::getPoints();
-
-            double side1 = Util::euclideanDistance(points.at(0).x, points.at(0).y, points.at(1).x, points.at(1).y);
-            double side2 = Util::euclideanDistance(points.at(1).x, points.at(1).y, points.at(2).x, points.at(2).y);
-            double side3 = Util::euclideanDistance(points.at(2).x, points.at(2).y, points.at(0).x, points.at(0).y);
-            double hypotenuse = max(max(side1, side2), side3);
-
-            double height = 2 * this->area() / hypotenuse;
+        ///Longest side
+        double hypotenuse() {
+            return max(max(this->sideLength(0), this->sideLength(1)), this->sideLength(2));
+        }
 
-            return height;
+        double height() {
+            return 2 * this->area() / hypotenuse();
         }
 
         double width() {
-            vector<Point_<T>> points = Contour_<T>::getPoints();
-            double side1 = Util::euclideanDistance(points.at(0).x, points.at(0).y, points.at(1).x, points.at(1).y);
-            double side2 = Util::euclideanDistance(points.at(1).x, points.at(1).y, points.at(2).x, points.at(2).y);
-            double side3 = Util::euclideanDistance(points.at(2).x, points.at(2).y, points.at(0).x, points.at(0).y);
-            double hypotenuse = max(max(side1, side2), side3);
-
-            return hypotenuse;
+            return hypotenuse();
         }
     };
 
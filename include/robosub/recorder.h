@@ -0,0 +1,128 @@
+#pragma once
+
+#include "common.h"
+#include "timeutil.h"
+#include "framelog.h"
+#include <opencv2/opencv.hpp>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+namespace robosub {
+    ///Records video streams to disk on background writer threads
+    ///Each stream has a bounded queue so that a slow disk never stalls the thread producing frames.
+    class Recorder {
+    public:
+        ///What to do when a stream's queue is full
+        enum DropPolicy {
+            ///Discard the frame being recorded
+            DROP_NEWEST,
+            ///Discard the oldest queued frame to make room
+            DROP_OLDEST,
+            ///Wait for the writer to free a slot
+            BLOCK
+        };
+
+        enum Format {
+            ///Motion JPEG in an AVI container (cv::VideoWriter)
+            MJPEG_AVI,
+            ///Frame log (framelog.h) with uncompressed frames
+            RAW,
+            ///Frame log (framelog.h) with JPEG-compressed frames
+            JPEG
+        };
+
+        struct StreamConfig {
+            string path;
+            Format format = MJPEG_AVI;
+            ///Frame rate stored in the container (MJPEG_AVI only)
+            double frameRate = 30.0;
+            ///Maximum number of frames waiting to be written
+            int queueLength = 30;
+            DropPolicy dropPolicy = DROP_OLDEST;
+            ///Disk space to reserve up front with fallocate (frame logs only, 0 to disable)
+            long long preallocateBytes = 0;
+            ///Stream id stored with every frame (frame logs only)
+            int logStreamId = 0;
+            ///JPEG quality, 0-100 (JPEG only)
+            int jpegQuality = 90;
+        };
+
+        struct Stats {
+            unsigned long long received = 0;
+            unsigned long long written = 0;
+            unsigned long long dropped = 0;
+            unsigned long long writeErrors = 0;
+            size_t queueDepth = 0;
+            size_t maxQueueDepth = 0;
+        };
+
+    private:
+        struct Entry {
+            Mat frame;
+            long long timestamp;
+        };
+
+        struct Stream {
+            StreamConfig config;
+
+            std::mutex lock;
+            std::condition_variable notEmpty;
+            std::condition_variable notFull;
+            std::deque<Entry> queue;
+            vector<Mat> spare;
+            int reserved = 0;
+            bool stopping = false;
+
+            VideoWriter writer;
+            FrameLogWriter log;
+
+            std::atomic<unsigned long long> received;
+            std::atomic<unsigned long long> written;
+            std::atomic<unsigned long long> dropped;
+            std::atomic<unsigned long long> writeErrors;
+            size_t maxQueueDepth = 0;
+
+            std::thread thread;
+
+            Stream() : received(0), written(0), dropped(0), writeErrors(0) {}
+        };
+
+        std::mutex streamsLock;
+        vector<std::shared_ptr<Stream>> streams;
+
+        std::shared_ptr<Stream> getStream(int stream);
+
+        static void writerLoop(Stream *stream);
+        static bool writeFrame(Stream *stream, Entry &entry);
+        static void finishStream(Stream *stream);
+
+    public:
+        Recorder();
+        ///Flushes every queued frame and closes all files
+        ~Recorder();
+
+        Recorder(const Recorder &) = delete;
+        Recorder &operator=(const Recorder &) = delete;
+
+        ///Open a new output stream and start its writer thread
+        ///Returns the stream id used by record()
+        int addStream(const StreamConfig &config);
+
+        ///Queue a copy of the frame for writing
+        ///The timestamp is in microseconds (Time::micros()); -1 stamps the frame with the current time.
+        ///Returns false if the frame was dropped.
+        bool record(int stream, const Mat &frame, long long timestamp = -1);
+
+        ///Write all queued frames of a stream, then close its file
+        void closeStream(int stream);
+        ///Write all queued frames of every stream, then close all files
+        void stop();
+
+        bool isOpen(int stream);
+        Stats getStats(int stream);
+    };
+}
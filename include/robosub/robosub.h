@@ -25,11 +25,25 @@ BOOL APIENTRY DllMain(HMODULE hModule,
 #include "timeutil.h"
 #include "fps.h"
 #include "util.h"
+#include "framesource.h"
+#include "framelog.h"
 #include "videoio.h"
 #include "image.h"
+#include "hud.h"
 #include "networkudp.h"
 #include "networkvideo.h"
+#include "recorder.h"
+#include "streamadapter.h"
+#include "threadpool.h"
+#include "pipeline.h"
+#include "matpool.h"
 #include "telemetry.h"
 #include "serial.h"
 #include "image-processing/shape_recognition.h"
+#include "image-processing/tuning_dataset.h"
 #include "image-processing/parametertuning.h"
+#include "image-processing/color_segmentation.h"
+#include "image-processing/frame_pyramid.h"
+#include "image-processing/frame_quality.h"
+#include "image-processing/tracking.h"
+#include "image-processing/visual_odometry.h"
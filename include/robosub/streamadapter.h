@@ -0,0 +1,80 @@
+#pragma once
+
+#include "common.h"
+#include "timeutil.h"
+#include <opencv2/opencv.hpp>
+
+namespace robosub {
+    ///Steps a video stream between quality presets depending on how well the link keeps up
+    ///Stepping down reacts quickly to congestion; stepping up waits for a longer clear period so the stream
+    ///does not oscillate around the link capacity.
+    class StreamAdapter {
+    public:
+        struct Preset {
+            Size frameSize;
+            double frameRate;
+        };
+
+        struct Settings {
+            ///Presets ordered from highest to lowest quality
+            vector<Preset> presets;
+            ///Congested when more than this many frames wait in the socket send queue
+            double maxQueuedFrames = 1.0;
+            ///Congested when sending a frame takes more than this fraction of the frame interval
+            double maxSendFraction = 0.8;
+            ///Congested when the receiver reports fewer than this fraction of the frames sent
+            double minDeliveryRatio = 0.8;
+            ///Seconds of continuous congestion before stepping down
+            double downgradeDelay = 1.0;
+            ///Seconds of continuous clear link before stepping up
+            double upgradeDelay = 8.0;
+            ///Receiver feedback older than this (seconds) is ignored
+            double feedbackTimeout = 3.0;
+        };
+
+    private:
+        Settings settings;
+        int preset = 0;
+
+        //smoothed link observations
+        double queuedFrames = 0;
+        double sendFraction = 0;
+        double sentFrameRate = 0;
+        double receivedFrameRate = -1;
+        long long lastSend = -1;
+        long long lastFeedback = -1;
+
+        long long congestedSince = -1;
+        long long clearSince = -1;
+
+        void reset();
+
+    public:
+        EXPORT explicit StreamAdapter(const Settings &settings);
+
+        ///Default presets: 1280x720 down to 320x180, with lower frame rates at the bottom
+        EXPORT static Settings defaultSettings();
+
+        ///Report a sent frame: bytes still queued in the socket after sending, size of the frame,
+        ///and time spent blocked in send calls (microseconds)
+        EXPORT void reportSend(long long queuedBytes, long long frameBytes, long long sendMicros);
+        ///Report the frame rate that the receiver displayed
+        EXPORT void reportFeedback(double receivedFrameRate);
+
+        ///Evaluate the latest observations. Returns true when the preset changed.
+        EXPORT bool update();
+
+        EXPORT int getPresetIndex();
+        EXPORT int getPresetCount();
+        EXPORT Preset getPreset();
+        ///Force a preset, e.g. when a new client connects
+        EXPORT void setPresetIndex(int index);
+
+        ///Smoothed number of frames waiting in the send queue
+        EXPORT double getQueuedFrames();
+        ///Measured send rate in frames per second
+        EXPORT double getSentFrameRate();
+        ///Latest receiver frame rate, or -1 without recent feedback
+        EXPORT double getReceivedFrameRate();
+    };
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include "common.h"
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace robosub {
+    ///Fixed set of worker threads that run queued tasks in order of submission
+    class ThreadPool {
+    private:
+        std::mutex lock;
+        std::condition_variable available;
+        std::deque<std::function<void()>> tasks;
+        vector<std::thread> workers;
+        bool stopping = false;
+
+        void workerLoop(int index);
+
+    public:
+        ///Start a pool with a number of threads; 0 uses one thread per hardware core
+        EXPORT explicit ThreadPool(int threads = 0);
+        ///Runs every queued task, then stops the threads
+        EXPORT ~ThreadPool();
+
+        ThreadPool(const ThreadPool &) = delete;
+        ThreadPool &operator=(const ThreadPool &) = delete;
+
+        EXPORT int getThreadCount();
+
+        ///Index of the calling thread among this pool's workers (0 to getThreadCount() - 1), or -1 when it is
+        ///not one of them, e.g. the caller's own thread or a worker of another pool
+        ///Use it to pick per-worker scratch buffers, with a separate one for -1.
+        EXPORT int currentWorker() const;
+
+        ///Queue a task without waiting for a result
+        EXPORT void enqueue(std::function<void()> task);
+
+        ///Queue a task; the future returns its result or rethrows its exception
+        template<class F>
+        auto submit(F task) -> std::future<decltype(task())> {
+            typedef decltype(task()) R;
+            std::shared_ptr<std::packaged_task<R()>> packaged = std::make_shared<std::packaged_task<R()>>(task);
+            std::future<R> result = packaged->get_future();
+            enqueue([packaged]() { (*packaged)(); });
+            return result;
+        }
+
+        ///Run body(i) for every i in [begin, end) on the pool and wait for all of them
+        ///Runs inline when called from one of the pool's own workers, so it never deadlocks.
+        EXPORT void parallelFor(int begin, int end, const std::function<void(int)> &body);
+    };
+}
@@ -22,7 +22,15 @@ namespace robosub
 		///Pause the running thread just until other threads have finished
 		EXPORT static void wait();
 		///Get accurate timestamp in milliseconds
+		///This clock is monotonic and never jumps when the system time is changed
 		EXPORT static long long millis();
+		///Get accurate monotonic timestamp in microseconds
+		EXPORT static long long micros();
+		///Get accurate monotonic timestamp in nanoseconds
+		EXPORT static long long nanos();
+		///Get wall clock time in milliseconds since the Unix epoch
+		///Use this only for timestamps shown to humans or sent between machines
+		EXPORT static long long epochMillis();
 	};
 
 	class Stopwatch
@@ -37,5 +45,62 @@ namespace robosub
 		EXPORT void reset();
 		///Get time elapsed in milliseconds
 		EXPORT long long elapsed();
+		///Get time elapsed in microseconds
+		EXPORT long long elapsedMicros();
+	};
+
+	///Sleeps on absolute deadlines so that a loop runs at an exact rate
+	///Deadlines never drift: a slow iteration does not delay the ones after it
+	class PeriodicTimer
+	{
+	public:
+		///Timing statistics since the timer was created or reset
+		struct Stats
+		{
+			unsigned long long ticks = 0;
+			///Number of calls to wait() that found the deadline already passed
+			unsigned long long overruns = 0;
+			///Number of whole periods skipped because of overruns
+			unsigned long long missedPeriods = 0;
+			///Wake-up latency past the deadline, in microseconds
+			double jitterMin = 0;
+			double jitterMax = 0;
+			double jitterMean = 0;
+			double jitterStdDev = 0;
+		};
+
+	private:
+		long long periodNanos;
+		long long nextDeadline;
+
+		unsigned long long ticks;
+		unsigned long long overruns;
+		unsigned long long missedPeriods;
+		unsigned long long jitterSamples;
+		long long jitterMin;
+		long long jitterMax;
+		double jitterSum;
+		double jitterSqSum;
+
+		static void sleepUntil(long long deadlineNanos);
+
+	public:
+		///Create a timer that fires every periodMicros microseconds, starting one period from now
+		EXPORT explicit PeriodicTimer(long long periodMicros);
+
+		///Create a timer that fires at a given frequency
+		EXPORT static PeriodicTimer fromFrequency(double hz);
+
+		///Sleep until the next deadline
+		///Returns the number of periods missed since the previous call (0 when on time)
+		EXPORT int wait();
+		///Restart the schedule one period from now and clear statistics
+		EXPORT void reset();
+
+		///Change the period. The new period applies from the next deadline on.
+		EXPORT void setPeriodMicros(long long periodMicros);
+		EXPORT long long getPeriodMicros();
+
+		EXPORT Stats getStats();
 	};
 }
@@ -4,6 +4,7 @@
 #include "time.h"
 #include "fps.h"
 #include "util.h"
+#include "framesource.h"
 #include <opencv2/opencv.hpp>
 
 namespace robosub
@@ -14,13 +15,10 @@ namespace robosub
 		int frame;
 		long long startTime;
 		long long lastTime;
-		bool liveStream = false;
-		bool init = false;
 
 		void updateRetrieveTime();
-		bool testLiveStream();
 
-		VideoCapture* cap;
+		FrameSource* source;
 		FPS* fps;
 
 	public:
@@ -52,6 +50,9 @@ namespace robosub
 		EXPORT Camera(int index);
 		///Begin capturing using a recorded file or IP camera
 		EXPORT Camera(string file);
+		///Begin capturing from any frame source (replay, synthetic, ...)
+		///The camera takes ownership of the source.
+		EXPORT Camera(FrameSource* source);
 		///Camera destructor
 		EXPORT ~Camera();
 
@@ -74,6 +75,11 @@ namespace robosub
 		EXPORT static CalibrationData* loadCalibrationDataFromXML(const string filename, const Size frameSize);
 		///Undistort frame
 		EXPORT static Mat undistort(Mat& input, CalibrationData& calib);
+		///Undistort into output, reusing its buffer when it already has the right size and type
+		EXPORT static void undistort(Mat& input, Mat& output, CalibrationData& calib);
+		///Compute the remap tables (CV_16SC2 + CV_16UC1) that undistort frames of a given size
+		///remap(frame, output, map1, map2, INTER_LINEAR, BORDER_CONSTANT) then matches undistort() without recomputing the tables.
+		EXPORT static void initUndistortMaps(Size frameSize, CalibrationData& calib, Mat& map1, Mat& map2);
 		///Compute optimal undistorted points
 		EXPORT static void undistortPoints(InputArray& points, OutputArray& undistortedPoints, CalibrationData& calib);
 
@@ -95,5 +101,7 @@ namespace robosub
 		EXPORT long getFrameCount();
 		///Returns true if live stream, false if reading from file
 		EXPORT bool isLiveStream();
+		///Get the backend that produces frames
+		EXPORT FrameSource* getSource();
 	};
 }
@@ -10,9 +10,13 @@
 
 extern bool running;
 extern bool refresh;
-extern long controllerTime;
+extern long long controllerTime;
 extern mutex drawLock;
 
+//rates of the controller polling and robot communication loops (Hz)
+const double CONTROL_LOOP_RATE = 100.0;
+const double NETWORK_LOOP_RATE = 100.0;
+
 struct ReadoutData{
     int scale;
 
@@ -20,6 +20,7 @@ void control(ThreadData* threaddata) {
     threaddata->controller2->setJoystick(SDL_JoystickOpen(1));
 
     SDL_Event event;
+    robosub::PeriodicTimer loopTimer = robosub::PeriodicTimer::fromFrequency(CONTROL_LOOP_RATE);
     //main loop
     while (running) {
 
@@ -39,8 +40,8 @@ void control(ThreadData* threaddata) {
             threaddata->controller2->setJoystick(SDL_JoystickOpen(1));
         }
 
-        controllerTime = robosub::Time::millis(); //add current timestamp
-        robosub::Time::waitMillis(1); //prevent pinning the processor at 100%
+        controllerTime = robosub::Time::epochMillis(); //add current timestamp, on the same clock as "time"
+        loopTimer.wait(); //poll at a fixed rate instead of pinning the processor
     }
 
     SDL_Quit();
@@ -11,7 +11,7 @@ using namespace robosub;
 bool running = true;
 bool refresh = false;
 
-long controllerTime;
+long long controllerTime;
 mutex drawLock;
 
 ReadoutData readoutData;
@@ -60,7 +60,7 @@ void send(shared_ptr<typename T::Connection> connection,
           ConnectionState &connectionState,
           DataBucket &connectionData,
           DataBucket &current,
-          unsigned long milliseconds_since_epoch,
+          unsigned long long milliseconds_since_epoch,
           bool compress
 ) {
     if (!connectionState.ready) return;
@@ -189,10 +189,11 @@ void network(ThreadData* threaddata) {
     });
 
     DataBucket previousState;
+    PeriodicTimer loopTimer = PeriodicTimer::fromFrequency(NETWORK_LOOP_RATE);
 
     int i = 0;
     while (true) {
-        current["index"] = (i++ / 1000) % 1000; //force refresh approx every second
+        current["index"] = (i++ / (int) NETWORK_LOOP_RATE) % 1000; //force refresh approx every second
         current["robot_connected"] = clientConnected;
 
         try {
@@ -212,9 +213,9 @@ void network(ThreadData* threaddata) {
             threaddata->readout->valid = false;
         }
 
-        robosub::Time::waitMillis(1);
+        loopTimer.wait();
 
-        unsigned long milliseconds_since_epoch = robosub::Time::millis();
+        unsigned long long milliseconds_since_epoch = robosub::Time::epochMillis();
 
         threaddata->controller1->controllerDataBucket(current, "controller1");
         threaddata->controller2->controllerDataBucket(current, "controller2");
@@ -5,6 +5,8 @@
 #include <opencv2/opencv.hpp>
 
 static const int SERVER_PORT = 8081;
+//rate of the telemetry/control loop in the server thread (Hz)
+static const double SERVER_LOOP_RATE = 100.0;
 
 extern bool running;
 
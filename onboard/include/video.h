@@ -1,2 +1,8 @@
 #pragma once
 
+#include "main.h"
+
+void startVideo();
+
+///Add the stream preset of every camera feed to the telemetry bucket
+void updateVideoTelemetry(DataBucket &current);
\ No newline at end of file
@@ -11,6 +11,8 @@ void server();
 void startVideo();
 
 int main(int argc, char **argv) {
+    //frame buffers are reused instead of reallocated for every captured frame
+    MatPool::shared().install();
     initRobotState();
 
     //start server thread
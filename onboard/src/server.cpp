@@ -1,5 +1,6 @@
 #include "main.h"
 #include "robot.h"
+#include "video.h"
 
 using WsServer = robosub::ws::SocketServer<robosub::ws::WS>;
 using WsClient = robosub::ws::SocketClient<robosub::ws::WS>;
@@ -134,16 +135,28 @@ void server() {
 
     int i = 0;
     Telemetry telemetry = Telemetry();
+    PeriodicTimer loopTimer = PeriodicTimer::fromFrequency(SERVER_LOOP_RATE);
+    Stopwatch loopStatsTimer;
 
     while (running) {
 //        current["index"] = i++ % 1000; //force refresh approx every second
         current["cpu"] = Util::round<double>(telemetry.getSystemCPUUsage(), 0);
         current["ram"] = Util::round<double>(telemetry.getSystemRAMUsage(), 0);
 
-        robosub::Time::waitMicros(1); //tight loop, just not so tight as to peg the processor at 100%
-        unsigned long milliseconds_since_epoch = robosub::Time::millis();
+        //report loop timing about once a second so it does not force a send every iteration
+        if (loopStatsTimer.elapsed() >= 1000) {
+            PeriodicTimer::Stats stats = loopTimer.getStats();
+            current["loop"]["overruns"] = stats.overruns;
+            current["loop"]["jitter"] = Util::round<double>(stats.jitterMean, 0); //microseconds
+            current["loop"]["jitterMax"] = Util::round<double>(stats.jitterMax, 0);
+            loopStatsTimer.reset();
+        }
+
+        loopTimer.wait(); //sleep until the next period instead of busy polling
+        unsigned long long milliseconds_since_epoch = robosub::Time::epochMillis();
 
         updateRobotTelemetry(current);
+        updateVideoTelemetry(current);
 
         //send data to connections
         for (auto &connection : server.get_connections()) {
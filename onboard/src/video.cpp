@@ -1,16 +1,124 @@
 #include "main.h"
+#include "video.h"
 #include <mutex>
+#include <condition_variable>
 
 const int VERIFICATION_CODE = 1234567890;
+//leads the 16 byte feedback message that video-control sends back about once a second
+const int FEEDBACK_CODE = 1234567891;
 const int PORT[5] = {8500, 8501, 8502, 8503, 8504};
 const String STEREO_ID = "usb-SHENZHEN_RERVISION_TECHNOLOGY_Stereo_Vision_2-video-index0";
+//v4l by-id name of the downward-facing camera, whose motion over the floor is estimated on every frame;
+//empty disables visual odometry
+const String DOWNWARD_ID = "";
 mutex drawLock;
 
+//raw copies of every camera feed are archived on the robot when this directory exists
+const String ARCHIVE_DIR = "archive/";
+const long long ARCHIVE_PREALLOCATE_BYTES = 4ll << 30;
+const int ARCHIVE_QUEUE_LENGTH = 8;
+Recorder archive;
+
+//apply stream presets by reconfiguring the camera; otherwise captured frames are downscaled before sending
+const bool RESIZE_CAMERA = false;
+
+//current preset and image quality of every feed, and the downward camera's motion, reported in telemetry
+mutex videoStatusLock;
+json videoStatus;
+
+//newest frame of a feed, handed from its capture loop to its network sender
+struct LatestFrame {
+    mutex lock;
+    condition_variable ready;
+    Mat frame;
+    //counts captured frames, so the sender never sends one twice
+    long long sequence = 0;
+    //frame size the sender wants from the camera, applied by the capture loop between frames
+    Size requestedSize;
+};
+
+void updateVideoTelemetry(DataBucket &current) {
+    lock_guard<mutex> guard(videoStatusLock);
+    if (!videoStatus.is_null()) current["video"] = videoStatus;
+}
+
+void publishPreset(int port, StreamAdapter &adapter) {
+    StreamAdapter::Preset preset = adapter.getPreset();
+    lock_guard<mutex> guard(videoStatusLock);
+    json &status = videoStatus[to_string(port)];
+    status["preset"] = adapter.getPresetIndex();
+    status["width"] = preset.frameSize.width;
+    status["height"] = preset.frameSize.height;
+    status["fps"] = preset.frameRate;
+}
+
+void publishQuality(int port, const FrameQualityMonitor::Metrics &metrics) {
+    lock_guard<mutex> guard(videoStatusLock);
+    json &quality = videoStatus[to_string(port)]["quality"];
+    quality["focus"] = metrics.focus;
+    quality["median"] = metrics.p50;
+    quality["contrast"] = metrics.contrast;
+    quality["turbidity"] = metrics.turbidity;
+    quality["usable"] = metrics.usable();
+    quality["problems"] = FrameQualityMonitor::describe(metrics.problems);
+}
+
+void publishMotion(int port, const VisualOdometry::Motion &motion) {
+    lock_guard<mutex> guard(videoStatusLock);
+    json &odometry = videoStatus[to_string(port)]["odometry"];
+    odometry["timestamp"] = motion.timestamp;
+    odometry["valid"] = motion.valid;
+    odometry["dx"] = motion.translation.x;
+    odometry["dy"] = motion.translation.y;
+    odometry["yaw"] = motion.yaw;
+    odometry["vx"] = motion.velocity.x;
+    odometry["vy"] = motion.velocity.y;
+    odometry["yawRate"] = motion.yawRate;
+    odometry["inliers"] = motion.inliers;
+    odometry["micros"] = motion.processingMicros;
+}
+
 void catchSignal(int signal) {
     running = false;
 }
 
-void cameraThread(int port, String cameraName) {
+//reads every frame the camera delivers, independent of the stream rate and of the client connection:
+//archives it, checks its quality, estimates motion on the downward feed and offers it to the sender
+void captureLoop(int port, Camera *cam, bool downward, int archiveStream, LatestFrame &latest) {
+    FrameQualityMonitor quality;
+    FramePyramid pyramid;
+    VisualOdometry odometry;
+    Mat captured;
+
+    while (running) {
+        if (!cam->retrieveFrameBGR(captured)) {
+            robosub::Time::waitMillis(10);
+            continue;
+        }
+        long long captureMicros = robosub::Time::micros();
+        if (archiveStream >= 0) archive.record(archiveStream, captured);
+        pyramid.reset(captured);
+        publishQuality(port, quality.analyze(pyramid));
+        //runs on the level the quality monitor just built
+        if (downward) publishMotion(port, odometry.process(pyramid, captureMicros));
+
+        Size requestedSize;
+        {
+            lock_guard<mutex> guard(latest.lock);
+            captured.copyTo(latest.frame);
+            latest.sequence++;
+            requestedSize = latest.requestedSize;
+            latest.requestedSize = Size();
+        }
+        latest.ready.notify_all();
+        if (requestedSize.area() > 0) cam->setFrameSize(requestedSize);
+    }
+
+    //wake a sender still waiting for a frame
+    latest.ready.notify_all();
+}
+
+void cameraThread(int port, String cameraName, bool downward) {
     signal(SIGPIPE, catchSignal);
 
     Camera *cam;
@@ -19,18 +127,40 @@ void cameraThread(int port, String cameraName) {
         cout << "Camera failed to open." << endl;
         return;
     }
-    Size frameSize = Size(1280, 720);
+    StreamAdapter adapter(StreamAdapter::defaultSettings());
+    Size frameSize = adapter.getPreset().frameSize;
 
     frameSize = cam->setFrameSize(frameSize);
     cout << frameSize << endl;
-    int cols = frameSize.width;
-    int rows = frameSize.height;
-    const int datalen = rows * cols * 3 + 16;
+    //sized for the largest frame that can be sent; presets only ever shrink it
+    const int maxdatalen = max(frameSize.area(), adapter.getPreset().frameSize.area()) * 3 + 16;
     NetworkTcpServer server;
 
-    char *senddata = (char *) malloc(datalen);
+    char *senddata = (char *) malloc(maxdatalen);
+    char feedback[16];
+    int feedbackLen = 0;
     Mat frame1;
 
+    int archiveStream = -1;
+    if (Util::directoryExists(ARCHIVE_DIR)) {
+        Recorder::StreamConfig config;
+        config.path = ARCHIVE_DIR + "camera" + to_string(port) + ".rsfl";
+        config.format = Recorder::RAW;
+        config.logStreamId = port;
+        config.queueLength = ARCHIVE_QUEUE_LENGTH;
+        config.dropPolicy = Recorder::DROP_OLDEST;
+        config.preallocateBytes = ARCHIVE_PREALLOCATE_BYTES;
+        try {
+            archiveStream = archive.addStream(config);
+            cout << "Archiving to " << config.path << endl;
+        } catch (exception &e) {
+            cout << "Archive disabled: " << e.what() << endl;
+        }
+    }
+
+    LatestFrame latest;
+    thread capture(captureLoop, port, cam, downward, archiveStream, std::ref(latest));
+
     cout << "Unbinding from port" << endl;
     server.unbindFromPort();
 
@@ -43,22 +173,52 @@ void cameraThread(int port, String cameraName) {
     cout << "Connected." << endl;
 
     float uploadBitsPerSecond = 0;
+    FramePyramid pyramid;
+    long long sentSequence = 0;
+    PeriodicTimer sendTimer = PeriodicTimer::fromFrequency(adapter.getPreset().frameRate);
+    publishPreset(port, adapter);
 
     while (running) {
+        sendTimer.wait();
+
+        //the newest captured frame; frames captured in between are skipped
+        {
+            unique_lock<mutex> guard(latest.lock);
+            latest.ready.wait(guard, [&]() { return latest.sequence != sentSequence || !running; });
+            if (!running) break;
+            latest.frame.copyTo(frame1);
+            sentSequence = latest.sequence;
+        }
+
+        //the archive keeps full resolution; only the network stream is downscaled
+        //presets at half or quarter size are taken from a pyramid over the frame
+        StreamAdapter::Preset preset = adapter.getPreset();
+        pyramid.reset(frame1);
+        //a separate header, so frame1 and the pyramid levels keep their own buffers for the next frame
+        int streamLevel = pyramid.findLevel(preset.frameSize);
+        Mat sendFrame = streamLevel > 0 ? pyramid.level(streamLevel) : frame1;
+        if (streamLevel <= 0 && sendFrame.size() != preset.frameSize)
+            ImageTransform::scale(sendFrame, preset.frameSize);
 
-        cam->retrieveFrameBGR(frame1);
+        int cols = sendFrame.cols;
+        int rows = sendFrame.rows;
+        int datalen = rows * cols * 3 + 16;
+        if (datalen > maxdatalen) continue;
 
         *(int *) (senddata + 0) = VERIFICATION_CODE;
         *(int *) (senddata + 4) = cols;
         *(int *) (senddata + 8) = rows;
-        *(int *) (senddata + 12) = 0;
-        memcpy(senddata + 16, frame1.data, rows * cols * 3);
+        *(int *) (senddata + 12) = adapter.getPresetIndex();
+        memcpy(senddata + 16, sendFrame.data, rows * cols * 3);
 
         //test: break the frame into 100 segments and send one every 100 us (10 ms per frame)
         int segmentsize = datalen / 100;
         int numsegments = datalen / segmentsize + 1;
+        long long sendMicros = 0;
         for (int i = 0; i < numsegments; i++) {
+            long long sendStart = robosub::Time::micros();
             int ecode = server.sendBuffer(senddata + segmentsize * i, min(segmentsize, datalen - segmentsize * i));
+            sendMicros += robosub::Time::micros() - sendStart;
             if (ecode != 0) {
                 cout << "Send error: " << ecode << " " << strerror(ecode) << endl;
                 // wait to reconnect
@@ -68,16 +228,40 @@ void cameraThread(int port, String cameraName) {
                 server.bindToPort(port);
                 cout << "Accepting client." << endl;
                 server.acceptClient();
-
+                feedbackLen = 0;
             }
 
             robosub::Time::waitMicros(100);
         }
+        adapter.reportSend(server.getSendQueueBytes(), datalen, sendMicros);
 
-        uploadBitsPerSecond = ((float) cam->getFrameRate()) * ((float) ((rows * cols * 3 + 16) * 8));
+        //receiver feedback: verification code, then displayed frames per second * 1000
+        int numread;
+        while ((numread = server.pollBuffer(feedback + feedbackLen, (int) sizeof(feedback) - feedbackLen)) > 0) {
+            feedbackLen += numread;
+            if (feedbackLen < (int) sizeof(feedback)) continue;
+            if (*(int *) (feedback + 0) == FEEDBACK_CODE) adapter.reportFeedback(*(int *) (feedback + 4) / 1000.0);
+            feedbackLen = 0;
+        }
+
+        if (adapter.update()) {
+            preset = adapter.getPreset();
+            if (RESIZE_CAMERA) {
+                lock_guard<mutex> guard(latest.lock);
+                latest.requestedSize = preset.frameSize;
+            }
+            sendTimer.setPeriodMicros((long long) (1e6 / preset.frameRate));
+            publishPreset(port, adapter);
+            cout << port << ": stream preset " << adapter.getPresetIndex() << " " << preset.frameSize << " @ "
+                 << preset.frameRate << " fps" << endl;
+        }
+
+        uploadBitsPerSecond = ((float) preset.frameRate) * ((float) (datalen * 8));
 
         waitKey(1);
     }
+
+    capture.join();
 }
 
 void startVideo() {
@@ -87,6 +271,7 @@ void startVideo() {
     String deviceNameStr = Util::execCLI("ls /dev/v4l/by-id/");
     vector<String> deviceNames = Util::splitString(deviceNameStr, '\n');
     bool stereoFound = false;
+    String downwardIndex;
     //link camera id to port
     for (int i = 0; i < deviceNames.size(); i++) {
         if (STEREO_ID == deviceNames.at(i)) {
@@ -97,6 +282,7 @@ void startVideo() {
 
         String camIndex = Util::execCLI(String("readlink -f /dev/v4l/by-id/") + String(deviceNames.at(i)));
         camIndex.pop_back();
+        if (!DOWNWARD_ID.empty() && DOWNWARD_ID == deviceNames.at(i)) downwardIndex = camIndex;
         //find the camIndex in deviceIndexes then swap it into i
 
         auto it = std::find(deviceIndexes.begin(), deviceIndexes.end(), camIndex);
@@ -116,7 +302,7 @@ void startVideo() {
     thread cameraThreads[numFeeds];
     for (int i = 0; i < numFeeds; i++) {
         String d = deviceIndexes.at(i);
-        cameraThreads[i] = thread(cameraThread, PORT[i], d);
+        cameraThreads[i] = thread(cameraThread, PORT[i], d, !downwardIndex.empty() && d == downwardIndex);
     }
 
     for (int i = 0; i < numFeeds; i++) {
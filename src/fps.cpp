@@ -7,7 +7,7 @@ namespace robosub {
     }
 
     double FPS::frame() {
-        long long time = Time::millis();
+        long long time = Time::micros();
         if (_prevTime == 0) _prevTime = time;
 
         _currentSum -= _freqBuffer[_bufferPos];
@@ -20,6 +20,6 @@ namespace robosub {
 
     double FPS::fps() {
         if (_currentSum == 0) return 0;
-        return (1.0 / ((double) _currentSum / (double) BUFFER_LENGTH / 1000.0));
+        return (1.0 / ((double) _currentSum / (double) BUFFER_LENGTH / 1000000.0));
     }
 }
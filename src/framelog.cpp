@@ -0,0 +1,424 @@
+#include "robosub/framelog.h"
+
+#include <fcntl.h>
+#include <cerrno>
+#include <cstring>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <algorithm>
+#include <set>
+
+namespace robosub {
+    using namespace framelog;
+
+    static const char FILE_MAGIC[8] = {'R', 'S', 'F', 'L', 'O', 'G', '0', '1'};
+    static const char INDEX_MAGIC[8] = {'R', 'S', 'F', 'L', 'I', 'D', 'X', '1'};
+    static const uint32_t FRAME_MAGIC = 0x52465352; //"RSFR"
+    static const uint32_t VERSION = 1;
+    //frame headers and payloads start on 16 byte boundaries so mapped RAW frames are aligned
+    static const uint64_t ALIGNMENT = 16;
+
+    static_assert(sizeof(FileHeader) % ALIGNMENT == 0, "FileHeader must keep frames aligned");
+    static_assert(sizeof(FrameHeader) % ALIGNMENT == 0, "FrameHeader must keep payloads aligned");
+
+    static uint64_t padding(uint64_t size) {
+        return (ALIGNMENT - size % ALIGNMENT) % ALIGNMENT;
+    }
+
+    FrameLogWriter::FrameLogWriter() {
+    }
+
+    FrameLogWriter::~FrameLogWriter() {
+        close();
+    }
+
+    bool FrameLogWriter::writeAll(const void *data, size_t length) {
+        const char *p = (const char *) data;
+        while (length > 0) {
+            ssize_t n = ::write(fd, p, length);
+            if (n < 0) {
+                if (errno == EINTR) continue;
+                return false;
+            }
+            p += n;
+            length -= (size_t) n;
+        }
+        return true;
+    }
+
+    bool FrameLogWriter::open(const string &path, long long preallocateBytes) {
+        close();
+
+        std::lock_guard<std::mutex> guard(lock);
+        fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (fd < 0) return false;
+
+#ifdef __linux__
+        if (preallocateBytes > 0) {
+            //reserve contiguous blocks without changing the file size; not every filesystem supports this
+            fallocate(fd, FALLOC_FL_KEEP_SIZE, 0, (off_t) preallocateBytes);
+        }
+#endif
+
+        FileHeader header;
+        memset(&header, 0, sizeof(header));
+        memcpy(header.magic, FILE_MAGIC, sizeof(header.magic));
+        header.version = VERSION;
+        header.headerSize = sizeof(FileHeader);
+        if (!writeAll(&header, sizeof(header))) {
+            ::close(fd);
+            fd = -1;
+            return false;
+        }
+
+        offset = sizeof(FileHeader);
+        index.clear();
+        return true;
+    }
+
+    bool FrameLogWriter::isOpen() {
+        std::lock_guard<std::mutex> guard(lock);
+        return fd >= 0;
+    }
+
+    bool FrameLogWriter::write(uint32_t streamId, const Mat &frame, long long timestamp, Format format,
+                               int jpegQuality) {
+        if (frame.empty()) return false;
+        if (timestamp < 0) timestamp = Time::micros();
+
+        std::lock_guard<std::mutex> guard(lock);
+        if (fd < 0) return false;
+
+        FrameHeader header;
+        memset(&header, 0, sizeof(header));
+        header.magic = FRAME_MAGIC;
+        header.streamId = streamId;
+        header.timestamp = timestamp;
+        header.format = format;
+        header.rows = frame.rows;
+        header.cols = frame.cols;
+        header.type = frame.type();
+
+        if (format == JPEG) {
+            vector<int> params = {cv::IMWRITE_JPEG_QUALITY, jpegQuality};
+            if (!imencode(".jpg", frame, encodeBuffer, params)) return false;
+            header.payloadSize = encodeBuffer.size();
+        } else {
+            header.payloadSize = (uint64_t) frame.total() * frame.elemSize();
+        }
+
+        bool ok = writeAll(&header, sizeof(header));
+        if (ok && format == JPEG) {
+            ok = writeAll(encodeBuffer.data(), encodeBuffer.size());
+        } else if (ok && frame.isContinuous()) {
+            ok = writeAll(frame.data, (size_t) header.payloadSize);
+        } else if (ok) {
+            size_t rowSize = (size_t) frame.cols * frame.elemSize();
+            for (int y = 0; ok && y < frame.rows; y++) ok = writeAll(frame.ptr(y), rowSize);
+        }
+
+        static const char zeros[ALIGNMENT] = {0};
+        uint64_t pad = padding(header.payloadSize);
+        if (ok && pad > 0) ok = writeAll(zeros, (size_t) pad);
+
+        if (!ok) {
+            //drop the partial record so that the next frame overwrites it
+            if (lseek(fd, (off_t) offset, SEEK_SET) >= 0) ftruncate(fd, (off_t) offset);
+            return false;
+        }
+
+        IndexEntry entry;
+        entry.timestamp = timestamp;
+        entry.offset = offset;
+        entry.streamId = streamId;
+        entry.format = format;
+        index.push_back(entry);
+
+        offset += sizeof(FrameHeader) + header.payloadSize + pad;
+        return true;
+    }
+
+    size_t FrameLogWriter::count() {
+        std::lock_guard<std::mutex> guard(lock);
+        return index.size();
+    }
+
+    bool FrameLogWriter::close() {
+        std::lock_guard<std::mutex> guard(lock);
+        if (fd < 0) return true;
+
+        Footer footer;
+        memset(&footer, 0, sizeof(footer));
+        footer.indexOffset = offset;
+        footer.count = index.size();
+        memcpy(footer.magic, INDEX_MAGIC, sizeof(footer.magic));
+
+        bool ok = index.empty() || writeAll(index.data(), index.size() * sizeof(IndexEntry));
+        ok = ok && writeAll(&footer, sizeof(footer));
+
+        ok = ::close(fd) == 0 && ok;
+        fd = -1;
+        index.clear();
+        return ok;
+    }
+
+    FrameLogReader::FrameLogReader() {
+    }
+
+    FrameLogReader::~FrameLogReader() {
+        close();
+    }
+
+    bool FrameLogReader::open(const string &path) {
+        close();
+
+        fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) return false;
+
+        struct stat st;
+        if (fstat(fd, &st) != 0 || (size_t) st.st_size < sizeof(FileHeader)) {
+            close();
+            return false;
+        }
+
+        mapSize = (size_t) st.st_size;
+        void *p = mmap(nullptr, mapSize, PROT_READ, MAP_SHARED, fd, 0);
+        if (p == MAP_FAILED) {
+            mapSize = 0;
+            close();
+            return false;
+        }
+        map = (const uchar *) p;
+
+        const FileHeader *header = (const FileHeader *) map;
+        if (memcmp(header->magic, FILE_MAGIC, sizeof(header->magic)) != 0 || header->version != VERSION) {
+            close();
+            return false;
+        }
+
+        //a log from a crashed writer has no index; recover every complete frame instead
+        if (!loadIndex()) scanIndex();
+
+        //streams are written by independent threads, so frames may be slightly out of order
+        std::stable_sort(index.begin(), index.end(), [](const IndexEntry &a, const IndexEntry &b) {
+            return a.timestamp < b.timestamp;
+        });
+        buildBuckets();
+        return true;
+    }
+
+    bool FrameLogReader::loadIndex() {
+        if (mapSize < sizeof(FileHeader) + sizeof(Footer)) return false;
+
+        const Footer *footer = (const Footer *) (map + mapSize - sizeof(Footer));
+        if (memcmp(footer->magic, INDEX_MAGIC, sizeof(footer->magic)) != 0) return false;
+        if (footer->indexOffset < sizeof(FileHeader) || footer->indexOffset > mapSize) return false;
+        if (footer->count != (mapSize - sizeof(Footer) - footer->indexOffset) / sizeof(IndexEntry)) return false;
+        if (footer->indexOffset + footer->count * sizeof(IndexEntry) + sizeof(Footer) != mapSize) return false;
+
+        const IndexEntry *entries = (const IndexEntry *) (map + footer->indexOffset);
+        for (uint64_t i = 0; i < footer->count; i++) {
+            if (entries[i].offset + sizeof(FrameHeader) > footer->indexOffset) return false;
+        }
+
+        index.assign(entries, entries + footer->count);
+        return true;
+    }
+
+    void FrameLogReader::scanIndex() {
+        index.clear();
+        uint64_t pos = sizeof(FileHeader);
+        while (pos + sizeof(FrameHeader) <= mapSize) {
+            const FrameHeader *header = (const FrameHeader *) (map + pos);
+            if (header->magic != FRAME_MAGIC) break;
+
+            uint64_t end = pos + sizeof(FrameHeader) + header->payloadSize + padding(header->payloadSize);
+            if (header->payloadSize > mapSize || end > mapSize) break; //frame cut off by the crash
+
+            IndexEntry entry;
+            entry.timestamp = header->timestamp;
+            entry.offset = pos;
+            entry.streamId = header->streamId;
+            entry.format = header->format;
+            index.push_back(entry);
+            pos = end;
+        }
+    }
+
+    void FrameLogReader::buildBuckets() {
+        buckets.clear();
+        if (index.empty()) return;
+
+        //about one frame per bucket, so a lookup only inspects a couple of entries
+        long long span = index.back().timestamp - index.front().timestamp;
+        bucketWidth = std::max(1LL, span / (long long) index.size() + 1);
+        size_t count = (size_t) (span / bucketWidth) + 1;
+
+        buckets.resize(count);
+        size_t j = 0;
+        for (size_t b = 0; b < count; b++) {
+            long long start = index.front().timestamp + (long long) b * bucketWidth;
+            while (j < index.size() && index[j].timestamp < start) j++;
+            buckets[b] = (uint32_t) j;
+        }
+    }
+
+    bool FrameLogReader::isOpen() {
+        return map != nullptr;
+    }
+
+    void FrameLogReader::close() {
+        if (map != nullptr) munmap((void *) map, mapSize);
+        map = nullptr;
+        mapSize = 0;
+        if (fd >= 0) ::close(fd);
+        fd = -1;
+        index.clear();
+        buckets.clear();
+    }
+
+    size_t FrameLogReader::size() {
+        return index.size();
+    }
+
+    const IndexEntry &FrameLogReader::entry(size_t i) {
+        return index.at(i);
+    }
+
+    vector<uint32_t> FrameLogReader::streams() {
+        std::set<uint32_t> ids;
+        for (const IndexEntry &e : index) ids.insert(e.streamId);
+        return vector<uint32_t>(ids.begin(), ids.end());
+    }
+
+    long long FrameLogReader::firstTimestamp() {
+        return index.empty() ? 0 : index.front().timestamp;
+    }
+
+    long long FrameLogReader::lastTimestamp() {
+        return index.empty() ? 0 : index.back().timestamp;
+    }
+
+    long FrameLogReader::seek(long long timestamp, int streamId) {
+        if (index.empty()) return -1;
+
+        long i = 0;
+        if (timestamp >= index.front().timestamp) {
+            size_t b = std::min((size_t) ((timestamp - index.front().timestamp) / bucketWidth), buckets.size() - 1);
+            i = std::min((long) buckets[b], (long) index.size() - 1);
+            while (i + 1 < (long) index.size() && index[i + 1].timestamp <= timestamp) i++;
+            while (i > 0 && index[i].timestamp > timestamp) i--;
+        }
+
+        if (streamId < 0) return i;
+        for (long j = i; j >= 0; j--) {
+            if (index[j].streamId == (uint32_t) streamId) return j;
+        }
+        for (long j = i + 1; j < (long) index.size(); j++) {
+            if (index[j].streamId == (uint32_t) streamId) return j;
+        }
+        return -1;
+    }
+
+    const FrameHeader *FrameLogReader::header(size_t i) {
+        if (i >= index.size()) return nullptr;
+        const FrameHeader *header = (const FrameHeader *) (map + index[i].offset);
+        if (header->magic != FRAME_MAGIC) return nullptr;
+        if (index[i].offset + sizeof(FrameHeader) + header->payloadSize > mapSize) return nullptr;
+        return header;
+    }
+
+    bool FrameLogReader::read(size_t i, Mat &img) {
+        const FrameHeader *h = header(i);
+        if (h == nullptr) return false;
+
+        if (h->format == JPEG) {
+            Mat buffer(1, (int) h->payloadSize, CV_8UC1, (void *) (h + 1));
+            cv::imdecode(buffer, cv::IMREAD_UNCHANGED, &img);
+            return !img.empty();
+        }
+
+        Mat frame;
+        if (!view(i, frame)) return false;
+        frame.copyTo(img);
+        return true;
+    }
+
+    bool FrameLogReader::view(size_t i, Mat &img) {
+        const FrameHeader *h = header(i);
+        if (h == nullptr || h->format != RAW) return false;
+        if (h->payloadSize != (uint64_t) h->rows * h->cols * CV_ELEM_SIZE(h->type)) return false;
+        img = Mat(h->rows, h->cols, h->type, (void *) (h + 1));
+        return true;
+    }
+
+    FrameLogFrameSource::FrameLogFrameSource(const string &path, int streamId, Playback playback, bool loop)
+            : ReplayFrameSource(30.0, playback, loop) {
+        if (!reader.open(path)) return;
+
+        if (streamId < 0) {
+            vector<uint32_t> ids = reader.streams();
+            if (ids.empty()) return;
+            streamId = (int) ids[0];
+        }
+        stream = (uint32_t) streamId;
+
+        for (size_t i = 0; i < reader.size(); i++) {
+            if (reader.entry(i).streamId == stream) frames.push_back(i);
+        }
+        if (frames.empty()) return;
+
+        long long span = reader.entry(frames.back()).timestamp - reader.entry(frames.front()).timestamp;
+        if (frames.size() > 1 && span > 0) {
+            frameRate = (double) (frames.size() - 1) * 1e6 / (double) span;
+            //hold the last frame for one average interval before looping
+            duration = span + span / (long long) (frames.size() - 1);
+        } else {
+            duration = (long long) (1e6 / frameRate);
+        }
+
+        Mat first;
+        if (reader.read(frames[0], first)) size = first.size();
+    }
+
+    bool FrameLogFrameSource::loadFrame(long index, Mat &img) {
+        if (index < 0 || index >= (long) frames.size()) return false;
+        return reader.read(frames[index], img);
+    }
+
+    long FrameLogFrameSource::frameCount() {
+        return (long) frames.size();
+    }
+
+    long long FrameLogFrameSource::frameTimeMicros(long index) {
+        if (frames.empty()) return 0;
+        if (index >= (long) frames.size()) return duration;
+        return reader.entry(frames[index]).timestamp - reader.entry(frames[0]).timestamp;
+    }
+
+    long long FrameLogFrameSource::durationMicros() {
+        return duration;
+    }
+
+    bool FrameLogFrameSource::isOpen() {
+        return reader.isOpen() && !frames.empty();
+    }
+
+    Size FrameLogFrameSource::getFrameSize() {
+        return size;
+    }
+
+    long long FrameLogFrameSource::getTimestamp() {
+        if (position < 0) return -1;
+        return reader.entry(frames[position]).timestamp;
+    }
+
+    bool FrameLogFrameSource::seekTimestamp(long long timestamp) {
+        long i = reader.seek(timestamp, (int) stream);
+        if (i < 0) return false;
+        vector<size_t>::iterator it = std::lower_bound(frames.begin(), frames.end(), (size_t) i);
+        if (it == frames.end()) return false;
+        return seek((long) (it - frames.begin()));
+    }
+}
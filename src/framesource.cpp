@@ -0,0 +1,403 @@
+#include "robosub/framesource.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+namespace robosub {
+    void CaptureFrameSource::testLiveStream() {
+        if (!isOpen()) return;
+        liveStream = cap.get(cv::CAP_PROP_POS_FRAMES) < 0 || cap.get(cv::CAP_PROP_FPS) == 0;
+    }
+
+    CaptureFrameSource::CaptureFrameSource(int index) : cap(index) {
+        testLiveStream();
+    }
+
+    CaptureFrameSource::CaptureFrameSource(const string &file) : cap(file) {
+        cap.set(cv::CAP_PROP_FOURCC,
+                cv::VideoWriter::fourcc('M', 'J', 'P', 'G')); //THIS MAKES IT WORK WITH > 1 CAMERA!!!!!
+        testLiveStream();
+    }
+
+    bool CaptureFrameSource::isOpen() {
+        return cap.isOpened();
+    }
+
+    bool CaptureFrameSource::grab() {
+        return cap.grab();
+    }
+
+    bool CaptureFrameSource::retrieve(Mat &img) {
+        return cap.retrieve(img);
+    }
+
+    double CaptureFrameSource::getFrameRate() {
+        return cap.get(cv::CAP_PROP_FPS);
+    }
+
+    Size CaptureFrameSource::getFrameSize() {
+        if (!isOpen()) return Size(0, 0);
+        return Size((int) cap.get(cv::CAP_PROP_FRAME_WIDTH), (int) cap.get(cv::CAP_PROP_FRAME_HEIGHT));
+    }
+
+    Size CaptureFrameSource::setFrameSize(Size size) {
+        if (isOpen()) {
+            cap.set(cv::CAP_PROP_FRAME_WIDTH, size.width);
+            cap.set(cv::CAP_PROP_FRAME_HEIGHT, size.height);
+        }
+        return getFrameSize();
+    }
+
+    long CaptureFrameSource::getPositionFrame() {
+        return (long) cap.get(cv::CAP_PROP_POS_FRAMES);
+    }
+
+    double CaptureFrameSource::getPositionSeconds() {
+        return cap.get(cv::CAP_PROP_POS_MSEC) / 1000.0;
+    }
+
+    long CaptureFrameSource::getFrameCount() {
+        if (liveStream) return 0;
+        return (long) cap.get(cv::CAP_PROP_FRAME_COUNT);
+    }
+
+    bool CaptureFrameSource::isLiveStream() {
+        return liveStream;
+    }
+
+    ReplayFrameSource::ReplayFrameSource(double frameRate, Playback playback, bool loop) {
+        this->frameRate = frameRate;
+        this->playback = playback;
+        this->loop = loop;
+    }
+
+    void ReplayFrameSource::preload() {
+        preloaded.clear();
+        long count = frameCount();
+        for (long i = 0; count == 0 || i < count; i++) {
+            Mat img;
+            if (!loadFrame(i, img) || img.empty()) break;
+            preloaded.push_back(img);
+        }
+    }
+
+    long ReplayFrameSource::available() {
+        if (!preloaded.empty()) return (long) preloaded.size();
+        return frameCount();
+    }
+
+    void ReplayFrameSource::rewind() {
+        startNanos = 0;
+        tick = -1;
+        position = -1;
+    }
+
+    bool ReplayFrameSource::isFinished() {
+        long count = available();
+        return !loop && count > 0 && tick >= count - 1;
+    }
+
+    long long ReplayFrameSource::frameTimeMicros(long index) {
+        return (long long) ((double) index * 1e6 / frameRate);
+    }
+
+    long long ReplayFrameSource::durationMicros() {
+        return frameTimeMicros(available());
+    }
+
+    long long ReplayFrameSource::tickTimeMicros(long long tick) {
+        long count = available();
+        if (count <= 0) return frameTimeMicros((long) tick);
+        //looping sources keep counting ticks; every pass adds one duration
+        return (tick / count) * durationMicros() + frameTimeMicros((long) (tick % count));
+    }
+
+    void ReplayFrameSource::setSpeed(double speed) {
+        if (speed <= 0) throw std::invalid_argument("Playback speed must be positive");
+        //keep the current frame due now so the change does not cause a jump
+        if (tick >= 0) {
+            long long now = Time::nanos();
+            long long elapsed = (long long) ((double) (now - startNanos) * this->speed);
+            startNanos = now - (long long) ((double) elapsed / speed);
+        }
+        this->speed = speed;
+    }
+
+    bool ReplayFrameSource::seek(long index) {
+        long count = available();
+        if (index < 0 || (count > 0 && index >= count)) return false;
+        tick = index - 1;
+        //shift the schedule so that the requested frame is due now
+        startNanos = Time::nanos() - (long long) ((double) tickTimeMicros(index) * 1000.0 / speed);
+        return true;
+    }
+
+    bool ReplayFrameSource::grab() {
+        if (!isOpen() || isFinished()) return false;
+
+        long long next = tick + 1;
+        if (playback == REALTIME) {
+            long long now = Time::nanos();
+            if (tick < 0) startNanos = now;
+
+            //skip ahead to the frame that is due now, like a camera would
+            long long elapsedMicros = (long long) ((double) (now - startNanos) * speed / 1000.0);
+            long count = available();
+            while ((count == 0 || loop || next < count - 1) && tickTimeMicros(next + 1) <= elapsedMicros) next++;
+
+            long long deadline = startNanos + (long long) ((double) tickTimeMicros(next) * 1000.0 / speed);
+            if (deadline > now) Time::waitMicros((deadline - now) / 1000);
+        }
+
+        long count = available();
+        if (count > 0 && next >= count) {
+            if (!loop) {
+                //a slow consumer may skip past the end; still deliver the last frame
+                next = count - 1;
+            }
+        }
+
+        tick = next;
+        position = count > 0 ? (long) (tick % count) : (long) tick;
+        return true;
+    }
+
+    bool ReplayFrameSource::retrieve(Mat &img) {
+        if (position < 0) return false;
+        if (!preloaded.empty()) {
+            //copy so that consumers drawing on the frame cannot corrupt the replay
+            preloaded[position].copyTo(img);
+            return true;
+        }
+        return loadFrame(position, img);
+    }
+
+    double ReplayFrameSource::getFrameRate() {
+        return frameRate;
+    }
+
+    Size ReplayFrameSource::getFrameSize() {
+        if (!preloaded.empty()) return preloaded[0].size();
+        return Size(0, 0);
+    }
+
+    long ReplayFrameSource::getPositionFrame() {
+        return position;
+    }
+
+    double ReplayFrameSource::getPositionSeconds() {
+        if (position < 0) return 0;
+        return (double) frameTimeMicros(position) / 1e6;
+    }
+
+    long ReplayFrameSource::getFrameCount() {
+        return available();
+    }
+
+    bool ReplayFrameSource::isLiveStream() {
+        return false;
+    }
+
+    FileReplayFrameSource::FileReplayFrameSource(const string &file, Playback playback, bool loop, bool preloadFrames)
+            : ReplayFrameSource(30.0, playback, loop), cap(file) {
+        if (!cap.isOpened()) return;
+
+        double fileRate = cap.get(cv::CAP_PROP_FPS);
+        if (fileRate > 0) frameRate = fileRate;
+        count = (long) cap.get(cv::CAP_PROP_FRAME_COUNT);
+        size = Size((int) cap.get(cv::CAP_PROP_FRAME_WIDTH), (int) cap.get(cv::CAP_PROP_FRAME_HEIGHT));
+
+        if (preloadFrames) {
+            //frame counts reported by containers are often wrong, so decode until the stream ends
+            count = 0;
+            preload();
+            count = getFrameCount();
+            cap.release();
+        }
+    }
+
+    bool FileReplayFrameSource::loadFrame(long index, Mat &img) {
+        if (!cap.isOpened()) return false;
+
+        if (index < nextDecoded || index > nextDecoded + 15) {
+            //seek only for large jumps; decoding a few frames is faster than a keyframe seek
+            cap.set(cv::CAP_PROP_POS_FRAMES, index);
+            nextDecoded = index;
+        }
+        while (nextDecoded < index) {
+            if (!cap.grab()) return false;
+            nextDecoded++;
+        }
+
+        if (!cap.read(img)) return false;
+        nextDecoded = index + 1;
+        return true;
+    }
+
+    long FileReplayFrameSource::frameCount() {
+        return count;
+    }
+
+    bool FileReplayFrameSource::isOpen() {
+        return cap.isOpened() || getFrameCount() > 0;
+    }
+
+    Size FileReplayFrameSource::getFrameSize() {
+        return size;
+    }
+
+    ImageSequenceFrameSource::ImageSequenceFrameSource(const string &pattern, double frameRate, Playback playback,
+                                                       bool loop, bool preloadFrames)
+            : ReplayFrameSource(frameRate, playback, loop) {
+        cv::glob(pattern, files, false);
+        std::sort(files.begin(), files.end());
+
+        if (preloadFrames) preload();
+    }
+
+    bool ImageSequenceFrameSource::loadFrame(long index, Mat &img) {
+        if (index < 0 || index >= (long) files.size()) return false;
+        img = imread(files[index], IMREAD_COLOR);
+        return !img.empty();
+    }
+
+    long ImageSequenceFrameSource::frameCount() {
+        return (long) files.size();
+    }
+
+    bool ImageSequenceFrameSource::isOpen() {
+        return !files.empty();
+    }
+
+    //position of a point moving at constant speed that bounces between lo and hi
+    static double bounce(double p, double lo, double hi) {
+        double span = hi - lo;
+        if (span <= 0) return lo;
+        double t = std::fmod(p - lo, 2.0 * span);
+        if (t < 0) t += 2.0 * span;
+        return lo + (t <= span ? t : 2.0 * span - t);
+    }
+
+    SyntheticFrameSource::SyntheticFrameSource() : SyntheticFrameSource(Settings()) {
+    }
+
+    SyntheticFrameSource::SyntheticFrameSource(Settings settings, Playback playback)
+            : ReplayFrameSource(settings.frameRate, playback, true) {
+        this->settings = settings;
+        prepare();
+    }
+
+    void SyntheticFrameSource::prepare() {
+        Size size = settings.frameSize;
+        RNG rng(settings.seed);
+
+        //vertical gradient from the surface down
+        background.create(size, CV_8UC3);
+        for (int y = 0; y < size.height; y++) {
+            double t = size.height > 1 ? (double) y / (double) (size.height - 1) : 0.0;
+            Scalar color = settings.waterTop * (1.0 - t) + settings.waterBottom * t;
+            background.row(y).setTo(color);
+        }
+
+        for (int i = 0; i < NOISE_FRAMES; i++) {
+            noise[i].create(size, CV_16SC3);
+            rng.fill(noise[i], RNG::NORMAL, Scalar::all(0), Scalar::all(settings.noise));
+        }
+
+        motion.clear();
+        double minSize = std::max(8.0, size.height * 0.05);
+        double maxSize = std::max(minSize + 1.0, size.height * 0.12);
+        for (int i = 0; i < settings.shapeCount; i++) {
+            Motion m;
+            m.start.type = (ShapeType) (i % 4);
+            m.start.size = rng.uniform(minSize, maxSize);
+            m.start.center = Point2d(rng.uniform(0.0, (double) size.width), rng.uniform(0.0, (double) size.height));
+            m.start.angle = rng.uniform(0.0, 360.0);
+            m.velocity = Point2d(rng.uniform(-settings.maxSpeed, settings.maxSpeed),
+                                 rng.uniform(-settings.maxSpeed, settings.maxSpeed));
+            m.spin = rng.uniform(-1.0, 1.0);
+            motion.push_back(m);
+        }
+    }
+
+    void SyntheticFrameSource::render(long index, Mat &img) {
+        Size size = settings.frameSize;
+        cv::add(background, noise[index % NOISE_FRAMES], img, noArray(), CV_8UC3);
+
+        shapes.clear();
+        for (const Motion &m : motion) {
+            Shape shape = m.start;
+            double margin = shape.size;
+            shape.center.x = bounce(m.start.center.x + m.velocity.x * index, margin, size.width - margin);
+            shape.center.y = bounce(m.start.center.y + m.velocity.y * index, margin, size.height - margin);
+            shape.angle = std::fmod(m.start.angle + m.spin * index, 360.0);
+            shapes.push_back(shape);
+
+            if (shape.type == CIRCLE) {
+                circle(img, Point(shape.center), (int) (shape.size / 2.0), settings.shapeColor, cv::FILLED, cv::LINE_AA);
+                continue;
+            }
+
+            Size2f box;
+            if (shape.type == TRIANGLE) {
+                double r = shape.size / std::sqrt(3.0);
+                vector<Point> points;
+                for (int k = 0; k < 3; k++) {
+                    double a = (shape.angle + k * 120.0) * CV_PI / 180.0;
+                    points.push_back(Point((int) std::lround(shape.center.x + r * std::cos(a)),
+                                           (int) std::lround(shape.center.y + r * std::sin(a))));
+                }
+                fillConvexPoly(img, points, settings.shapeColor, cv::LINE_AA);
+                continue;
+            } else if (shape.type == SQUARE) {
+                box = Size2f((float) shape.size, (float) shape.size);
+            } else {
+                box = Size2f((float) shape.size, (float) (shape.size * 0.35));
+            }
+
+            Point2f corners[4];
+            RotatedRect((Point2f) shape.center, box, (float) shape.angle).points(corners);
+            vector<Point> points;
+            for (const Point2f &corner : corners) points.push_back(Point((int) std::lround(corner.x),
+                                                                          (int) std::lround(corner.y)));
+            fillConvexPoly(img, points, settings.shapeColor, cv::LINE_AA);
+        }
+    }
+
+    bool SyntheticFrameSource::loadFrame(long index, Mat &img) {
+        render(index, img);
+        return true;
+    }
+
+    long SyntheticFrameSource::frameCount() {
+        return settings.frameCount;
+    }
+
+    bool SyntheticFrameSource::isOpen() {
+        return true;
+    }
+
+    Size SyntheticFrameSource::getFrameSize() {
+        return settings.frameSize;
+    }
+
+    Size SyntheticFrameSource::setFrameSize(Size size) {
+        if (size.width <= 0 || size.height <= 0) return settings.frameSize;
+        settings.frameSize = size;
+        prepare();
+        return size;
+    }
+
+    const vector<SyntheticFrameSource::Shape> &SyntheticFrameSource::getShapes() {
+        return shapes;
+    }
+
+    int SyntheticFrameSource::countShapes(ShapeType type) {
+        int count = 0;
+        for (const Shape &shape : shapes) {
+            if (shape.type == type) count++;
+        }
+        return count;
+    }
+}
@@ -0,0 +1,135 @@
+#include "robosub/hud.h"
+
+#include <stdexcept>
+
+namespace robosub {
+    int HudOverlay::findFont(const Style &style) {
+        for (size_t i = 0; i < fonts.size(); i++) {
+            const Style &s = fonts[i].style;
+            if (s.color == style.color && s.scale == style.scale && s.thickness == style.thickness &&
+                s.font == style.font)
+                return (int) i;
+        }
+
+        Font font;
+        font.style = style;
+        int baseline = 0;
+        Size size = cv::getTextSize("Ag", style.font, style.scale, style.thickness, &baseline);
+        font.ascent = size.height;
+        font.descent = baseline;
+        font.padding = GLYPH_PADDING + style.thickness;
+        fonts.push_back(font);
+        return (int) fonts.size() - 1;
+    }
+
+    const HudOverlay::Glyph &HudOverlay::getGlyph(Font &font, char c) {
+        auto cached = font.glyphs.find(c);
+        if (cached != font.glyphs.end()) return cached->second;
+
+        const Style &style = font.style;
+        String text(1, c);
+        int baseline = 0;
+        Size size = cv::getTextSize(text, style.font, style.scale, style.thickness, &baseline);
+
+        Glyph glyph;
+        glyph.alpha = Mat::zeros(font.ascent + font.descent + 2 * font.padding, size.width + 2 * font.padding, CV_8UC1);
+        putText(glyph.alpha, text, Point(font.padding, font.padding + font.ascent), style.font, style.scale,
+                Scalar(255), style.thickness, cv::LINE_AA);
+        //getTextSize adds the stroke thickness once per string, so the difference is the advance alone
+        glyph.advance = cv::getTextSize(String(2, c), style.font, style.scale, style.thickness, &baseline).width -
+                        size.width;
+        return font.glyphs[c] = glyph;
+    }
+
+    void HudOverlay::rasterize(Label &label) {
+        if (label.text.empty()) {
+            label.raster.release();
+            return;
+        }
+
+        //place the cached glyphs side by side; overlapping strokes keep the stronger coverage
+        Font &font = fonts[label.font];
+        vector<int> positions;
+        int x = 0, width = 0;
+        for (char c : label.text) {
+            const Glyph &glyph = getGlyph(font, c);
+            positions.push_back(x);
+            width = max(width, x + glyph.alpha.cols);
+            x += glyph.advance;
+        }
+
+        alphaScratch.create(font.ascent + font.descent + 2 * font.padding, width, CV_8UC1);
+        alphaScratch.setTo(Scalar(0));
+        for (size_t i = 0; i < label.text.size(); i++) {
+            const Glyph &glyph = getGlyph(font, label.text[i]);
+            Mat target = alphaScratch(Rect(positions[i], 0, glyph.alpha.cols, glyph.alpha.rows));
+            cv::max(target, glyph.alpha, target);
+        }
+
+        label.raster.create(alphaScratch.size(), CV_8UC4);
+        label.raster.setTo(Scalar(font.style.color[0], font.style.color[1], font.style.color[2], 0));
+        const int fromTo[] = {0, 3};
+        mixChannels(&alphaScratch, 1, &label.raster, 1, fromTo, 1);
+        label.rasterOrigin = Point(font.padding, font.padding + font.ascent);
+
+        if (label.anchor == Drawing::Anchor::BOTTOM_LEFT_UNFLIPPED_Y) {
+            //same mirrored text as Drawing::text draws for this anchor
+            cv::flip(label.raster, label.raster, 0);
+            label.rasterOrigin.y = label.raster.rows - 1 - label.rasterOrigin.y;
+        }
+    }
+
+    Point HudOverlay::getRasterLocation(const Label &label, Size frameSize) {
+        Point origin = label.origin;
+        if (label.anchor == Drawing::Anchor::BOTTOM_LEFT) origin.y = frameSize.height - 1 - origin.y;
+        return origin - label.rasterOrigin;
+    }
+
+    int HudOverlay::addLabel(Point origin, Drawing::Anchor anchor, Style style) {
+        Label label;
+        label.origin = origin;
+        label.anchor = anchor;
+        label.font = findFont(style);
+        labels.push_back(label);
+        return (int) labels.size() - 1;
+    }
+
+    int HudOverlay::addLabel(Point origin, Drawing::Anchor anchor) {
+        return addLabel(origin, anchor, Style());
+    }
+
+    int HudOverlay::getLabelCount() {
+        return (int) labels.size();
+    }
+
+    void HudOverlay::setText(int label, const String &text) {
+        if (label < 0 || label >= (int) labels.size()) throw std::out_of_range("Label index out of range");
+        if (labels[label].text == text) return;
+        labels[label].text = text;
+        rasterize(labels[label]);
+    }
+
+    void HudOverlay::setVisible(int label, bool visible) {
+        if (label < 0 || label >= (int) labels.size()) throw std::out_of_range("Label index out of range");
+        labels[label].visible = visible;
+    }
+
+    void HudOverlay::setOrigin(int label, Point origin) {
+        if (label < 0 || label >= (int) labels.size()) throw std::out_of_range("Label index out of range");
+        labels[label].origin = origin;
+    }
+
+    Rect HudOverlay::getBounds(int label, Size frameSize) {
+        if (label < 0 || label >= (int) labels.size()) throw std::out_of_range("Label index out of range");
+        const Label &l = labels[label];
+        if (l.raster.empty()) return Rect();
+        return Rect(getRasterLocation(l, frameSize), l.raster.size()) & Rect(Point(), frameSize);
+    }
+
+    void HudOverlay::draw(Mat &frame) {
+        for (Label &label : labels) {
+            if (!label.visible || label.raster.empty()) continue;
+            Drawing::transparentImage(&frame, &label.raster, getRasterLocation(label, frame.size()));
+        }
+    }
+}
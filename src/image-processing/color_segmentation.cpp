@@ -0,0 +1,214 @@
+#include <opencv2/opencv.hpp>
+#include <robosub/robosub.h>
+#include <robosub/image-processing/color_segmentation.h>
+
+#include <algorithm>
+#include <climits>
+#include <stdexcept>
+
+namespace robosub {
+    const uchar ColorSegmenter::BACKGROUND;
+    const int ColorSegmenter::LUT_BITS;
+    const int ColorSegmenter::LUT_SIZE;
+
+    static inline int lutIndex(uchar b, uchar g, uchar r) {
+        const int shift = 8 - ColorSegmenter::LUT_BITS;
+        return ((b >> shift) << (2 * ColorSegmenter::LUT_BITS)) | ((g >> shift) << ColorSegmenter::LUT_BITS) |
+               (r >> shift);
+    }
+
+    static inline bool inHsvRange(const Vec3b &hsv, const Scalar &low, const Scalar &high) {
+        bool hue = low[0] <= high[0] ? (hsv[0] >= low[0] && hsv[0] <= high[0])
+                                     : (hsv[0] >= low[0] || hsv[0] <= high[0]);
+        return hue && hsv[1] >= low[1] && hsv[1] <= high[1] && hsv[2] >= low[2] && hsv[2] <= high[2];
+    }
+
+    ColorSegmenter::ColorSegmenter() : lut((size_t) LUT_SIZE, BACKGROUND) {}
+
+    int ColorSegmenter::addClass(const String &name, Scalar hsvLow, Scalar hsvHigh) {
+        //labels are stored in a CV_8UC1 image with 0 reserved for the background
+        if (classes.size() >= 255) throw std::length_error("ColorSegmenter supports at most 255 classes");
+
+        ColorClass colorClass;
+        colorClass.name = name;
+        colorClass.hsvLow = hsvLow;
+        colorClass.hsvHigh = hsvHigh;
+        classes.push_back(colorClass);
+        compiled = false;
+        return (int) classes.size();
+    }
+
+    void ColorSegmenter::clearClasses() {
+        classes.clear();
+        compiled = false;
+    }
+
+    int ColorSegmenter::getClassCount() {
+        return (int) classes.size();
+    }
+
+    const ColorSegmenter::ColorClass &ColorSegmenter::getClass(int classId) {
+        if (classId < 1 || classId > (int) classes.size()) throw std::out_of_range("Color class out of range");
+        return classes[classId - 1];
+    }
+
+    int ColorSegmenter::getClassId(const String &name) {
+        for (size_t i = 0; i < classes.size(); i++) {
+            if (classes[i].name == name) return (int) i + 1;
+        }
+        return -1;
+    }
+
+    void ColorSegmenter::compile() {
+        //center color of every cell, converted to HSV in one call
+        const int levels = 1 << LUT_BITS;
+        const int half = 1 << (7 - LUT_BITS);
+        Mat cells(LUT_SIZE, 1, CV_8UC3), hsv;
+        for (int b = 0; b < levels; b++) {
+            for (int g = 0; g < levels; g++) {
+                for (int r = 0; r < levels; r++) {
+                    uchar cb = (uchar) ((b << (8 - LUT_BITS)) + half);
+                    uchar cg = (uchar) ((g << (8 - LUT_BITS)) + half);
+                    uchar cr = (uchar) ((r << (8 - LUT_BITS)) + half);
+                    cells.at<Vec3b>(lutIndex(cb, cg, cr)) = Vec3b(cb, cg, cr);
+                }
+            }
+        }
+        cvtColor(cells, hsv, COLOR_BGR2HSV);
+
+        for (int i = 0; i < LUT_SIZE; i++) {
+            const Vec3b &value = hsv.at<Vec3b>(i);
+            lut[i] = BACKGROUND;
+            for (size_t c = 0; c < classes.size(); c++) {
+                if (inHsvRange(value, classes[c].hsvLow, classes[c].hsvHigh)) {
+                    lut[i] = (uchar) (c + 1);
+                    break;
+                }
+            }
+        }
+        compiled = true;
+    }
+
+    uchar ColorSegmenter::classify(const Vec3b &bgr) {
+        if (!compiled) compile();
+        return lut[lutIndex(bgr[0], bgr[1], bgr[2])];
+    }
+
+    void ColorSegmenter::label(const Mat &bgr, Mat &labels) {
+        CV_Assert(bgr.type() == CV_8UC3);
+        if (!compiled) compile();
+
+        labels.create(bgr.size(), CV_8UC1);
+        const uchar *table = lut.data();
+        parallel_for_(Range(0, bgr.rows), [&](const Range &range) {
+            for (int y = range.start; y < range.end; y++) {
+                const uchar *src = bgr.ptr<uchar>(y);
+                uchar *dst = labels.ptr<uchar>(y);
+                //index arithmetic vectorizes; the 32 KB table stays in L1 cache for the gather
+                for (int x = 0; x < bgr.cols; x++, src += 3) {
+                    dst[x] = table[lutIndex(src[0], src[1], src[2])];
+                }
+            }
+        });
+    }
+
+    int ColorSegmenter::findRoot(int run) {
+        while (parent[run] != run) {
+            parent[run] = parent[parent[run]];
+            run = parent[run];
+        }
+        return run;
+    }
+
+    void ColorSegmenter::unite(int a, int b) {
+        a = findRoot(a);
+        b = findRoot(b);
+        if (a < b) parent[b] = a;
+        else if (b < a) parent[a] = b;
+    }
+
+    void ColorSegmenter::findComponents(const Mat &labels, vector<Component> &components) {
+        CV_Assert(labels.type() == CV_8UC1);
+        components.clear();
+
+        //run-length encode every row, keeping runs of any class
+        runs.clear();
+        rowStart.assign((size_t) labels.rows + 1, 0);
+        for (int y = 0; y < labels.rows; y++) {
+            rowStart[y] = (int) runs.size();
+            const uchar *row = labels.ptr<uchar>(y);
+            int x = 0;
+            while (x < labels.cols) {
+                uchar c = row[x];
+                if (c == BACKGROUND) {
+                    x++;
+                    continue;
+                }
+                int start = x;
+                while (x < labels.cols && row[x] == c) x++;
+                runs.push_back({y, start, x, c});
+            }
+        }
+        rowStart[labels.rows] = (int) runs.size();
+
+        //join runs of the same class that touch a run of the previous row, diagonals included
+        parent.resize(runs.size());
+        for (size_t i = 0; i < runs.size(); i++) parent[i] = (int) i;
+        for (int y = 1; y < labels.rows; y++) {
+            int j = rowStart[y - 1];
+            int previousEnd = rowStart[y];
+            for (int i = rowStart[y]; i < rowStart[y + 1]; i++) {
+                const Run &run = runs[i];
+                while (j < previousEnd && runs[j].end < run.start) j++;
+                for (int k = j; k < previousEnd && runs[k].start <= run.end; k++) {
+                    if (runs[k].classId == run.classId) unite(i, k);
+                }
+            }
+        }
+
+        //accumulate area, centroid and bounds per root
+        accumulators.clear();
+        componentIndex.assign(runs.size(), -1);
+        for (size_t i = 0; i < runs.size(); i++) {
+            int root = findRoot((int) i);
+            if (componentIndex[root] < 0) {
+                componentIndex[root] = (int) accumulators.size();
+                accumulators.push_back({0, 0, 0, INT_MAX, INT_MAX, INT_MIN, INT_MIN});
+            }
+            const Run &run = runs[i];
+            Accumulator &a = accumulators[componentIndex[root]];
+            int n = run.end - run.start;
+            a.area += n;
+            a.sumX += (run.start + run.end - 1) * 0.5 * n;
+            a.sumY += (double) run.row * n;
+            a.minX = min(a.minX, run.start);
+            a.maxX = max(a.maxX, run.end - 1);
+            a.minY = min(a.minY, run.row);
+            a.maxY = max(a.maxY, run.row);
+        }
+
+        for (size_t i = 0; i < runs.size(); i++) {
+            if (parent[i] != (int) i) continue;
+            const Accumulator &a = accumulators[componentIndex[i]];
+            if (a.area < MIN_AREA) continue;
+
+            Component component;
+            component.classId = runs[i].classId;
+            component.area = a.area;
+            component.centroid = Point2d(a.sumX / a.area, a.sumY / a.area);
+            component.bounds = Rect(a.minX, a.minY, a.maxX - a.minX + 1, a.maxY - a.minY + 1);
+            components.push_back(component);
+        }
+
+        std::sort(components.begin(), components.end(), [](const Component &a, const Component &b) {
+            if (a.classId != b.classId) return a.classId < b.classId;
+            if (a.area != b.area) return a.area > b.area;
+            return a.bounds.y != b.bounds.y ? a.bounds.y < b.bounds.y : a.bounds.x < b.bounds.x;
+        });
+    }
+
+    void ColorSegmenter::segment(const Mat &bgr, vector<Component> &components, Mat &labels) {
+        label(bgr, labels);
+        findComponents(labels, components);
+    }
+}
@@ -0,0 +1,58 @@
+#include <opencv2/opencv.hpp>
+#include <robosub/robosub.h>
+#include <robosub/image-processing/frame_pyramid.h>
+
+namespace robosub {
+    const int FramePyramid::MAX_LEVELS;
+
+    FramePyramid::FramePyramid() {}
+
+    FramePyramid::FramePyramid(const Mat &frame) {
+        reset(frame);
+    }
+
+    void FramePyramid::reset(const Mat &frame) {
+        lock_guard<mutex> guard(lock);
+        levels[0] = frame;
+        built = frame.empty() ? 0 : 1;
+    }
+
+    const Mat &FramePyramid::level(int i) {
+        CV_Assert(i >= 0 && i < MAX_LEVELS);
+        lock_guard<mutex> guard(lock);
+        CV_Assert(built > 0);
+        //create() in pyrDown keeps the previous frame's buffer when the size matches
+        for (; built <= i; built++) pyrDown(levels[built - 1], levels[built]);
+        return levels[i];
+    }
+
+    const Mat &FramePyramid::levelAtMost(int maxWidth) {
+        int i = 0;
+        while (i + 1 < MAX_LEVELS && levelSize(i).width > maxWidth && levelSize(i).width >= 4) i++;
+        return level(i);
+    }
+
+    int FramePyramid::findLevel(Size size) {
+        for (int i = 0; i < MAX_LEVELS; i++) {
+            Size s = levelSize(i);
+            if (s == size) return i;
+            if (s.width < size.width || s.height < size.height) break;
+        }
+        return -1;
+    }
+
+    Size FramePyramid::levelSize(int i) {
+        Size size = levels[0].size();
+        for (int l = 0; l < i; l++) size = Size((size.width + 1) / 2, (size.height + 1) / 2);
+        return size;
+    }
+
+    int FramePyramid::getBuiltLevels() {
+        lock_guard<mutex> guard(lock);
+        return built;
+    }
+
+    bool FramePyramid::empty() {
+        return levels[0].empty();
+    }
+}
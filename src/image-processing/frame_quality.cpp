@@ -0,0 +1,129 @@
+#include <opencv2/opencv.hpp>
+#include <robosub/robosub.h>
+#include <robosub/image-processing/frame_quality.h>
+
+namespace robosub {
+    FrameQualityMonitor::FrameQualityMonitor() : FrameQualityMonitor(Settings()) {}
+
+    FrameQualityMonitor::FrameQualityMonitor(Settings settings) : settings(settings) {}
+
+    static int percentile(const int *histogram, long long total, double fraction) {
+        long long target = (long long) std::ceil(total * fraction), count = 0;
+        for (int v = 0; v < 256; v++) {
+            count += histogram[v];
+            if (count >= target) return v;
+        }
+        return 255;
+    }
+
+    FrameQualityMonitor::Metrics FrameQualityMonitor::analyze(const Mat &frame) {
+        CV_Assert(frame.depth() == CV_8U && (frame.channels() == 1 || frame.channels() == 3 || frame.channels() == 4));
+
+        //halve until small enough; pyrDown's blur also keeps sensor noise out of the focus measure
+        const Mat *level = &frame;
+        int next = 0;
+        while (level->cols > settings.analysisWidth && level->cols >= 4) {
+            pyrDown(*level, levels[next]);
+            level = &levels[next];
+            next ^= 1;
+        }
+
+        const int rows = level->rows, cols = level->cols, cn = level->channels();
+        luma.create(rows, cols, CV_8UC1);
+        int histogram[256] = {0};
+        long long sumLuma = 0, sumMin = 0, sumMax = 0;
+        long long laplacianSum = 0, laplacianSquares = 0, laplacianCount = 0;
+
+        //one pass: luma, histogram and channel extremes for row y, Laplacian for row y - 1
+        for (int y = 0; y < rows; y++) {
+            const uchar *src = level->ptr<uchar>(y);
+            uchar *l = luma.ptr<uchar>(y);
+            if (cn == 1) {
+                for (int x = 0; x < cols; x++) {
+                    l[x] = src[x];
+                    histogram[src[x]]++;
+                    sumLuma += src[x];
+                }
+            } else {
+                for (int x = 0; x < cols; x++, src += cn) {
+                    int b = src[0], g = src[1], r = src[2];
+                    //BT.601 weights in 8-bit fixed point, as cvtColor uses
+                    int v = (29 * b + 150 * g + 77 * r + 128) >> 8;
+                    l[x] = (uchar) v;
+                    histogram[v]++;
+                    sumLuma += v;
+                    sumMin += min(b, min(g, r));
+                    sumMax += max(b, max(g, r));
+                }
+            }
+
+            if (y >= 2) {
+                const uchar *up = luma.ptr<uchar>(y - 2), *center = luma.ptr<uchar>(y - 1), *down = l;
+                for (int x = 1; x < cols - 1; x++) {
+                    int laplacian = 4 * center[x] - center[x - 1] - center[x + 1] - up[x] - down[x];
+                    laplacianSum += laplacian;
+                    laplacianSquares += laplacian * laplacian;
+                }
+                laplacianCount += max(cols - 2, 0);
+            }
+        }
+
+        Metrics m;
+        long long total = (long long) rows * cols;
+        m.analysisSize = Size(cols, rows);
+        if (total > 0) {
+            m.meanLuma = (double) sumLuma / total;
+            m.p5 = percentile(histogram, total, 0.05);
+            m.p50 = percentile(histogram, total, 0.5);
+            m.p95 = percentile(histogram, total, 0.95);
+            m.contrast = m.p95 - m.p5;
+
+            long long dark = 0, bright = 0;
+            for (int v = 0; v <= 5; v++) dark += histogram[v];
+            for (int v = 250; v < 256; v++) bright += histogram[v];
+            m.darkFraction = (double) dark / total;
+            m.brightFraction = (double) bright / total;
+        }
+        if (laplacianCount > 0) {
+            double mean = (double) laplacianSum / laplacianCount;
+            m.focus = (double) laplacianSquares / laplacianCount - mean * mean;
+        }
+        if (cn > 1 && sumMax > 0) m.turbidity = (double) sumMin / sumMax;
+
+        if (m.focus < settings.minFocus) m.problems |= BLURRY;
+        if (m.p50 < settings.minMedian || m.darkFraction > settings.maxClipped) m.problems |= UNDEREXPOSED;
+        if (m.p50 > settings.maxMedian || m.brightFraction > settings.maxClipped) m.problems |= OVEREXPOSED;
+        if (m.contrast < settings.minContrast) m.problems |= LOW_CONTRAST;
+        if (m.turbidity > settings.maxTurbidity) m.problems |= TURBID;
+
+        metrics = m;
+        return m;
+    }
+
+    FrameQualityMonitor::Metrics FrameQualityMonitor::analyze(FramePyramid &pyramid) {
+        return analyze(pyramid.levelAtMost(settings.analysisWidth));
+    }
+
+    FrameQualityMonitor::Metrics FrameQualityMonitor::getMetrics() {
+        return metrics;
+    }
+
+    FrameQualityMonitor::Settings FrameQualityMonitor::getSettings() {
+        return settings;
+    }
+
+    void FrameQualityMonitor::setSettings(Settings settings) {
+        this->settings = settings;
+    }
+
+    String FrameQualityMonitor::describe(int problems) {
+        static const char *names[] = {"blurry", "underexposed", "overexposed", "low contrast", "turbid"};
+        String description;
+        for (int i = 0; i < 5; i++) {
+            if (!(problems & (1 << i))) continue;
+            if (!description.empty()) description += ", ";
+            description += names[i];
+        }
+        return description;
+    }
+}
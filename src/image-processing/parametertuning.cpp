@@ -4,6 +4,7 @@
 #include <utility>
 #include <algorithm>
 #include <iterator>
+#include <stdexcept>
 
 
 using namespace std;
@@ -15,19 +16,122 @@ namespace robosub {
         this->maxValue = maxValue;
     }
 
+    ParameterSchema::ParameterSchema() {}
+
+    ParameterSchema::ParameterSchema(const map<string, ParameterMetadata> &parameters) {
+        for (auto const &kv : parameters) {
+            indices[kv.first] = (int) names.size();
+            names.push_back(kv.first);
+            metadata.push_back(kv.second);
+        }
+    }
+
+    int ParameterSchema::size() const {
+        return (int) names.size();
+    }
+
+    int ParameterSchema::indexOf(const string &name) const {
+        auto it = indices.find(name);
+        return it == indices.end() ? -1 : it->second;
+    }
+
+    const string &ParameterSchema::getName(int index) const {
+        return names[index];
+    }
+
+    const ParameterMetadata &ParameterSchema::getMetadata(int index) const {
+        return metadata[index];
+    }
+
+    void ParameterSchema::initialValues(double *values) const {
+        for (size_t i = 0; i < metadata.size(); ++i) {
+            values[i] = metadata[i].initValue;
+        }
+    }
+
+    map<string, double> ParameterSchema::toMap(const double *values) const {
+        map<string, double> parameters;
+        for (size_t i = 0; i < names.size(); ++i) {
+            parameters.insert(parameters.end(), {names[i], values[i]});
+        }
+        return parameters;
+    }
+
+    void ParameterSchema::fromMap(const map<string, double> &parameters, double *values) const {
+        for (auto const &kv : parameters) {
+            int index = indexOf(kv.first);
+            if (index >= 0) values[index] = kv.second;
+        }
+    }
+
+    ParameterSet::ParameterSet(const ParameterSchema &schema, const double *values) : schema(&schema),
+                                                                                       values(values) {}
+
+    int ParameterSet::size() const {
+        return schema->size();
+    }
+
+    double ParameterSet::at(const string &name) const {
+        int index = schema->indexOf(name);
+        if (index < 0) throw out_of_range("No parameter named " + name);
+        return values[index];
+    }
+
+    const double *ParameterSet::data() const {
+        return values;
+    }
+
+    map<string, double> ParameterSet::toMap() const {
+        return schema->toMap(values);
+    }
+
     double fastSigmoid(double x) {
         return x / (1 + abs(x));
     }
 
+    const unsigned long long ParameterTuner::DEFAULT_SEED;
+
     map<string, double>
-    ParameterTuner::tuneParameters(map<string, ParameterMetadata> parameters,
-                                   double (*evalFunction)(map<string, double>),
+    ParameterTuner::tuneParameters(map<string, ParameterMetadata> parameters, EvaluationFunction evalFunction,
                                    TuningMethods method) {
-        parameterMetadata = std::move(parameters);
-        this->evaluationFunction = evalFunction;
+        schema = ParameterSchema(parameters);
+        EvaluationFunction function = std::move(evalFunction);
+        sampleFunction = [function](const ParameterSet &parameterSet, int) { return function(parameterSet); };
+        sampleCount = 1;
+        return tune(method);
+    }
+
+    map<string, double>
+    ParameterTuner::tuneOnSamples(map<string, ParameterMetadata> parameters, SampleEvaluationFunction evalFunction,
+                                  int samples, TuningMethods method) {
+        if (samples < 1) throw invalid_argument("Tuning needs at least one sample");
+        schema = ParameterSchema(parameters);
+        sampleFunction = std::move(evalFunction);
+        sampleCount = samples;
+        return tune(method);
+    }
+
+    map<string, double> ParameterTuner::tune(TuningMethods method) {
+        //the distributions keep state between draws (normal_distribution caches its second value)
+        generator.seed((default_random_engine::result_type) seed);
+        norm_distribution.reset();
+        bern_dist.reset();
+        cachedSets.clear();
+        cachedErrorSums.clear();
+        cachedSampleCounts.clear();
+        cacheIndex.clear();
+        trace.clear();
+        evaluations = cacheHits = 0;
+        sampleEvaluations = 0;
+        bestError = 0;
+        if (!pool) pool.reset(new ThreadPool(threadCount));
         switch (method) {
             case TuningMethods::GENETIC_ALGORITHM:
                 return tuneWithGeneticAlgorithm();
+            case TuningMethods::CMA_ES:
+                return tuneWithCmaEs();
+            case TuningMethods::SUCCESSIVE_HALVING:
+                return tuneWithSuccessiveHalving();
             default:
                 return map<string, double>();
         }
@@ -35,25 +139,199 @@ namespace robosub {
 
     map<string, double>
     ParameterTuner::tuneWithGeneticAlgorithm() {
-        map<string, double> populationBuffer[generationSize];
-        vector<double> populationErrorLevels(generationSize);
+        size_t values = (size_t) generationSize * schema.size();
+        population.resize(values);
+        parents.resize(values);
+        populationErrorLevels.resize(generationSize);
+        selectionWeights.resize(generationSize);
+        memberSlots.resize(generationSize);
 
         cout << "Using genetic algorithm for parameter tuning. Generating initial population" << endl;
-        initialPopulationAvgError = generateInitialPopulation(populationBuffer, populationErrorLevels, generationSize);
+        initialPopulationAvgError = generateInitialPopulation();
         cout << "Average Error: " << initialPopulationAvgError << endl;
+        lastAvgError = initialPopulationAvgError;
+        recordTrace(0, memberSlots);
 
         for (int i = 0; i < 10; ++i) {
             cout << "Starting iteration " << i << " of genetic algorithm training" << endl;
             //put fitness percentage here
-            lastAvgError = generateNewPopulation(populationBuffer, populationErrorLevels, generationSize);
+            lastAvgError = generateNewPopulation();
             cout << "Average Error: " << lastAvgError << endl;
+            recordTrace(i + 1, memberSlots);
+        }
+
+        cout << "Determining the best possible parameter set (" << evaluations << " parameter sets scored, "
+             << cacheHits << " reused)" << endl;
+        return getBestParameterSet();
+    }
+
+    map<string, double> ParameterTuner::tuneWithCmaEs() {
+        int n = schema.size();
+        if (n == 0) return map<string, double>();
+
+        //default strategy parameters from Hansen's CMA-ES tutorial
+        int lambda = 4 + (int) (3 * log((double) n));
+        int mu = lambda / 2;
+        vector<double> weights(mu);
+        double weightSum = 0, weightSquares = 0;
+        for (int i = 0; i < mu; ++i) {
+            weights[i] = log(mu + 0.5) - log(i + 1.0);
+            weightSum += weights[i];
+        }
+        for (int i = 0; i < mu; ++i) {
+            weights[i] /= weightSum;
+            weightSquares += weights[i] * weights[i];
+        }
+        double muEff = 1 / weightSquares;
+        double cc = (4 + muEff / n) / (n + 4 + 2 * muEff / n);
+        double cs = (muEff + 2) / (n + muEff + 5);
+        double c1 = 2 / ((n + 1.3) * (n + 1.3) + muEff);
+        double cmu = min(1 - c1, 2 * (muEff - 2 + 1 / muEff) / ((n + 2) * (n + 2) + muEff));
+        double damps = 1 + 2 * max(0.0, sqrt((muEff - 1) / (n + 1)) - 1) + cs;
+        double chiN = sqrt((double) n) * (1 - 1.0 / (4 * n) + 1.0 / (21.0 * n * n));
+
+        //the search runs on parameters scaled to [0, 1] by their bounds, so one step size fits all of them
+        vector<double> lower(n), range(n);
+        Mat center(n, 1, CV_64F);
+        for (int i = 0; i < n; ++i) {
+            const ParameterMetadata &data = schema.getMetadata(i);
+            lower[i] = data.minValue;
+            range[i] = data.maxValue - data.minValue;
+            double scaled = range[i] > 0 ? (data.initValue - data.minValue) / range[i] : 0;
+            center.at<double>(i) = min(1.0, max(0.0, scaled));
+        }
+        double sigma = 0.3;
+        Mat pathSigma = Mat::zeros(n, 1, CV_64F), pathC = Mat::zeros(n, 1, CV_64F);
+        Mat C = Mat::eye(n, n, CV_64F), B, D(n, 1, CV_64F), eigenvalues, eigenvectors;
+        //step of every candidate from the center, in units of sigma
+        Mat steps(lambda, n, CV_64F), z(n, 1, CV_64F);
+        normal_distribution<double> standardNormal(0, 1);
+
+        cout << "Using CMA-ES for parameter tuning with " << lambda << " candidates per generation" << endl;
+
+        //the initial values are a candidate too, so tuning never returns worse than them
+        vector<double> initial(n);
+        schema.initialValues(initial.data());
+        memberSlots.assign(1, findOrAddSlot(initial.data()));
+        scoreSlots(memberSlots, sampleCount);
+        int bestSlot = memberSlots[0];
+
+        population.resize((size_t) lambda * n);
+        memberSlots.resize(lambda);
+        populationErrorLevels.resize(lambda);
+        vector<int> order(lambda);
+
+        for (int generation = 0; getEvaluationCost() < evaluationBudget; ++generation) {
+            C = (C + C.t()) * 0.5;
+            cv::eigen(C, eigenvalues, eigenvectors);
+            for (int i = 0; i < n; ++i) D.at<double>(i) = sqrt(max(eigenvalues.at<double>(i), 1e-20));
+            B = eigenvectors.t();
+            Mat BD = B * Mat::diag(D);
+
+            for (int k = 0; k < lambda; ++k) {
+                for (int i = 0; i < n; ++i) z.at<double>(i) = standardNormal(generator);
+                Mat y = BD * z;
+                double *x = member(population, k);
+                for (int i = 0; i < n; ++i) {
+                    //candidates outside the bounds are moved onto them, and the strategy learns from the moved step
+                    double scaled = min(1.0, max(0.0, center.at<double>(i) + sigma * y.at<double>(i)));
+                    steps.at<double>(k, i) = (scaled - center.at<double>(i)) / sigma;
+                    x[i] = lower[i] + scaled * range[i];
+                }
+                memberSlots[k] = findOrAddSlot(x);
+            }
+            scoreSlots(memberSlots, sampleCount);
+            recordTrace(generation, memberSlots);
+
+            for (int k = 0; k < lambda; ++k) {
+                order[k] = k;
+                populationErrorLevels[k] = slotError(memberSlots[k]);
+                if (populationErrorLevels[k] < slotError(bestSlot)) bestSlot = memberSlots[k];
+            }
+            stable_sort(order.begin(), order.end(), [this](int a, int b) {
+                return populationErrorLevels[a] < populationErrorLevels[b];
+            });
+            cout << "Generation " << generation << ": best error " << populationErrorLevels[order[0]]
+                 << ", step size " << sigma << endl;
+
+            Mat step = Mat::zeros(n, 1, CV_64F), rankMu = Mat::zeros(n, n, CV_64F);
+            for (int i = 0; i < mu; ++i) {
+                Mat y = steps.row(order[i]).t();
+                step += weights[i] * y;
+                rankMu += weights[i] * (y * y.t());
+            }
+            center += sigma * step;
+
+            Mat invSqrtC = B * Mat::diag(1.0 / D) * B.t();
+            pathSigma = (1 - cs) * pathSigma + sqrt(cs * (2 - cs) * muEff) * (invSqrtC * step);
+            double pathSigmaNorm = cv::norm(pathSigma);
+            bool stalled = pathSigmaNorm / sqrt(1 - pow(1 - cs, 2.0 * (generation + 1))) / chiN >= 1.4 + 2.0 / (n + 1);
+            pathC = (1 - cc) * pathC + (stalled ? 0.0 : sqrt(cc * (2 - cc) * muEff)) * step;
+            C = (1 - c1 - cmu) * C + c1 * (pathC * pathC.t() + (stalled ? cc * (2 - cc) : 0.0) * C) + cmu * rankMu;
+            sigma *= exp((cs / damps) * (pathSigmaNorm / chiN - 1));
+
+            //converged once no step moves a parameter by a noticeable part of its range
+            double maxVariance = 0;
+            for (int i = 0; i < n; ++i) maxVariance = max(maxVariance, C.at<double>(i, i));
+            if (sigma * sqrt(maxVariance) < 1e-6) break;
+        }
+
+        cout << "Best error " << slotError(bestSlot) << " after " << getEvaluationCost() << " evaluations" << endl;
+        bestError = slotError(bestSlot);
+        return schema.toMap(slotValues(bestSlot));
+    }
+
+    map<string, double> ParameterTuner::tuneWithSuccessiveHalving() {
+        int n = schema.size();
+        int candidates = generationSize * halvingRate;
+        population.resize((size_t) candidates * n);
+
+        //the initial values, then mutations of them alternating with uniform draws from the bounds
+        uniform_real_distribution<double> uniform(0, 1);
+        vector<int> survivors(candidates);
+        for (int c = 0; c < candidates; ++c) {
+            double *x = member(population, c);
+            schema.initialValues(x);
+            if (c % 2 == 1) {
+                mutateParameters(x);
+            } else if (c > 0) {
+                for (int i = 0; i < n; ++i) {
+                    const ParameterMetadata &data = schema.getMetadata(i);
+                    x[i] = data.minValue + uniform(generator) * (data.maxValue - data.minValue);
+                }
+            }
+            survivors[c] = findOrAddSlot(x);
+        }
+        //slots are numbered in the order they were added, so this keeps the first copy of every duplicate
+        sort(survivors.begin(), survivors.end());
+        survivors.erase(unique(survivors.begin(), survivors.end()), survivors.end());
+
+        //start with few enough samples that the last step scores the winner on all of them
+        int steps = 1;
+        for (size_t left = survivors.size(); left > 1; left = (left + halvingRate - 1) / halvingRate) steps++;
+        int samples = sampleCount;
+        for (int i = 1; i < steps; ++i) samples = max(1, samples / halvingRate);
+
+        cout << "Using successive halving for parameter tuning with " << survivors.size() << " candidates" << endl;
+        for (int step = 0;; ++step) {
+            scoreSlots(survivors, samples);
+            recordTrace(step, survivors);
+            stable_sort(survivors.begin(), survivors.end(), [this](int a, int b) {
+                return slotError(a) < slotError(b);
+            });
+            cout << "Step " << step << ": " << survivors.size() << " candidates on " << samples << " samples, best error "
+                 << slotError(survivors[0]) << endl;
+            if (survivors.size() == 1 && samples >= sampleCount) break;
+
+            survivors.resize(max((size_t) 1, (survivors.size() + halvingRate - 1) / halvingRate));
+            samples = survivors.size() == 1 ? sampleCount : min(sampleCount, samples * halvingRate);
         }
 
-        cout << "Determining the best possible parameter set" << endl;
-        return getBestParameterSet(populationBuffer, generationSize);
+        bestError = slotError(survivors[0]);
+        return schema.toMap(slotValues(survivors[0]));
     }
 
-    double ParameterTuner::mutateParameter(double currentValue, ParameterMetadata data) {
+    double ParameterTuner::mutateParameter(double currentValue, const ParameterMetadata &data) {
         double percentChange = norm_distribution(generator);
         percentChange = fastSigmoid(percentChange);
 
@@ -65,86 +343,178 @@ namespace robosub {
         }
     }
 
-    map<string, double>
-    ParameterTuner::mutateParameters(map<string, double> parameters, double mutRate) {
+    void ParameterTuner::mutateParameters(double *values, double mutRate) {
         bernoulli_distribution bern_distribution = bernoulli_distribution(mutRate);
 
-        for (auto const &kv : parameters) {
+        for (int i = 0; i < schema.size(); ++i) {
             if (bern_distribution(generator)) {
-                parameters[kv.first] = mutateParameter(kv.second, parameterMetadata.at(kv.first));
+                values[i] = mutateParameter(values[i], schema.getMetadata(i));
             }
         }
+    }
 
-        return parameters;
+    double *ParameterTuner::member(vector<double> &block, int index) {
+        return block.data() + (size_t) index * schema.size();
     }
 
-    double ParameterTuner::generateInitialPopulation(map<string, double> *populationBuffer,
-                                                     vector<double> &populationErrorLevels, int populationSize) {
-        map<string, double> startingParameters = map<string, double>();
+    double ParameterTuner::generateInitialPopulation() {
         double totalError = 0;
 
-        for (auto const &kv : parameterMetadata) {
-            startingParameters[kv.first] = kv.second.initValue;
+        for (int i = 0; i < generationSize; ++i) {
+            schema.initialValues(member(population, i));
+            mutateParameters(member(population, i));
         }
 
-        for (int i = 0; i < populationSize; ++i) {
-            populationBuffer[i] = mutateParameters(startingParameters);
-            populationErrorLevels[i] = evaluationFunction(populationBuffer[i]);
+        evaluatePopulation();
+        for (int i = 0; i < generationSize; ++i) {
             totalError += populationErrorLevels[i];
         }
 
-        return totalError / populationSize;
+        return totalError / generationSize;
+    }
+
+    size_t ParameterTuner::hashValues(const double *values) {
+        size_t seed = 0;
+        std::hash<double> hasher;
+        for (int i = 0; i < schema.size(); ++i) {
+            seed ^= hasher(values[i]) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+        }
+        return seed;
+    }
+
+    int ParameterTuner::findOrAddSlot(const double *values) {
+        size_t hash = hashValues(values);
+        auto range = cacheIndex.equal_range(hash);
+        for (auto it = range.first; it != range.second; ++it) {
+            if (equal(values, values + schema.size(), slotValues(it->second))) {
+                cacheHits++;
+                return it->second;
+            }
+        }
+
+        int slot = (int) cachedErrorSums.size();
+        cachedSets.insert(cachedSets.end(), values, values + schema.size());
+        cachedErrorSums.push_back(0);
+        cachedSampleCounts.push_back(0);
+        cacheIndex.insert({hash, slot});
+        return slot;
+    }
+
+    const double *ParameterTuner::slotValues(int slot) {
+        return cachedSets.data() + (size_t) slot * schema.size();
     }
 
-    double ParameterTuner::generateNewPopulation(map<string, double> *populationBuffer,
-                                                 vector<double> &populationErrorLevels, int populationSize) {
-        map<string, double> oldParameters[populationSize];
-        copy(populationBuffer, populationBuffer + populationSize, oldParameters);
+    double ParameterTuner::slotError(int slot) {
+        int scored = cachedSampleCounts[slot];
+        if (scored == 0 || scored == sampleCount) return cachedErrorSums[slot];
+        return cachedErrorSums[slot] / scored * sampleCount;
+    }
+
+    void ParameterTuner::scoreSlots(const vector<int> &slots, int samples) {
+        samples = min(samples, sampleCount);
+        sampleTasks.clear();
+        for (int slot : slots) {
+            if (cachedSampleCounts[slot] >= samples) continue;
+            if (cachedSampleCounts[slot] == 0) evaluations++;
+            for (int s = cachedSampleCounts[slot]; s < samples; ++s) sampleTasks.push_back({slot, s});
+            //counted before scoring, so a slot listed twice is only queued once
+            cachedSampleCounts[slot] = samples;
+        }
+
+        //each task writes only its own entry, and the sums are added up in task order afterwards, so the
+        //errors do not depend on the order tasks finish in
+        sampleErrors.assign(sampleTasks.size(), 0);
+        pool->parallelFor(0, (int) sampleTasks.size(), [this](int t) {
+            sampleErrors[t] = sampleFunction(ParameterSet(schema, slotValues(sampleTasks[t].first)),
+                                             sampleTasks[t].second);
+        });
+        for (size_t t = 0; t < sampleTasks.size(); ++t) {
+            cachedErrorSums[sampleTasks[t].first] += sampleErrors[t];
+        }
+        sampleEvaluations += (long long) sampleTasks.size();
+    }
+
+    void ParameterTuner::recordTrace(int iteration, const vector<int> &slots) {
+        TracePoint point;
+        point.iteration = iteration;
+        point.cost = getEvaluationCost();
+        point.bestError = 0;
+        point.meanError = 0;
+        for (size_t i = 0; i < slots.size(); ++i) {
+            double error = slotError(slots[i]);
+            if (i == 0 || error < point.bestError) point.bestError = error;
+            point.meanError += error / slots.size();
+        }
+        trace.push_back(point);
+    }
+
+    void ParameterTuner::evaluatePopulation() {
+        for (int i = 0; i < generationSize; ++i) {
+            memberSlots[i] = findOrAddSlot(member(population, i));
+        }
+        scoreSlots(memberSlots, sampleCount);
+
+        for (int i = 0; i < generationSize; ++i) {
+            populationErrorLevels[i] = slotError(memberSlots[i]);
+        }
+    }
+
+    double ParameterTuner::generateNewPopulation() {
+        int parameterCount = schema.size();
+        population.swap(parents);
         double totalError = 0;
 
-        discrete_distribution<int> distribution(populationErrorLevels.begin(), populationErrorLevels.end());
+        // Lower error means a higher chance of being picked as a parent
+        for (int i = 0; i < generationSize; ++i) {
+            selectionWeights[i] = 1.0 / (1.0 + populationErrorLevels[i]);
+        }
+        discrete_distribution<int> distribution(selectionWeights.begin(), selectionWeights.end());
 
-        for (int i = 0; i < populationSize; ++i) {
+        for (int i = 0; i < generationSize; ++i) {
             // Add index evaluation separately
-            auto firstParent = oldParameters[distribution(generator)];
-            auto secondParent = oldParameters[distribution(generator)];
+            const double *firstParent = member(parents, distribution(generator));
+            const double *secondParent = member(parents, distribution(generator));
 
-            for (auto const &kv: firstParent) {
+            double *child = member(population, i);
+            for (int p = 0; p < parameterCount; ++p) {
                 bool first = bern_dist(generator);
-                if (first) {
-                    populationBuffer[i].insert(kv);
-                } else {
-                    populationBuffer[i].insert({kv.first, secondParent[kv.first]});
-                }
+                child[p] = first ? firstParent[p] : secondParent[p];
             }
         }
 
         cout << "Getting final parameter values for population:" << endl;
-        for (int i = 0; i < populationSize; ++i) {
-            populationBuffer[i] = mutateParameters(populationBuffer[i]);
+        for (int i = 0; i < generationSize; ++i) {
+            mutateParameters(member(population, i));
+        }
 
-            populationErrorLevels[i] = evaluationFunction(populationBuffer[i]) * difficultyModifier();
+        evaluatePopulation();
+        for (int i = 0; i < generationSize; ++i) {
+            populationErrorLevels[i] *= difficultyModifier();
             cout << "\tError for parameter set " << i << ": " << populationErrorLevels[i] << endl;
             totalError += populationErrorLevels[i];
-
         }
 
-        return totalError / populationSize;
+        return totalError / generationSize;
     }
 
-    map<string, double> ParameterTuner::getBestParameterSet(map<string, double> *population, int populationSize) {
-        tuple<double, map<string, double>> bestParameterSet(-1, map<string, double>());
-        for (int i = 0; i < populationSize; ++i) {
-            auto error = evaluationFunction(population[i]);
-            if (error < get<0>(bestParameterSet) || get<0>(bestParameterSet) == -1)
-                bestParameterSet = make_tuple(error, population[i]);
+    map<string, double> ParameterTuner::getBestParameterSet() {
+        int best = -1;
+        for (int i = 0; i < generationSize; ++i) {
+            // Every member was scored when its generation was evaluated
+            double error = slotError(memberSlots[i]);
+            if (best == -1 || error < slotError(memberSlots[best]))
+                best = i;
         }
+        if (best == -1) return map<string, double>();
 
-        return get<1>(bestParameterSet);
+        bestError = slotError(memberSlots[best]);
+        return schema.toMap(member(population, best));
     }
 
 
-    ParameterTuner::ParameterTuner() {
+    ParameterTuner::ParameterTuner() : ParameterTuner(0) {}
+
+    ParameterTuner::ParameterTuner(int threads, unsigned long long seed) : threadCount(threads), seed(seed) {
         // Create a normal distribution with a good spread for our sigmoid function
         norm_distribution = normal_distribution<double>(0, 5);
         bern_dist = bernoulli_distribution();
@@ -154,4 +524,52 @@ namespace robosub {
         auto x = difficultyConstant * (lastAvgError / initialPopulationAvgError);
         return x * x + 1;
     }
+
+    int ParameterTuner::getEvaluationCount() {
+        return evaluations;
+    }
+
+    int ParameterTuner::getCacheHitCount() {
+        return cacheHits;
+    }
+
+    double ParameterTuner::getEvaluationCost() {
+        return (double) sampleEvaluations / sampleCount;
+    }
+
+    double ParameterTuner::getBestError() {
+        return bestError;
+    }
+
+    void ParameterTuner::setPopulationSize(int size) {
+        if (size < 1) throw invalid_argument("A population needs at least one member");
+        generationSize = size;
+    }
+
+    int ParameterTuner::getPopulationSize() {
+        return generationSize;
+    }
+
+    void ParameterTuner::setEvaluationBudget(double evaluations) {
+        evaluationBudget = evaluations;
+    }
+
+    double ParameterTuner::getEvaluationBudget() {
+        return evaluationBudget;
+    }
+
+    const vector<ParameterTuner::TracePoint> &ParameterTuner::getTrace() {
+        return trace;
+    }
+
+    bool ParameterTuner::writeTrace(const string &path) {
+        ofstream file(path);
+        if (!file.is_open()) return false;
+
+        file << "iteration,cost,best,mean" << endl;
+        for (const TracePoint &point : trace) {
+            file << point.iteration << "," << point.cost << "," << point.bestError << "," << point.meanError << endl;
+        }
+        return true;
+    }
 }
@@ -5,6 +5,7 @@
 #include <opencv2/opencv.hpp>
 #include <robosub/robosub.h>
 #include <utility>
+#include <algorithm>
 #include <robosub/image-processing/shape_recognition.h>
 
 
@@ -42,6 +43,13 @@ namespace robosub {
         }
     }
 
+    void ShapeFindResult::clearShapes() {
+        triangles.clear();
+        rectangles.clear();
+        squares.clear();
+        circles.clear();
+    }
+
     int ShapeFindResult::getLastTriangleCount() {
         if (triangleCounts.size() == 0) return 0;
 
@@ -92,21 +100,75 @@ namespace robosub {
     }
 
 
+    static void appendShapes(vector<vector<Point>> &to, const vector<vector<Point>> &from) {
+        to.insert(to.end(), from.begin(), from.end());
+    }
+
+    void ShapeFinder::classifyContours(vector<vector<Point>> &contours, const Mat &thresholdImage,
+                                       ShapeFindResult &result) {
+        int count = (int) contours.size();
+        int chunks = (count + CLASSIFY_CHUNK_SIZE - 1) / CLASSIFY_CHUNK_SIZE;
+        if ((int) chunkResults.size() < chunks) {
+            chunkResults.resize(chunks);
+            chunkMasks.resize(chunks);
+        }
+
+        parallel_for_(Range(0, chunks), [&](const Range &range) {
+            vector<Point> approx;
+            for (int chunk = range.start; chunk < range.end; chunk++) {
+                ShapeFindResult &buffer = chunkResults[chunk];
+                buffer.clearShapes();
+
+                int end = min((chunk + 1) * CLASSIFY_CHUNK_SIZE, count);
+                for (int i = chunk * CLASSIFY_CHUNK_SIZE; i < end; i++) {
+                    Contour c = Contour(contours[i]);
+
+                    //the area test is cheap; the color test has to rasterize the contour
+                    double area = c.area();
+                    if (area > MAX_AREA || area < MIN_AREA)
+                        continue;
+                    const Scalar &averageColor = c.averageColor(thresholdImage, chunkMasks[chunk]);
+                    if (averageColor[0] > CONTOUR_BLACK_THRESHOLD)
+                        continue;
+
+                    approxPolyDP(contours[i], approx, EPSILON_APPROX_TOLERANCE_FACTOR * c.perimeter(), true);
+                    classifyShape(buffer, approx);
+                }
+            }
+        });
+
+        //merge in chunk order so the output matches a serial run
+        for (int chunk = 0; chunk < chunks; chunk++) {
+            appendShapes(result.triangles, chunkResults[chunk].triangles);
+            appendShapes(result.rectangles, chunkResults[chunk].rectangles);
+            appendShapes(result.squares, chunkResults[chunk].squares);
+            appendShapes(result.circles, chunkResults[chunk].circles);
+        }
+    }
+
     Mat ShapeFinder::preprocessImage(Mat &input) {
+        long long start = Time::micros();
         Mat procImg = input;
         // Compute standard deviation for image
         meanStdDev(procImg, mu, sigma);
+        frameStatistics = true;
+        timings.convert += Time::micros() - start;
 
         // Remove small noise
+        start = Time::micros();
         ImageFilter::downsample(procImg, 2);
         ImageFilter::upsample(procImg, 2);
+        timings.blur = Time::micros() - start;
 
         // Threshold
+        start = Time::micros();
         double threshold1 = mu.val[0] - 2.0 * sigma.val[0];
         double threshold2 = mu.val[0] + 0.0 * sigma.val[0];
         Canny(procImg, procImg, threshold1, threshold2);
+        timings.edges = Time::micros() - start;
 
         // Erosion and dilation
+        start = Time::micros();
         Mat element = getStructuringElement(MORPH_RECT,
                                             Size(2 * EROSION_SIZE + 1, 2 * EROSION_SIZE + 1),
                                             Point(EROSION_SIZE, EROSION_SIZE));
@@ -114,54 +176,386 @@ namespace robosub {
         dilate(procImg, procImg, element);
         erode(procImg, procImg, element);
         dilate(procImg, procImg, element);
+        timings.morphology = Time::micros() - start;
 
         return procImg;
     }
 
-    ShapeFinder::ShapeFinder(Camera::CalibrationData calibrationData) {
-        this->calibrationData = std::move(calibrationData);
-    }
-
-    void ShapeFinder::processFrame(Mat &input, ShapeFindResult &result) {
-        result.triangles.clear();
-        result.rectangles.clear();
-        result.squares.clear();
-        result.circles.clear();
-        vector<vector<Point>> contours;
-        vector<Vec4i> hierarchy;
+    void ShapeFinder::processLegacy(Mat &input) {
+        long long start = Time::micros();
 
-        // undistort
-        input = Camera::undistort(input, calibrationData);
+        // undistort into a buffer kept between frames
+        Camera::undistort(input, undistortedImage, calibrationData);
 
         // Convert color for processing
-        cvtColor(input, input, COLOR_BGR2GRAY);
+        cvtColor(undistortedImage, input, COLOR_BGR2GRAY);
 
         // Threshold for getting black and white values
-        Mat thresholdImage;
+        // (single channel: the contour color test only reads the first channel)
         threshold(input, thresholdImage, IMAGE_BLACK_THRESHOLD, 255, 0);
-        cvtColor(thresholdImage, thresholdImage, cv::COLOR_GRAY2RGB);
+        timings.convert = Time::micros() - start;
 
         processedImage = preprocessImage(input);
+    }
 
-        findContours(processedImage, contours, hierarchy, RETR_EXTERNAL, CHAIN_APPROX_TC89_L1);
+    bool ShapeFinder::canProcessTiled(const Mat &input) {
+        //odd heights make the pyramid bands misalign with the full-frame result
+        return TILED_PREPROCESSING && input.type() == CV_8UC3 && input.rows % 2 == 0
+               && input.rows >= 2 * TILE_ROWS && input.cols >= 2;
+    }
 
-        for (auto &contour : contours) {
-            vector<Point> approx;
-            Contour c = Contour(contour);
-            approxPolyDP(contour, approx, EPSILON_APPROX_TOLERANCE_FACTOR * c.arcLength(true), true);
+    //copy rows [y0, y1) of src into a standalone buffer so filters see the band edge as an image border
+    static void copyBand(const Mat &src, int y0, int y1, Mat &band) {
+        src.rowRange(y0, y1).copyTo(band);
+    }
 
-            const Scalar &averageColor = c.averageColor(thresholdImage);
-            if (averageColor[0] > CONTOUR_BLACK_THRESHOLD)
-                continue;
-            if (c.area() > MAX_AREA || c.area() < MIN_AREA)
-                continue;
+    void ShapeFinder::processTiled(Mat &input) {
+        Size size = input.size();
+        int bands = (size.height + TILE_ROWS - 1) / TILE_ROWS;
+
+        // Pass 1: undistort, grayscale, threshold and pixel sums, one band at a time
+        long long start = Time::micros();
+        ensureUndistortMaps(size);
+        grayImage.create(size, CV_8UC1);
+        thresholdImage.create(size, CV_8UC1);
+        vector<int64_t> bandSum(bands, 0), bandSquares(bands, 0);
+
+        parallel_for_(Range(0, bands), [&](const Range &range) {
+            Mat color;
+            for (int b = range.start; b < range.end; b++) {
+                int y0 = b * TILE_ROWS;
+                int y1 = min(y0 + TILE_ROWS, size.height);
+
+                //remap reads the whole source frame, so the undistorted color band never leaves the cache
+                remap(input, color, undistortMap1.rowRange(y0, y1), undistortMap2.rowRange(y0, y1),
+                      INTER_LINEAR, BORDER_CONSTANT);
+                Mat gray = grayImage.rowRange(y0, y1);
+                cvtColor(color, gray, COLOR_BGR2GRAY);
+                Mat thresholded = thresholdImage.rowRange(y0, y1);
+                threshold(gray, thresholded, IMAGE_BLACK_THRESHOLD, 255, 0);
+
+                //integer sums make the statistics independent of the band layout
+                int64_t sum = 0, squares = 0;
+                for (int y = 0; y < gray.rows; y++) {
+                    const uchar *p = gray.ptr<uchar>(y);
+                    for (int x = 0; x < gray.cols; x++) {
+                        sum += p[x];
+                        squares += p[x] * p[x];
+                    }
+                }
+                bandSum[b] = sum;
+                bandSquares[b] = squares;
+            }
+        });
 
-            classifyShape(result, approx);
+        //same arithmetic as meanStdDev
+        int64_t sum = 0, squares = 0;
+        for (int b = 0; b < bands; b++) {
+            sum += bandSum[b];
+            squares += bandSquares[b];
         }
+        double scale = 1.0 / (double) size.area();
+        double mean = (double) sum * scale;
+        mu = Scalar(mean);
+        sigma = Scalar(std::sqrt(std::max((double) squares * scale - mean * mean, 0.0)));
+        frameStatistics = true;
+        timings.convert = Time::micros() - start;
+
+        // Pass 2: remove small noise; each band carries a halo so its center rows match the full-frame pyramid
+        start = Time::micros();
+        Size half(size.width / 2, size.height / 2);
+        blurredImage.create(Size(half.width * 2, size.height), CV_8UC1);
+
+        parallel_for_(Range(0, bands), [&](const Range &range) {
+            Mat band, down, up;
+            for (int b = range.start; b < range.end; b++) {
+                int y0 = b * TILE_ROWS;
+                int y1 = min(y0 + TILE_ROWS, size.height);
+                int h0 = max(y0 - PYRAMID_HALO, 0);
+                int h1 = min(y1 + PYRAMID_HALO, size.height);
+
+                copyBand(grayImage, h0, h1, band);
+                pyrDown(band, down, Size(half.width, band.rows / 2));
+                pyrUp(down, up, Size(half.width * 2, down.rows * 2));
+                up.rowRange(y0 - h0, y1 - h0).copyTo(blurredImage.rowRange(y0, y1));
+            }
+        });
+        timings.blur = Time::micros() - start;
+
+        // Pass 3: edge hysteresis connects pixels across the whole frame, so Canny cannot be tiled
+        //(cv::Canny is already multi-threaded)
+        start = Time::micros();
+        double threshold1 = mu.val[0] - 2.0 * sigma.val[0];
+        double threshold2 = mu.val[0] + 0.0 * sigma.val[0];
+        Canny(blurredImage, edgeImage, threshold1, threshold2);
+        timings.edges = Time::micros() - start;
+
+        // Pass 4: dilate, erode, dilate per band; three passes need three kernel radii of halo
+        start = Time::micros();
+        Mat element = getStructuringElement(MORPH_RECT,
+                                            Size(2 * EROSION_SIZE + 1, 2 * EROSION_SIZE + 1),
+                                            Point(EROSION_SIZE, EROSION_SIZE));
+        int halo = 3 * EROSION_SIZE;
+        processedImage.create(edgeImage.size(), CV_8UC1);
+
+        parallel_for_(Range(0, bands), [&](const Range &range) {
+            Mat band, work;
+            for (int b = range.start; b < range.end; b++) {
+                int y0 = b * TILE_ROWS;
+                int y1 = min(y0 + TILE_ROWS, size.height);
+                int h0 = max(y0 - halo, 0);
+                int h1 = min(y1 + halo, size.height);
+
+                copyBand(edgeImage, h0, h1, band);
+                dilate(band, work, element);
+                erode(work, band, element);
+                dilate(band, work, element);
+                work.rowRange(y0 - h0, y1 - h0).copyTo(processedImage.rowRange(y0, y1));
+            }
+        });
+        timings.morphology = Time::micros() - start;
+
+        //callers get the undistorted grayscale frame, as with the full-frame path; copying keeps
+        //grayImage's buffer for the next frame, and a caller that passes the same Mat back reuses its own
+        grayImage.copyTo(input);
+    }
+
+    void ShapeFinder::ensureUndistortMaps(Size size) {
+        if (undistortMapSize != size) {
+            Camera::initUndistortMaps(size, calibrationData, undistortMap1, undistortMap2);
+            undistortMapSize = size;
+        }
+    }
+
+    //union of every pair of overlapping rectangles, so no pixel is searched twice
+    static void mergeOverlapping(vector<Rect> &rects) {
+        bool merged = true;
+        while (merged) {
+            merged = false;
+            for (size_t i = 0; i < rects.size() && !merged; i++) {
+                for (size_t j = i + 1; j < rects.size(); j++) {
+                    if ((rects[i] & rects[j]).area() > 0) {
+                        rects[i] |= rects[j];
+                        rects.erase(rects.begin() + j);
+                        merged = true;
+                        break;
+                    }
+                }
+            }
+        }
+    }
+
+    static void offsetShapes(vector<vector<Point>> &to, const vector<vector<Point>> &from, Point offset) {
+        for (const vector<Point> &shape : from) {
+            to.push_back(shape);
+            for (Point &p : to.back()) p += offset;
+        }
+    }
+
+    void ShapeFinder::processRegion(const Mat &input, Rect region, ShapeFindResult &result) {
+        Mat color, gray, threshold, blurred, edges, work;
+
+        //even origin and size keep the pyramid samples on the full-frame grid; the far edges are kept
+        //where they were, so rounding the origin down never drops the last row or column
+        Rect frame(Point(), input.size());
+        int right = region.x + region.width, bottom = region.y + region.height;
+        region.x &= ~1;
+        region.y &= ~1;
+        region.width = right - region.x;
+        region.height = bottom - region.y;
+        region.width += region.width & 1;
+        region.height += region.height & 1;
+        region &= frame;
+        if (region.width < 4 || region.height < 4) return;
+
+        //the map entries are absolute source coordinates, so a sub-table undistorts just this crop
+        long long start = Time::micros();
+        remap(input, color, undistortMap1(region), undistortMap2(region), INTER_LINEAR, BORDER_CONSTANT);
+        cvtColor(color, gray, COLOR_BGR2GRAY);
+        cv::threshold(gray, threshold, IMAGE_BLACK_THRESHOLD, 255, 0);
+        timings.convert += Time::micros() - start;
+
+        start = Time::micros();
+        pyrDown(gray, blurred, Size(region.width / 2, region.height / 2));
+        pyrUp(blurred, blurred, region.size());
+        timings.blur += Time::micros() - start;
+
+        //Canny uses the statistics of the last full frame, so thresholds do not depend on what the crop shows
+        start = Time::micros();
+        Scalar regionMu = mu, regionSigma = sigma;
+        if (!frameStatistics) meanStdDev(gray, regionMu, regionSigma);
+        Canny(blurred, edges, regionMu.val[0] - 2.0 * regionSigma.val[0], regionMu.val[0]);
+        timings.edges += Time::micros() - start;
+
+        start = Time::micros();
+        Mat element = getStructuringElement(MORPH_RECT,
+                                            Size(2 * EROSION_SIZE + 1, 2 * EROSION_SIZE + 1),
+                                            Point(EROSION_SIZE, EROSION_SIZE));
+        dilate(edges, work, element);
+        erode(work, edges, element);
+        dilate(edges, work, element);
+        timings.morphology += Time::micros() - start;
+
+        start = Time::micros();
+        vector<vector<Point>> contours;
+        vector<Vec4i> hierarchy;
+        findContours(work, contours, hierarchy, RETR_EXTERNAL, CHAIN_APPROX_TC89_L1);
+
+        //a contour cut by the crop edge is only part of a shape; the frame edge cuts it on the full path too
+        contours.erase(std::remove_if(contours.begin(), contours.end(), [&](const vector<Point> &contour) {
+            Rect bounds = boundingRect(contour);
+            return (bounds.x == 0 && region.x > 0) || (bounds.y == 0 && region.y > 0) ||
+                   (bounds.br().x == region.width && region.br().x < frame.width) ||
+                   (bounds.br().y == region.height && region.br().y < frame.height);
+        }), contours.end());
+        timings.contours += Time::micros() - start;
+
+        start = Time::micros();
+        ShapeFindResult regionResult;
+        classifyContours(contours, threshold, regionResult);
+        offsetShapes(result.triangles, regionResult.triangles, region.tl());
+        offsetShapes(result.squares, regionResult.squares, region.tl());
+        offsetShapes(result.rectangles, regionResult.rectangles, region.tl());
+        offsetShapes(result.circles, regionResult.circles, region.tl());
+        timings.classify += Time::micros() - start;
+    }
+
+    void ShapeFinder::processRegions(const Mat &input, const vector<Rect> &regions, ShapeFindResult &result,
+                                     int padding) {
+        CV_Assert(input.type() == CV_8UC3);
+        long long start = Time::micros();
+        timings = Timings();
+        result.clearShapes();
+        ensureUndistortMaps(input.size());
+
+        vector<Rect> padded;
+        for (const Rect &r : regions) {
+            Rect p = Rect(r.x - padding, r.y - padding, r.width + 2 * padding, r.height + 2 * padding) &
+                     Rect(Point(), input.size());
+            if (p.area() > 0) padded.push_back(p);
+        }
+        mergeOverlapping(padded);
+
+        for (const Rect &region : padded) processRegion(input, region, result);
+        timings.total = Time::micros() - start;
+    }
+
+    ShapeFinder::ShapeFinder(Camera::CalibrationData calibrationData) {
+        this->calibrationData = std::move(calibrationData);
+    }
+
+    void ShapeFinder::processFrame(Mat &input, ShapeFindResult &result) {
+        long long start = Time::micros();
+        timings = Timings();
+
+        result.clearShapes();
+        vector<vector<Point>> contours;
+        vector<Vec4i> hierarchy;
+
+        if (canProcessTiled(input)) processTiled(input);
+        else processLegacy(input);
+
+        long long stageStart = Time::micros();
+        findContours(processedImage, contours, hierarchy, RETR_EXTERNAL, CHAIN_APPROX_TC89_L1);
+        timings.contours = Time::micros() - stageStart;
+
+        stageStart = Time::micros();
+        classifyContours(contours, thresholdImage, result);
+        timings.classify = Time::micros() - stageStart;
 
         result.addCount(result.triangleCounts, result.triangles.size());
         result.addCount(result.squareCounts, result.squares.size());
         result.addCount(result.rectangleCounts, result.rectangles.size());
         result.addCount(result.circleCounts, result.circles.size());
+
+        timings.total = Time::micros() - start;
+    }
+
+    ShapeFinder::Timings ShapeFinder::getTimings() {
+        return timings;
+    }
+
+    Camera::CalibrationData ShapeFinder::getCalibrationData() const {
+        return calibrationData;
+    }
+
+    void ShapeFinder::copySettings(const ShapeFinder &other) {
+        EPSILON_APPROX_TOLERANCE_FACTOR = other.EPSILON_APPROX_TOLERANCE_FACTOR;
+        MIN_AREA = other.MIN_AREA;
+        MAX_AREA = other.MAX_AREA;
+        SQUARE_RATIO_THRESHOLD = other.SQUARE_RATIO_THRESHOLD;
+        TRIANGLE_RATIO_THRESHOLD = other.TRIANGLE_RATIO_THRESHOLD;
+        EROSION_SIZE = other.EROSION_SIZE;
+        IMAGE_BLACK_THRESHOLD = other.IMAGE_BLACK_THRESHOLD;
+        CONTOUR_BLACK_THRESHOLD = other.CONTOUR_BLACK_THRESHOLD;
+        TILED_PREPROCESSING = other.TILED_PREPROCESSING;
+    }
+
+    ShapeFinderBatch::ShapeFinderBatch(const ShapeFinder &prototype, int threads)
+            : prototype(prototype.getCalibrationData()), pool(threads) {
+        //copying the finder itself would share its image buffers with the caller's finder
+        this->prototype.copySettings(prototype);
+        //one set per worker, plus one for work that runs on a thread outside the pool
+        finders.resize((size_t) pool.getThreadCount() + 1);
+    }
+
+    ShapeFinder &ShapeFinderBatch::getPrototype() {
+        return prototype;
+    }
+
+    void ShapeFinderBatch::setCalibration(int sourceId, Camera::CalibrationData calibrationData) {
+        calibrations[sourceId] = calibrationData;
+        //drop finders built with the old calibration
+        for (auto &workerFinders : finders) workerFinders.erase(sourceId);
+    }
+
+    ShapeFinder &ShapeFinderBatch::getFinder(int worker, int sourceId) {
+        //only ever called from the worker that owns the map
+        std::unique_ptr<ShapeFinder> &finder = finders[worker][sourceId];
+        if (!finder) {
+            auto calibration = calibrations.find(sourceId);
+            finder.reset(new ShapeFinder(calibration != calibrations.end() ? calibration->second
+                                                                           : prototype.getCalibrationData()));
+        }
+        return *finder;
+    }
+
+    void ShapeFinderBatch::process(vector<ShapeFindJob> &jobs, vector<ShapeFindBatchResult> &results) {
+        results.resize(jobs.size());
+
+        //create per-source finders up front so workers only read the calibration table
+        for (ShapeFindJob &job : jobs) {
+            for (int worker = 0; worker < (int) finders.size(); worker++) getFinder(worker, job.sourceId);
+        }
+        for (auto &workerFinders : finders) {
+            for (auto &finder : workerFinders) finder.second->copySettings(prototype);
+        }
+
+        pool.parallelFor(0, (int) jobs.size(), [this, &jobs, &results](int i) {
+            ShapeFindBatchResult &result = results[i];
+            result.sourceId = jobs[i].sourceId;
+            result.timestamp = jobs[i].timestamp;
+            result.result = ShapeFindResult();
+
+            //frames of the same source may run on different workers, so each worker has its own finder
+            int worker = pool.currentWorker();
+            if (worker < 0) worker = pool.getThreadCount();
+            ShapeFinder &finder = *finders[worker][jobs[i].sourceId];
+            finder.processFrame(jobs[i].frame, result.result);
+        });
+
+        //the count history depends on frame order, so it is built after all workers finish
+        for (ShapeFindBatchResult &result : results) {
+            ShapeFindResult &h = history[result.sourceId];
+            ShapeFindResult &r = result.result;
+            h.addCount(h.triangleCounts, (int) r.triangles.size());
+            h.addCount(h.squareCounts, (int) r.squares.size());
+            h.addCount(h.rectangleCounts, (int) r.rectangles.size());
+            h.addCount(h.circleCounts, (int) r.circles.size());
+            r.triangleCounts = h.triangleCounts;
+            r.squareCounts = h.squareCounts;
+            r.rectangleCounts = h.rectangleCounts;
+            r.circleCounts = h.circleCounts;
+        }
     }
-}
\ No newline at end of file
+}
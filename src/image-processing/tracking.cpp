@@ -0,0 +1,251 @@
+#include <opencv2/opencv.hpp>
+#include <robosub/robosub.h>
+#include <robosub/image-processing/tracking.h>
+
+#include <algorithm>
+
+namespace robosub {
+    ObjectTracker::ObjectTracker() : ObjectTracker(Settings()) {}
+
+    ObjectTracker::ObjectTracker(Settings settings) : settings(settings) {}
+
+    double ObjectTracker::intersectionOverUnion(const Rect &a, const Rect &b) {
+        double intersection = (a & b).area();
+        double combined = a.area() + b.area() - intersection;
+        return combined > 0 ? intersection / combined : 0;
+    }
+
+    void ObjectTracker::initFilter(Filter &filter, const Detection &detection) {
+        //state (cx, cy, vx, vy, w, h), measurement (cx, cy, w, h), one step per frame
+        KalmanFilter &k = filter.kalman;
+        k.init(6, 4, 0, CV_32F);
+        setIdentity(k.transitionMatrix);
+        k.transitionMatrix.at<float>(0, 2) = 1;
+        k.transitionMatrix.at<float>(1, 3) = 1;
+        k.measurementMatrix = Mat::zeros(4, 6, CV_32F);
+        k.measurementMatrix.at<float>(0, 0) = 1;
+        k.measurementMatrix.at<float>(1, 1) = 1;
+        k.measurementMatrix.at<float>(2, 4) = 1;
+        k.measurementMatrix.at<float>(3, 5) = 1;
+        setIdentity(k.processNoiseCov, Scalar::all(settings.processNoise));
+        setIdentity(k.measurementNoiseCov, Scalar::all(settings.measurementNoise));
+        //the first velocity is unknown
+        setIdentity(k.errorCovPost, Scalar::all(settings.measurementNoise));
+        k.errorCovPost.at<float>(2, 2) = k.errorCovPost.at<float>(3, 3) = 100;
+
+        k.statePost.at<float>(0) = detection.bounds.x + detection.bounds.width / 2.0f;
+        k.statePost.at<float>(1) = detection.bounds.y + detection.bounds.height / 2.0f;
+        k.statePost.at<float>(2) = 0;
+        k.statePost.at<float>(3) = 0;
+        k.statePost.at<float>(4) = (float) detection.bounds.width;
+        k.statePost.at<float>(5) = (float) detection.bounds.height;
+
+        filter.track = Track();
+        filter.track.id = nextId++;
+        filter.track.type = detection.type;
+        filter.track.hits = 1;
+        updateTrack(filter);
+    }
+
+    void ObjectTracker::updateTrack(Filter &filter) {
+        const Mat &s = filter.kalman.statePost;
+        Track &t = filter.track;
+        float w = max(s.at<float>(4), 1.0f), h = max(s.at<float>(5), 1.0f);
+        t.center = Point2f(s.at<float>(0), s.at<float>(1));
+        t.velocity = Point2f(s.at<float>(2), s.at<float>(3));
+        t.bounds = Rect(cvRound(t.center.x - w / 2), cvRound(t.center.y - h / 2), cvRound(w), cvRound(h));
+    }
+
+    void ObjectTracker::refreshTracks() {
+        tracks.clear();
+        for (Filter &filter : filters) tracks.push_back(filter.track);
+    }
+
+    void ObjectTracker::predict() {
+        for (Filter &filter : filters) {
+            //predict() also copies the prediction into statePost, so unmatched tracks coast on it
+            filter.kalman.predict();
+            filter.track.age++;
+            updateTrack(filter);
+        }
+        framesSinceDetection++;
+        refreshTracks();
+    }
+
+    vector<int> ObjectTracker::match(const vector<Detection> &detections, const vector<bool> &eligible) {
+        struct Candidate {
+            double score;
+            int filter, detection;
+        };
+        vector<Candidate> candidates;
+        for (int f = 0; f < (int) filters.size(); f++) {
+            if (!eligible[f]) continue;
+            const Track &track = filters[f].track;
+            for (int d = 0; d < (int) detections.size(); d++) {
+                const Detection &detection = detections[d];
+                if (detection.type != track.type) continue;
+
+                double iou = intersectionOverUnion(track.bounds, detection.bounds);
+                Point2f center(detection.bounds.x + detection.bounds.width / 2.0f,
+                               detection.bounds.y + detection.bounds.height / 2.0f);
+                double distance = norm(center - track.center);
+                //overlapping pairs rank above pairs that are only close
+                if (iou >= settings.minIoU) candidates.push_back({1.0 + iou, f, d});
+                else if (distance <= settings.maxCenterDistance)
+                    candidates.push_back({1.0 - distance / (settings.maxCenterDistance + 1.0), f, d});
+            }
+        }
+        std::sort(candidates.begin(), candidates.end(), [](const Candidate &a, const Candidate &b) {
+            return a.score > b.score;
+        });
+
+        vector<int> assignment(filters.size(), -1);
+        vector<bool> used(detections.size(), false);
+        for (const Candidate &c : candidates) {
+            if (assignment[c.filter] >= 0 || used[c.detection]) continue;
+            assignment[c.filter] = c.detection;
+            used[c.detection] = true;
+        }
+        return assignment;
+    }
+
+    void ObjectTracker::correctFilter(Filter &filter, const Detection &detection) {
+        Mat measurement(4, 1, CV_32F);
+        measurement.at<float>(0) = detection.bounds.x + detection.bounds.width / 2.0f;
+        measurement.at<float>(1) = detection.bounds.y + detection.bounds.height / 2.0f;
+        measurement.at<float>(2) = (float) detection.bounds.width;
+        measurement.at<float>(3) = (float) detection.bounds.height;
+        filter.kalman.correct(measurement);
+        filter.track.hits++;
+        filter.track.misses = 0;
+        updateTrack(filter);
+    }
+
+    void ObjectTracker::removeLost() {
+        filters.erase(std::remove_if(filters.begin(), filters.end(), [this](const Filter &filter) {
+            return filter.track.misses > settings.maxMisses;
+        }), filters.end());
+    }
+
+    void ObjectTracker::update(const vector<Detection> &detections) {
+        vector<int> assignment = match(detections, vector<bool>(filters.size(), true));
+        vector<bool> used(detections.size(), false);
+
+        for (size_t f = 0; f < filters.size(); f++) {
+            if (assignment[f] >= 0) {
+                correctFilter(filters[f], detections[assignment[f]]);
+                used[assignment[f]] = true;
+            } else {
+                filters[f].track.misses++;
+            }
+        }
+        removeLost();
+
+        for (size_t d = 0; d < detections.size(); d++) {
+            if (used[d]) continue;
+            filters.push_back(Filter());
+            initFilter(filters.back(), detections[d]);
+        }
+
+        framesSinceDetection = 0;
+        lostSinceDetection = false;
+        refreshTracks();
+    }
+
+    void ObjectTracker::correct(const vector<Detection> &detections, const vector<int> &searched) {
+        vector<bool> eligible(filters.size(), false);
+        for (int index : searched) {
+            if (index >= 0 && index < (int) filters.size()) eligible[index] = true;
+        }
+        vector<int> assignment = match(detections, eligible);
+
+        for (size_t f = 0; f < filters.size(); f++) {
+            if (assignment[f] >= 0) {
+                correctFilter(filters[f], detections[assignment[f]]);
+            } else if (eligible[f]) {
+                //searched where it should be and not found: a full detection has to find it again
+                filters[f].track.misses++;
+                lostSinceDetection = true;
+            }
+        }
+        removeLost();
+        refreshTracks();
+    }
+
+    bool ObjectTracker::needsDetection() {
+        if (framesSinceDetection >= settings.detectionInterval || lostSinceDetection) return true;
+        //new tracks are confirmed by full detections, not by their own search regions
+        for (const Filter &filter : filters) {
+            if (!filter.track.confirmed(settings.minHits)) return true;
+        }
+        return false;
+    }
+
+    const vector<ObjectTracker::Track> &ObjectTracker::getTracks() {
+        return tracks;
+    }
+
+    vector<Rect> ObjectTracker::getSearchRegions(int padding, Size frameSize) {
+        vector<Rect> regions;
+        for (const Filter &filter : filters) {
+            Rect r = filter.track.bounds;
+            regions.push_back(Rect(r.x - padding, r.y - padding, r.width + 2 * padding, r.height + 2 * padding) &
+                              Rect(Point(), frameSize));
+        }
+        return regions;
+    }
+
+    void ObjectTracker::reset() {
+        filters.clear();
+        tracks.clear();
+        framesSinceDetection = 0;
+        lostSinceDetection = false;
+    }
+
+    ShapeTracker::ShapeTracker(ShapeFinder &finder) : finder(finder) {}
+
+    ShapeTracker::ShapeTracker(ShapeFinder &finder, ObjectTracker::Settings settings)
+            : finder(finder), tracker(settings) {}
+
+    vector<ObjectTracker::Detection> ShapeTracker::toDetections(const ShapeFindResult &result) {
+        vector<ObjectTracker::Detection> detections;
+        const vector<vector<Point>> *shapes[] = {&result.triangles, &result.squares, &result.rectangles,
+                                                 &result.circles};
+        for (int type = TRIANGLE; type <= CIRCLE; type++) {
+            for (const vector<Point> &shape : *shapes[type]) {
+                detections.push_back({type, boundingRect(shape)});
+            }
+        }
+        return detections;
+    }
+
+    void ShapeTracker::processFrame(Mat &input, ShapeFindResult &result) {
+        tracker.predict();
+        detected = tracker.needsDetection();
+        if (detected) {
+            finder.processFrame(input, result);
+            tracker.update(toDetections(result));
+        } else {
+            //search only around the predictions; tracks whose region left the frame coast on them
+            vector<Rect> regions = tracker.getSearchRegions(SEARCH_PADDING, input.size());
+            vector<int> searched;
+            for (int i = 0; i < (int) regions.size(); i++) {
+                if (regions[i].area() > 0) searched.push_back(i);
+            }
+            finder.processRegions(input, regions, result);
+            tracker.correct(toDetections(result), searched);
+        }
+    }
+
+    bool ShapeTracker::ranDetection() {
+        return detected;
+    }
+
+    const vector<ObjectTracker::Track> &ShapeTracker::getTracks() {
+        return tracker.getTracks();
+    }
+
+    ObjectTracker &ShapeTracker::getTracker() {
+        return tracker;
+    }
+}
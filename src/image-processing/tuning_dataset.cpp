@@ -0,0 +1,230 @@
+#include <opencv2/opencv.hpp>
+#include <robosub/robosub.h>
+#include <robosub/image-processing/tuning_dataset.h>
+
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+
+#ifdef _WIN32
+#include <fstream>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace robosub {
+    static const char MAGIC[8] = {'R', 'S', 'T', 'U', 'N', 'E', '\0', '\0'};
+
+    const uint32_t TuningDataset::VERSION;
+
+    static uint64_t align(uint64_t offset, uint64_t alignment) {
+        return (offset + alignment - 1) / alignment * alignment;
+    }
+
+    TuningDataset::TuningDataset() {}
+
+    TuningDataset::~TuningDataset() {
+        close();
+    }
+
+    bool TuningDataset::open(const string &path) {
+        close();
+#ifdef _WIN32
+        //no mapping here: read the whole file into one buffer, still shared by every sample
+        ifstream file(path, ios::binary | ios::ate);
+        if (!file.is_open()) return false;
+        length = (size_t) file.tellg();
+        data = (unsigned char *) malloc(length > 0 ? length : 1);
+        file.seekg(0);
+        if (!data || !file.read((char *) data, length)) {
+            close();
+            return false;
+        }
+#else
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) return false;
+        struct stat status;
+        if (fstat(fd, &status) != 0 || status.st_size <= 0) {
+            ::close(fd);
+            return false;
+        }
+        length = (size_t) status.st_size;
+        void *mapping = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+        if (mapping == MAP_FAILED) {
+            length = 0;
+            return false;
+        }
+        data = (unsigned char *) mapping;
+        //start reading the pixels in the background; tuning touches every image soon anyway
+        madvise(data, length, MADV_WILLNEED);
+#endif
+        if (!validate()) {
+            close();
+            return false;
+        }
+        return true;
+    }
+
+    void TuningDataset::close() {
+        if (data) {
+#ifdef _WIN32
+            free(data);
+#else
+            munmap(data, length);
+#endif
+        }
+        data = nullptr;
+        length = 0;
+        index = nullptr;
+        labels = nullptr;
+        names.clear();
+        sampleCount = 0;
+    }
+
+    bool TuningDataset::validate() {
+        if (length < sizeof(Header)) return false;
+        Header header;
+        memcpy(&header, data, sizeof(Header));
+        if (memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 || header.version != VERSION) return false;
+
+        uint64_t indexBytes = (uint64_t) header.sampleCount * sizeof(IndexEntry);
+        uint64_t labelBytes = header.labelCount * sizeof(Label);
+        if (header.indexOffset % 8 != 0 || header.labelsOffset % 8 != 0) return false;
+        if (header.indexOffset + indexBytes > length || header.labelsOffset + labelBytes > length) return false;
+
+        uint64_t offset = header.namesOffset;
+        for (uint32_t i = 0; i < header.nameCount; i++) {
+            uint32_t nameLength;
+            if (offset + sizeof(nameLength) > length) return false;
+            memcpy(&nameLength, data + offset, sizeof(nameLength));
+            offset += sizeof(nameLength);
+            if (offset + nameLength > length) return false;
+            names.push_back(string((const char *) data + offset, nameLength));
+            offset += nameLength;
+        }
+
+        index = (const IndexEntry *) (data + header.indexOffset);
+        labels = (const Label *) (data + header.labelsOffset);
+        for (uint32_t i = 0; i < header.sampleCount; i++) {
+            const IndexEntry &entry = index[i];
+            if (entry.rows < 0 || entry.cols < 0 || CV_MAT_TYPE(entry.type) != entry.type) return false;
+            uint64_t imageBytes = (uint64_t) entry.rows * entry.cols * CV_ELEM_SIZE(entry.type);
+            if (entry.imageOffset + imageBytes > length) return false;
+            if (entry.firstLabel + entry.labelCount > header.labelCount) return false;
+            for (uint32_t l = 0; l < entry.labelCount; l++) {
+                if (labels[entry.firstLabel + l].name >= header.nameCount) return false;
+            }
+        }
+        sampleCount = (int) header.sampleCount;
+        return true;
+    }
+
+    bool TuningDataset::isOpen() const {
+        return data != nullptr;
+    }
+
+    int TuningDataset::size() const {
+        return sampleCount;
+    }
+
+    Mat TuningDataset::getImage(int i) const {
+        if (i < 0 || i >= sampleCount) throw out_of_range("No sample " + to_string(i) + " in the dataset");
+        const IndexEntry &entry = index[i];
+        if (entry.rows == 0 || entry.cols == 0) return Mat();
+        return Mat(entry.rows, entry.cols, entry.type, data + entry.imageOffset);
+    }
+
+    map<string, double> TuningDataset::getLabels(int i) const {
+        if (i < 0 || i >= sampleCount) throw out_of_range("No sample " + to_string(i) + " in the dataset");
+        map<string, double> values;
+        const IndexEntry &entry = index[i];
+        for (uint32_t l = 0; l < entry.labelCount; l++) {
+            const Label &label = labels[entry.firstLabel + l];
+            values[names[label.name]] = label.value;
+        }
+        return values;
+    }
+
+    bool TuningDataset::write(const string &path, const vector<Mat> &images,
+                              const vector<map<string, double>> &labels) {
+        if (images.size() != labels.size()) throw invalid_argument("Every image needs a set of labels");
+
+        //every label name once, numbered in sorted order
+        map<string, uint32_t> nameIds;
+        uint64_t labelCount = 0;
+        for (const map<string, double> &sampleLabels : labels) {
+            for (auto const &label : sampleLabels) nameIds[label.first] = 0;
+            labelCount += sampleLabels.size();
+        }
+        Header header;
+        memcpy(header.magic, MAGIC, sizeof(MAGIC));
+        header.version = VERSION;
+        header.sampleCount = (uint32_t) images.size();
+        header.nameCount = (uint32_t) nameIds.size();
+        header.reserved = 0;
+        header.labelCount = labelCount;
+        header.namesOffset = sizeof(Header);
+        uint64_t offset = header.namesOffset;
+        uint32_t nextId = 0;
+        for (auto &name : nameIds) {
+            name.second = nextId++;
+            offset += sizeof(uint32_t) + name.first.size();
+        }
+        header.indexOffset = align(offset, 8);
+        header.labelsOffset = header.indexOffset + header.sampleCount * sizeof(IndexEntry);
+
+        vector<IndexEntry> entries(images.size());
+        offset = header.labelsOffset + labelCount * sizeof(Label);
+        uint64_t firstLabel = 0;
+        for (size_t i = 0; i < images.size(); i++) {
+            const Mat &image = images[i];
+            if (image.dims > 2) throw invalid_argument("Packed images must be two-dimensional");
+            entries[i].imageOffset = align(offset, 64);
+            entries[i].rows = image.rows;
+            entries[i].cols = image.cols;
+            entries[i].type = image.type();
+            entries[i].labelCount = (uint32_t) labels[i].size();
+            entries[i].firstLabel = firstLabel;
+            firstLabel += labels[i].size();
+            offset = entries[i].imageOffset + (uint64_t) image.total() * image.elemSize();
+        }
+
+        ofstream file(path, ios::binary | ios::trunc);
+        if (!file.is_open()) return false;
+        const char zeros[64] = {};
+        auto padTo = [&file, &zeros](uint64_t target) {
+            uint64_t position = (uint64_t) file.tellp();
+            if (target > position) file.write(zeros, (streamsize) (target - position));
+        };
+
+        file.write((const char *) &header, sizeof(Header));
+        for (auto const &name : nameIds) {
+            uint32_t nameLength = (uint32_t) name.first.size();
+            file.write((const char *) &nameLength, sizeof(nameLength));
+            file.write(name.first.data(), nameLength);
+        }
+        padTo(header.indexOffset);
+        file.write((const char *) entries.data(), (streamsize) (entries.size() * sizeof(IndexEntry)));
+        for (const map<string, double> &sampleLabels : labels) {
+            for (auto const &value : sampleLabels) {
+                Label label;
+                label.name = nameIds.at(value.first);
+                label.reserved = 0;
+                label.value = value.second;
+                file.write((const char *) &label, sizeof(Label));
+            }
+        }
+        for (size_t i = 0; i < images.size(); i++) {
+            padTo(entries[i].imageOffset);
+            const Mat &image = images[i];
+            //row by row, so images that are views into larger ones are packed without their gaps
+            size_t rowBytes = image.cols * image.elemSize();
+            for (int y = 0; y < image.rows; y++) file.write((const char *) image.ptr(y), (streamsize) rowBytes);
+        }
+        return file.good();
+    }
+}
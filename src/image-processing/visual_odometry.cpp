@@ -0,0 +1,152 @@
+#include <opencv2/opencv.hpp>
+#include <robosub/robosub.h>
+#include <robosub/image-processing/visual_odometry.h>
+
+namespace robosub {
+    //levels narrower than this have too few corners to fit a motion
+    static const int MIN_ANALYSIS_WIDTH = 40;
+
+    VisualOdometry::VisualOdometry() : VisualOdometry(Settings()) {}
+
+    VisualOdometry::VisualOdometry(Settings settings) {
+        setSettings(settings);
+    }
+
+    VisualOdometry::Motion VisualOdometry::process(const Mat &frame, long long timestamp) {
+        ownPyramid.reset(frame);
+        return process(ownPyramid, timestamp);
+    }
+
+    VisualOdometry::Motion VisualOdometry::process(FramePyramid &pyramid, long long timestamp) {
+        Stopwatch stopwatch;
+        int level = 0;
+        while (level + 1 < FramePyramid::MAX_LEVELS && pyramid.levelSize(level).width > settings.analysisWidth &&
+               pyramid.levelSize(level).width >= 4)
+            level++;
+        //the budget may only push the flow down to levels that are still wide enough to track on
+        maxLevelOffset = 0;
+        while (level + maxLevelOffset + 1 < FramePyramid::MAX_LEVELS &&
+               pyramid.levelSize(level + maxLevelOffset + 1).width >= MIN_ANALYSIS_WIDTH)
+            maxLevelOffset++;
+        levelOffset = min(levelOffset, maxLevelOffset);
+        level += levelOffset;
+
+        const Mat &image = pyramid.level(level);
+        double scale = (double) pyramid.levelSize(0).width / image.cols;
+        lastMotion = estimate(image, scale, timestamp, stopwatch);
+        lastMotion.processingMicros = stopwatch.elapsedMicros();
+        adaptToBudget(lastMotion.processingMicros);
+        return lastMotion;
+    }
+
+    VisualOdometry::Motion VisualOdometry::estimate(const Mat &image, double scale, long long timestamp,
+                                                    Stopwatch &stopwatch) {
+        CV_Assert(image.depth() == CV_8U && (image.channels() == 1 || image.channels() == 3));
+        if (image.channels() == 3) cvtColor(image, gray, COLOR_BGR2GRAY);
+        else image.copyTo(gray);
+
+        Motion motion;
+        motion.timestamp = timestamp;
+        motion.analysisSize = gray.size();
+        if (previousTimestamp >= 0) motion.dt = (timestamp - previousTimestamp) / 1e6;
+
+        //after a change of level the corners of the previous frame are at the wrong scale
+        if (previousGray.size() != gray.size()) previousPoints.clear();
+
+        from.clear();
+        to.clear();
+        if (!previousPoints.empty()) {
+            Size window(settings.windowSize, settings.windowSize);
+            calcOpticalFlowPyrLK(previousGray, gray, previousPoints, points, status, errors, window,
+                                 settings.flowLevels);
+            for (size_t i = 0; i < points.size(); i++) {
+                if (!status[i]) continue;
+                from.push_back(previousPoints[i]);
+                to.push_back(points[i]);
+            }
+            motion.tracked = (int) from.size();
+        }
+
+        previousPoints.clear();
+        if (motion.tracked >= 3) {
+            Mat transform = estimateAffinePartial2D(from, to, inlierMask, RANSAC, settings.ransacThreshold);
+            if (!transform.empty()) {
+                for (size_t i = 0; i < inlierMask.size(); i++) {
+                    if (inlierMask[i]) previousPoints.push_back(to[i]);
+                }
+                motion.inliers = (int) previousPoints.size();
+            }
+            if (motion.inliers >= settings.minInliers) {
+                //the fit moves the scene from the previous frame to this one; the camera moved the inverse way.
+                //Its rotation is about the image center, so the translation is where the center came from.
+                Mat inverse;
+                invertAffineTransform(transform, inverse);
+                Point2d center(gray.cols / 2.0, gray.rows / 2.0);
+                Point2d source(inverse.at<double>(0, 0) * center.x + inverse.at<double>(0, 1) * center.y +
+                               inverse.at<double>(0, 2),
+                               inverse.at<double>(1, 0) * center.x + inverse.at<double>(1, 1) * center.y +
+                               inverse.at<double>(1, 2));
+                motion.translation = (source - center) * scale;
+                motion.yaw = atan2(inverse.at<double>(1, 0), inverse.at<double>(0, 0));
+                motion.valid = true;
+                if (motion.dt > 0) {
+                    motion.velocity = motion.translation * (1 / motion.dt);
+                    motion.yawRate = motion.yaw / motion.dt;
+                }
+            }
+        }
+
+        //a new set of corners when too few survived, unless the frame has used its budget already
+        if ((int) previousPoints.size() > featureLimit) previousPoints.resize(featureLimit);
+        bool overBudget = stopwatch.elapsedMicros() > settings.budgetMillis * 1000;
+        if ((int) previousPoints.size() < settings.minFeatures && (!overBudget || previousPoints.empty())) {
+            goodFeaturesToTrack(gray, previousPoints, featureLimit, settings.featureQuality,
+                                settings.minFeatureDistance);
+        }
+
+        swap(gray, previousGray);
+        previousTimestamp = timestamp;
+        return motion;
+    }
+
+    void VisualOdometry::adaptToBudget(long long micros) {
+        double budget = settings.budgetMillis * 1000;
+        if (micros > budget) {
+            if (featureLimit > settings.minFeatures) featureLimit = max(settings.minFeatures, featureLimit * 3 / 4);
+            else if (levelOffset < maxLevelOffset) levelOffset++;
+        } else if (micros < budget / 2) {
+            //a level up costs about four times as much, so only go back when far below the budget
+            if (featureLimit >= settings.maxFeatures && levelOffset > 0 && micros < budget / 5) levelOffset--;
+            else featureLimit = min(settings.maxFeatures, featureLimit + max(1, featureLimit / 10));
+        }
+    }
+
+    void VisualOdometry::reset() {
+        previousGray.release();
+        previousPoints.clear();
+        previousTimestamp = -1;
+        lastMotion = Motion();
+    }
+
+    VisualOdometry::Motion VisualOdometry::getLastMotion() {
+        return lastMotion;
+    }
+
+    int VisualOdometry::getFeatureLimit() {
+        return featureLimit;
+    }
+
+    int VisualOdometry::getLevelOffset() {
+        return levelOffset;
+    }
+
+    VisualOdometry::Settings VisualOdometry::getSettings() {
+        return settings;
+    }
+
+    void VisualOdometry::setSettings(Settings settings) {
+        this->settings = settings;
+        featureLimit = settings.maxFeatures;
+        levelOffset = 0;
+    }
+}
@@ -1,4 +1,5 @@
 #include "robosub/image.h"
+#include <opencv2/core/hal/intrin.hpp>
 
 namespace robosub {
     void ImageTransform::resize(Mat &image, Size size) {
@@ -51,27 +52,80 @@ namespace robosub {
         return cv::getTextSize(text, FONT_HERSHEY_COMPLEX, scale, thickness, 0);
     }
 
-    void Drawing::transparentImage(Mat *src, Mat *overlay, const Point &location) {
-        for (int y = max(location.y, 0); y < src->rows; ++y) {
-            int fY = y - location.y;
+    //rounded x / 255 for x in [0, 255 * 255]
+    static inline int divide255(int x) {
+        x += 128;
+        return (x + (x >> 8)) >> 8;
+    }
+
+    //blend one row of a 4 channel overlay onto a row of dst, using the overlay's 4th channel as opacity
+    static void blendRow(uchar *dst, const uchar *overlay, int width, int channels, int overlayChannels) {
+        int x = 0;
+#if CV_SIMD128
+        if (overlayChannels == 4 && (channels == 3 || channels == 4)) {
+            const int lanes = v_uint8x16::nlanes;
+            const v_uint16x8 full = v_setall_u16(255), half = v_setall_u16(128);
+            for (; x <= width - lanes; x += lanes) {
+                v_uint8x16 o[4], d[4];
+                v_load_deinterleave(overlay + x * 4, o[0], o[1], o[2], o[3]);
+                if (channels == 3) v_load_deinterleave(dst + x * 3, d[0], d[1], d[2]);
+                else v_load_deinterleave(dst + x * 4, d[0], d[1], d[2], d[3]);
+
+                v_uint16x8 alpha0, alpha1;
+                v_expand(o[3], alpha0, alpha1);
+                v_uint16x8 inverse0 = full - alpha0, inverse1 = full - alpha1;
 
-            if (fY >= overlay->rows)
-                break;
+                for (int c = 0; c < channels; c++) {
+                    v_uint16x8 d0, d1, o0, o1;
+                    v_expand(d[c], d0, d1);
+                    v_expand(o[c], o0, o1);
+                    //at most 255 * 255 + 128, so the sums stay within 16 bits
+                    v_uint16x8 t0 = d0 * inverse0 + o0 * alpha0 + half;
+                    v_uint16x8 t1 = d1 * inverse1 + o1 * alpha1 + half;
+                    d[c] = v_pack((t0 + (t0 >> 8)) >> 8, (t1 + (t1 >> 8)) >> 8);
+                }
+
+                if (channels == 3) v_store_interleave(dst + x * 3, d[0], d[1], d[2]);
+                else v_store_interleave(dst + x * 4, d[0], d[1], d[2], d[3]);
+            }
+        }
+#endif
+        for (; x < width; x++) {
+            const uchar *o = overlay + x * overlayChannels;
+            uchar *p = dst + x * channels;
+            int alpha = o[3];
+            if (alpha == 0) continue;
+            for (int c = 0; c < channels; c++) {
+                p[c] = (uchar) divide255(p[c] * (255 - alpha) + o[c] * alpha);
+            }
+        }
+    }
 
-            for (int x = max(location.x, 0); x < src->cols; ++x) {
-                int fX = x - location.x;
+    void Drawing::transparentImage(Mat *src, Mat *overlay, const Point &location) {
+        CV_Assert(src->depth() == CV_8U && overlay->depth() == CV_8U && overlay->channels() >= 4);
 
-                if (fX >= overlay->cols)
-                    break;
+        //clip once instead of testing every pixel
+        Rect area = Rect(location, overlay->size()) & Rect(0, 0, src->cols, src->rows);
+        if (area.empty()) return;
 
-                double opacity = ((double) overlay->data[fY * overlay->step + fX * overlay->channels() + 3]) / 255;
+        const int channels = src->channels();
+        const int overlayChannels = overlay->channels();
+        const Point offset = area.tl() - location;
 
-                for (int c = 0; opacity > 0 && c < src->channels(); ++c) {
-                    unsigned char overlayPx = overlay->data[fY * overlay->step + fX * overlay->channels() + c];
-                    unsigned char srcPx = src->data[y * src->step + x * src->channels() + c];
-                    src->data[y * src->step + src->channels() * x + c] = srcPx * (1. - opacity) + overlayPx * opacity;
-                }
+        auto blendRows = [&](const Range &range) {
+            for (int y = range.start; y < range.end; y++) {
+                uchar *dst = src->ptr<uchar>(area.y + y) + area.x * channels;
+                const uchar *o = overlay->ptr<uchar>(offset.y + y) + offset.x * overlayChannels;
+                blendRow(dst, o, area.width, channels, overlayChannels);
             }
+        };
+
+        //small overlays (labels, icons) are not worth waking the thread pool
+        const int PARALLEL_MIN_PIXELS = 256 * 256;
+        if (area.area() >= PARALLEL_MIN_PIXELS) {
+            parallel_for_(Range(0, area.height), blendRows);
+        } else {
+            blendRows(Range(0, area.height));
         }
     }
 
@@ -119,12 +173,11 @@ namespace robosub {
     }
 
     void Drawing::text(Mat &img, String text, Point origin, Scalar color, Anchor anchor, double scale, int thickness) {
+        //measuring y from the bottom is the same as drawing mirrored text into a flipped image, without two flips
         if (anchor == Anchor::BOTTOM_LEFT)
-            ImageTransform::flip(img, ImageTransform::FlipAxis::HORIZONTAL);
+            origin.y = img.rows - 1 - origin.y;
         putText(img, text, origin, cv::FONT_HERSHEY_SIMPLEX, scale, color, thickness, cv::LINE_AA,
-                (anchor == Anchor::BOTTOM_LEFT || anchor == Anchor::BOTTOM_LEFT_UNFLIPPED_Y));
-        if (anchor == Anchor::BOTTOM_LEFT)
-            ImageTransform::flip(img, ImageTransform::FlipAxis::HORIZONTAL);
+                anchor == Anchor::BOTTOM_LEFT_UNFLIPPED_Y);
     }
 
     void ImageFilter::equalizeHistogram(Mat &image) {
@@ -152,4 +205,131 @@ namespace robosub {
         pyrUp(image, image,
               Size((double) image.cols * scale, (double) image.rows * scale));
     }
+
+    ColorCorrector::ColorCorrector() : ColorCorrector(Settings()) {}
+
+    ColorCorrector::ColorCorrector(Settings settings) : settings(settings) {
+        reset();
+    }
+
+    void ColorCorrector::reset() {
+        gains = Vec3d(1, 1, 1);
+        frames = 0;
+        estimated = false;
+        lut.create(1, 256, CV_8UC3);
+        for (int v = 0; v < 256; v++) lut.at<Vec3b>(v) = Vec3b((uchar) v, (uchar) v, (uchar) v);
+    }
+
+    void ColorCorrector::estimate(const Mat &frame) {
+        CV_Assert(frame.type() == CV_8UC3);
+
+        //the estimate only needs the color distribution, so a thumbnail is enough
+        int width = min(settings.analysisWidth, frame.cols);
+        int height = max(1, cvRound(frame.rows * (double) width / frame.cols));
+        cv::resize(frame, small, Size(width, height), 0, 0, INTER_AREA);
+
+        int histogram[3][256] = {{0}};
+        for (int y = 0; y < small.rows; y++) {
+            const uchar *p = small.ptr<uchar>(y);
+            for (int x = 0; x < small.cols; x++, p += 3) {
+                histogram[0][p[0]]++;
+                histogram[1][p[1]]++;
+                histogram[2][p[2]]++;
+            }
+        }
+        int total = (int) small.total();
+
+        Vec3d estimate;
+        if (settings.method == GRAY_WORLD) {
+            Vec3d means;
+            for (int c = 0; c < 3; c++) {
+                double sum = 0;
+                for (int v = 0; v < 256; v++) sum += (double) v * histogram[c][v];
+                means[c] = sum / total;
+            }
+            double gray = (means[0] + means[1] + means[2]) / 3.0;
+            for (int c = 0; c < 3; c++) estimate[c] = gray / max(means[c], 1.0);
+        } else {
+            int target = (int) std::ceil(total * settings.whitePercentile);
+            for (int c = 0; c < 3; c++) {
+                int count = 0, white = 255;
+                for (int v = 0; v < 256; v++) {
+                    count += histogram[c][v];
+                    if (count >= target) {
+                        white = v;
+                        break;
+                    }
+                }
+                estimate[c] = 255.0 / max(white, 1);
+            }
+        }
+
+        for (int c = 0; c < 3; c++) {
+            estimate[c] = min(max(estimate[c], 1.0 / settings.maxGain), settings.maxGain);
+            gains[c] = estimated ? gains[c] * (1.0 - settings.smoothing) + estimate[c] * settings.smoothing
+                                 : estimate[c];
+        }
+        estimated = true;
+
+        //luma histogram of the thumbnail as it looks after the gains
+        uchar gained[3][256];
+        for (int c = 0; c < 3; c++) {
+            for (int v = 0; v < 256; v++) gained[c][v] = saturate_cast<uchar>(v * gains[c]);
+        }
+        int lumaHistogram[256] = {0};
+        for (int y = 0; y < small.rows; y++) {
+            const uchar *p = small.ptr<uchar>(y);
+            for (int x = 0; x < small.cols; x++, p += 3) {
+                lumaHistogram[(29 * gained[0][p[0]] + 150 * gained[1][p[1]] + 77 * gained[2][p[2]] + 128) >> 8]++;
+            }
+        }
+
+        buildTable(lumaHistogram, total);
+    }
+
+    void ColorCorrector::buildTable(const int *lumaHistogram, int total) {
+        //contrast-limited equalization, as CLAHE does per tile, computed once for the whole frame
+        double limit = settings.clipLimit * total / 256.0;
+        double clipped[256], excess = 0;
+        for (int v = 0; v < 256; v++) {
+            clipped[v] = min((double) lumaHistogram[v], limit);
+            excess += lumaHistogram[v] - clipped[v];
+        }
+        double spread = excess / 256.0, cumulative = 0;
+        uchar tone[256];
+        for (int v = 0; v < 256; v++) {
+            cumulative += clipped[v] + spread;
+            double equalized = 255.0 * cumulative / max(total, 1);
+            tone[v] = saturate_cast<uchar>(v * (1.0 - settings.contrast) + equalized * settings.contrast);
+        }
+
+        lut.create(1, 256, CV_8UC3);
+        for (int v = 0; v < 256; v++) {
+            Vec3b &entry = lut.at<Vec3b>(v);
+            for (int c = 0; c < 3; c++) entry[c] = tone[saturate_cast<uchar>(v * gains[c])];
+        }
+    }
+
+    void ColorCorrector::apply(const Mat &src, Mat &dst) {
+        CV_Assert(src.type() == CV_8UC3);
+        if (!estimated || frames % max(settings.updateInterval, 1) == 0) estimate(src);
+        frames++;
+        cv::LUT(src, lut, dst);
+    }
+
+    Vec3d ColorCorrector::getGains() {
+        return gains;
+    }
+
+    Mat ColorCorrector::getLookupTable() {
+        return lut;
+    }
+
+    ColorCorrector::Settings ColorCorrector::getSettings() {
+        return settings;
+    }
+
+    void ColorCorrector::setSettings(Settings settings) {
+        this->settings = settings;
+    }
 }
@@ -0,0 +1,189 @@
+#include "robosub/matpool.h"
+
+#include <cstdlib>
+#include <new>
+
+#ifdef __linux__
+#include <sys/mman.h>
+#endif
+
+namespace robosub {
+    MatPool::MatPool() : MatPool(Settings()) {}
+
+    MatPool::MatPool(Settings settings) : settings(settings) {}
+
+    MatPool::~MatPool() {
+        if (installed && Mat::getDefaultAllocator() == this) uninstall();
+        trim();
+        for (void *header : freeHeaders) ::operator delete(header);
+        freeHeaders.clear();
+    }
+
+    MatPool &MatPool::shared() {
+        static MatPool *pool = new MatPool();
+        return *pool;
+    }
+
+    void MatPool::install() {
+        if (installed) return;
+        previous = Mat::getDefaultAllocator();
+        Mat::setDefaultAllocator(this);
+        installed = true;
+    }
+
+    void MatPool::uninstall() {
+        if (!installed) return;
+        Mat::setDefaultAllocator(previous);
+        installed = false;
+    }
+
+    size_t MatPool::bucketSize(size_t bytes) const {
+        size_t granule = bytes >= 4096 ? 4096 : 64;
+        return (bytes + granule - 1) / granule * granule;
+    }
+
+    void *MatPool::systemAllocate(size_t bucket) const {
+        size_t alignment = bucket >= settings.hugePageSize ? settings.hugePageSize : 64;
+        void *buffer = nullptr;
+#ifdef _WIN32
+        buffer = _aligned_malloc(bucket, alignment);
+#else
+        if (posix_memalign(&buffer, alignment, bucket) != 0) buffer = nullptr;
+#endif
+        if (!buffer) throw std::bad_alloc();
+#ifdef MADV_HUGEPAGE
+        //only a hint; without transparent huge pages the buffer simply uses normal pages
+        if (bucket >= settings.hugePageSize) madvise(buffer, bucket, MADV_HUGEPAGE);
+#endif
+        stats.systemAllocations++;
+        return buffer;
+    }
+
+    void MatPool::systemFree(void *buffer) const {
+#ifdef _WIN32
+        _aligned_free(buffer);
+#else
+        free(buffer);
+#endif
+        stats.systemFrees++;
+    }
+
+    void *MatPool::takeBuffer(size_t bucket) const {
+        stats.allocations++;
+        std::map<size_t, vector<void *>>::iterator it = freeBuffers.find(bucket);
+        void *buffer;
+        if (it != freeBuffers.end() && !it->second.empty()) {
+            buffer = it->second.back();
+            it->second.pop_back();
+            stats.hits++;
+            stats.bytesCached -= bucket;
+        } else {
+            buffer = systemAllocate(bucket);
+        }
+        stats.bytesInUse += bucket;
+        stats.peakBytesInUse = max(stats.peakBytesInUse, stats.bytesInUse);
+        stats.peakBytes = max(stats.peakBytes, stats.bytesInUse + stats.bytesCached);
+        return buffer;
+    }
+
+    void MatPool::returnBuffer(void *buffer, size_t bucket) const {
+        stats.bytesInUse -= bucket;
+        if (stats.bytesCached + bucket > settings.maxCachedBytes) {
+            systemFree(buffer);
+            return;
+        }
+        freeBuffers[bucket].push_back(buffer);
+        stats.bytesCached += bucket;
+    }
+
+    UMatData *MatPool::newHeader() const {
+        void *storage;
+        if (!freeHeaders.empty()) {
+            storage = freeHeaders.back();
+            freeHeaders.pop_back();
+        } else {
+            storage = ::operator new(sizeof(UMatData));
+        }
+        return new(storage) UMatData(this);
+    }
+
+    void MatPool::deleteHeader(UMatData *u) const {
+        u->~UMatData();
+        freeHeaders.push_back(u);
+    }
+
+    UMatData *MatPool::allocate(int dims, const int *sizes, int type, void *data0, size_t *step, int flags,
+                                UMatUsageFlags usageFlags) const {
+        //same layout rules as OpenCV's default allocator
+        size_t total = CV_ELEM_SIZE(type);
+        for (int i = dims - 1; i >= 0; i--) {
+            if (step) {
+                if (data0 && step[i] != CV_AUTOSTEP) {
+                    CV_Assert(total <= step[i]);
+                    total = step[i];
+                } else {
+                    step[i] = total;
+                }
+            }
+            total *= sizes[i];
+        }
+
+        std::lock_guard<std::mutex> guard(lock);
+        uchar *data = data0 ? (uchar *) data0 : (uchar *) takeBuffer(bucketSize(total));
+        UMatData *u = newHeader();
+        u->data = u->origdata = data;
+        u->size = total;
+        if (data0) u->flags |= UMatData::USER_ALLOCATED;
+        return u;
+    }
+
+    bool MatPool::allocate(UMatData *u, int accessFlags, UMatUsageFlags usageFlags) const {
+        return u != nullptr;
+    }
+
+    void MatPool::deallocate(UMatData *u) const {
+        if (!u) return;
+        CV_Assert(u->urefcount == 0);
+        CV_Assert(u->refcount == 0);
+
+        std::lock_guard<std::mutex> guard(lock);
+        if (!(u->flags & UMatData::USER_ALLOCATED)) {
+            returnBuffer(u->origdata, bucketSize(u->size));
+            u->origdata = 0;
+        }
+        deleteHeader(u);
+    }
+
+    void MatPool::trim() {
+        std::lock_guard<std::mutex> guard(lock);
+        for (std::pair<const size_t, vector<void *>> &bucket : freeBuffers) {
+            for (void *buffer : bucket.second) systemFree(buffer);
+            stats.bytesCached -= bucket.first * bucket.second.size();
+            bucket.second.clear();
+        }
+    }
+
+    MatPool::Stats MatPool::getStats() {
+        std::lock_guard<std::mutex> guard(lock);
+        return stats;
+    }
+
+    void MatPool::resetStats() {
+        std::lock_guard<std::mutex> guard(lock);
+        Stats fresh;
+        fresh.bytesInUse = fresh.peakBytesInUse = stats.bytesInUse;
+        fresh.bytesCached = stats.bytesCached;
+        fresh.peakBytes = stats.bytesInUse + stats.bytesCached;
+        stats = fresh;
+    }
+
+    MatPool::Settings MatPool::getSettings() {
+        std::lock_guard<std::mutex> guard(lock);
+        return settings;
+    }
+
+    void MatPool::setSettings(Settings settings) {
+        std::lock_guard<std::mutex> guard(lock);
+        this->settings = settings;
+    }
+}
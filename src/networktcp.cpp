@@ -74,6 +74,34 @@ namespace robosub {
         return read(client, data, maxlen);
     }
 
+    int NetworkTcpServer::pollBuffer(char *data, int maxlen) {
+        if (!connected) { return -1; }
+#ifdef NETWORKTCP_WINSOCK
+        u_long available = 0;
+        if (ioctlsocket(client, FIONREAD, &available) != 0) { return -1; }
+        if (available == 0) { return 0; }
+        return recv(client, data, maxlen, 0);
+#else
+        int numread = recv(client, data, maxlen, MSG_DONTWAIT);
+        if (numread == -1) {
+            int ecode = NETWORKTCP_GETERROR;
+            return (ecode == EAGAIN || ecode == EWOULDBLOCK) ? 0 : -1;
+        }
+        return numread;
+#endif
+    }
+
+    int NetworkTcpServer::getSendQueueBytes() {
+        if (!connected) { return -1; }
+#ifdef __linux__
+        int queued = 0;
+        if (ioctl(client, SIOCOUTQ, &queued) != 0) { return -1; }
+        return queued;
+#else
+        return -1;
+#endif
+    }
+
     int NetworkTcpServer::sendBuffer(char *data, int datalen) {
         if (!connected) { return -1; }
         int numsent = send(client, data, datalen, 0);
@@ -189,14 +189,13 @@ namespace robosub {
             }
 
             if (!initialized) {
+                //the Mats own their pixels, so a size change frees them (and a MatPool can reuse them)
                 for (int i = 0; i < NetworkVideo_MostRecentFrameCount; i++) {
-                    char *newframedata = (char *) malloc(rrows * rcols * 3);
-                    bufferFrames[i] = new Mat(rrows, rcols, CV_8UC3, newframedata);
+                    bufferFrames[i] = new Mat(rrows, rcols, CV_8UC3);
                     bufferFramesReceivedPacket[i] = new bool[packetsPerFrame];
                     bufferFramesMostRecentFrameId[i] = new int[packetsPerFrame];
                 }
-                char *newframedata = (char *) malloc(rrows * rcols * 3);
-                bufferFrameLatest = new Mat(rrows, rcols, CV_8UC3, newframedata);
+                bufferFrameLatest = new Mat(rrows, rcols, CV_8UC3);
                 rows = rrows;
                 cols = rcols;
                 initialized = true;
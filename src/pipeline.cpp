@@ -0,0 +1,284 @@
+#include "robosub/pipeline.h"
+
+#include <chrono>
+#include <stdexcept>
+
+namespace robosub {
+    void Pipeline::Signal::notify() {
+        if (waiters.load() == 0) return;
+        std::lock_guard<std::mutex> guard(lock);
+        condition.notify_all();
+    }
+
+    void Pipeline::Signal::wait(const std::function<bool()> &ready) {
+        std::unique_lock<std::mutex> guard(lock);
+        waiters++;
+        //the timeout covers a notify() that raced with the check above it
+        if (!ready()) condition.wait_for(guard, std::chrono::milliseconds(2));
+        waiters--;
+    }
+
+    Pipeline::Pipeline() : stopping(false) {}
+
+    Pipeline::~Pipeline() {
+        stop();
+        wait();
+    }
+
+    int Pipeline::addStage(const String &name, StageFunction function, int workers, bool source) {
+        if (started) throw std::logic_error("Stages cannot be added to a running pipeline");
+        if (workers < 1) throw std::invalid_argument("A stage needs at least one worker");
+
+        std::unique_ptr<Stage> stage(new Stage());
+        stage->name = name;
+        stage->function = function;
+        stage->workerCount = workers;
+        stage->source = source;
+        stages.push_back(std::move(stage));
+        return (int) stages.size() - 1;
+    }
+
+    int Pipeline::addSource(const String &name, StageFunction produce, int workers) {
+        return addStage(name, produce, workers, true);
+    }
+
+    int Pipeline::addStage(const String &name, StageFunction process, int workers) {
+        return addStage(name, process, workers, false);
+    }
+
+    void Pipeline::connect(int from, int to, EdgePolicy policy, int capacity) {
+        if (started) throw std::logic_error("Stages cannot be connected in a running pipeline");
+        if (from < 0 || from >= (int) stages.size() || to < 0 || to >= (int) stages.size())
+            throw std::invalid_argument("No such stage");
+        if (from == to) throw std::invalid_argument("A stage cannot feed itself");
+        if (stages[to]->source) throw std::invalid_argument("Sources cannot have inputs");
+        if (capacity < 1) throw std::invalid_argument("Queue capacity must be at least 1");
+
+        std::unique_ptr<Edge> edge(new Edge());
+        edge->from = from;
+        edge->to = to;
+        edge->policy = policy;
+        edge->queue.reset(new BoundedQueue<PipelineItem>((size_t) capacity));
+        edges.push_back(std::move(edge));
+        stages[from]->outputs.push_back((int) edges.size() - 1);
+        stages[to]->inputs.push_back((int) edges.size() - 1);
+    }
+
+    void Pipeline::setAllocator(MatAllocator *allocator) {
+        if (started) throw std::logic_error("The allocator cannot change while the pipeline runs");
+        this->allocator = allocator;
+    }
+
+    void Pipeline::start() {
+        if (started) throw std::logic_error("Pipeline is already running");
+
+        //Kahn's algorithm: every stage must be reachable without going around a cycle
+        vector<int> pending(stages.size(), 0);
+        vector<int> ready;
+        for (size_t s = 0; s < stages.size(); s++) {
+            pending[s] = (int) stages[s]->inputs.size();
+            if (!stages[s]->source && pending[s] == 0)
+                throw std::logic_error("Stage " + stages[s]->name + " has no input");
+            if (pending[s] == 0) ready.push_back((int) s);
+        }
+        size_t ordered = 0;
+        while (!ready.empty()) {
+            int s = ready.back();
+            ready.pop_back();
+            ordered++;
+            for (int e : stages[s]->outputs) {
+                if (--pending[edges[e]->to] == 0) ready.push_back(edges[e]->to);
+            }
+        }
+        if (ordered != stages.size()) throw std::logic_error("Pipeline stages form a cycle");
+
+        stopping = false;
+        started = true;
+        startTime = Time::micros();
+        //every stage counts as running before any thread starts, so no consumer sees its input finished early
+        for (std::unique_ptr<Stage> &stage : stages) stage->activeWorkers = stage->workerCount;
+        for (size_t s = 0; s < stages.size(); s++) {
+            for (int w = 0; w < stages[s]->workerCount; w++) {
+                stages[s]->threads.push_back(std::thread(&Pipeline::runWorker, this, (int) s, w));
+            }
+        }
+    }
+
+    void Pipeline::stop() {
+        stopping = true;
+    }
+
+    void Pipeline::wait() {
+        for (std::unique_ptr<Stage> &stage : stages) {
+            for (std::thread &thread : stage->threads) {
+                if (thread.joinable()) thread.join();
+            }
+            stage->threads.clear();
+        }
+        if (started) finishTime = Time::micros();
+        started = false;
+    }
+
+    bool Pipeline::isRunning() {
+        if (!started) return false;
+        for (std::unique_ptr<Stage> &stage : stages) {
+            if (stage->activeWorkers > 0) return true;
+        }
+        return false;
+    }
+
+    bool Pipeline::takeInput(Stage &stage, size_t &nextInput, PipelineItem &item) {
+        //round robin, so a busy input cannot starve the others
+        for (size_t i = 0; i < stage.inputs.size(); i++) {
+            Edge &edge = *edges[stage.inputs[(nextInput + i) % stage.inputs.size()]];
+            if (edge.queue->tryPop(item)) {
+                nextInput = (nextInput + i + 1) % stage.inputs.size();
+                stage.spaceFreed.notify();
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool Pipeline::inputsFinished(Stage &stage) {
+        for (int e : stage.inputs) {
+            if (stages[edges[e]->from]->activeWorkers > 0) return false;
+        }
+        return true;
+    }
+
+    void Pipeline::push(Edge &edge, PipelineItem &item) {
+        PipelineItem discarded;
+        switch (edge.policy) {
+            case BLOCK:
+                while (!edge.queue->tryPush(item)) {
+                    stages[edge.to]->spaceFreed.wait([&edge]() {
+                        return edge.queue->size() < edge.queue->capacity();
+                    });
+                }
+                break;
+            case LATEST_ONLY:
+                while (edge.queue->tryPop(discarded)) edge.dropped++;
+                //fall through: another producer may have filled the queue again
+            case DROP_OLDEST:
+                while (!edge.queue->tryPush(item)) {
+                    if (edge.queue->tryPop(discarded)) edge.dropped++;
+                }
+                break;
+        }
+        stages[edge.to]->itemReady.notify();
+    }
+
+    void Pipeline::emit(Stage &stage, PipelineItem &item) {
+        //the last output gets the item itself, the others copies with shared pixel data
+        for (size_t i = 0; i < stage.outputs.size(); i++) {
+            Edge &edge = *edges[stage.outputs[i]];
+            if (i + 1 < stage.outputs.size()) {
+                PipelineItem copy = item;
+                push(edge, copy);
+            } else {
+                push(edge, item);
+            }
+        }
+    }
+
+    void Pipeline::record(Stage &stage, long long micros, const PipelineItem &item) {
+        stage.processed++;
+        stage.totalMicros += micros;
+        stage.totalLatencyMicros += Time::micros() - item.timestamp;
+        long long max = stage.maxMicros.load();
+        while (micros > max && !stage.maxMicros.compare_exchange_weak(max, micros)) {}
+    }
+
+    void Pipeline::runWorker(int index, int worker) {
+        Stage &stage = *stages[index];
+        size_t nextInput = (size_t) worker;
+
+        while (true) {
+            PipelineItem item;
+            if (stage.source) {
+                if (stopping) break;
+                item.sequence = stage.nextSequence++;
+                item.timestamp = Time::micros();
+                item.source = index;
+                item.image.allocator = allocator;
+            } else if (!takeInput(stage, nextInput, item)) {
+                //a finished input pushed its last item before finishing, so look once more before leaving
+                if (inputsFinished(stage)) {
+                    if (!takeInput(stage, nextInput, item)) break;
+                } else {
+                    stage.itemReady.wait([this, &stage]() -> bool {
+                        for (int e : stage.inputs) {
+                            if (edges[e]->queue->size() > 0) return true;
+                        }
+                        return inputsFinished(stage);
+                    });
+                    continue;
+                }
+            }
+
+            long long start = Time::micros();
+            bool keep;
+            try {
+                keep = stage.function(item);
+            } catch (std::exception &e) {
+                stage.errors++;
+                continue;
+            }
+            if (!keep) {
+                if (stage.source) break;
+                stage.rejected++;
+                continue;
+            }
+            record(stage, Time::micros() - start, item);
+            emit(stage, item);
+        }
+
+        stage.activeWorkers--;
+        //successors waiting for items have to notice that this input is done
+        for (int e : stage.outputs) stages[edges[e]->to]->itemReady.notify();
+    }
+
+    vector<Pipeline::StageStats> Pipeline::getStats() {
+        vector<StageStats> all;
+        double seconds = ((started ? Time::micros() : finishTime) - startTime) / 1e6;
+        for (std::unique_ptr<Stage> &stage : stages) {
+            StageStats stats;
+            stats.name = stage->name;
+            stats.workers = stage->workerCount;
+            stats.processed = stage->processed;
+            stats.rejected = stage->rejected;
+            stats.errors = stage->errors;
+            for (int e : stage->inputs) {
+                stats.dropped += edges[e]->dropped;
+                stats.queueDepth += edges[e]->queue->size();
+            }
+            if (stats.processed > 0) {
+                stats.meanMicros = (double) stage->totalMicros / stats.processed;
+                stats.meanLatencyMicros = (double) stage->totalLatencyMicros / stats.processed;
+            }
+            stats.maxMicros = stage->maxMicros;
+            if (seconds > 0) stats.throughput = stats.processed / seconds;
+            all.push_back(stats);
+        }
+        return all;
+    }
+
+    json Pipeline::getStatsJson() {
+        json all = json::object();
+        for (const StageStats &stats : getStats()) {
+            json &stage = all[stats.name];
+            stage["workers"] = stats.workers;
+            stage["processed"] = stats.processed;
+            stage["rejected"] = stats.rejected;
+            stage["errors"] = stats.errors;
+            stage["dropped"] = stats.dropped;
+            stage["queue"] = stats.queueDepth;
+            stage["meanMicros"] = stats.meanMicros;
+            stage["maxMicros"] = stats.maxMicros;
+            stage["latencyMicros"] = stats.meanLatencyMicros;
+            stage["fps"] = stats.throughput;
+        }
+        return all;
+    }
+}
@@ -17,5 +17,70 @@ namespace robosub {
         return CV_64FC1;
     }
 
+    //running sums for one contour, relative to the contour's bounds
+    struct ContourSums {
+        double n = 0, x = 0, y = 0;
+        double xx = 0, xy = 0, yy = 0;
+        double xxx = 0, xxy = 0, xyy = 0, yyy = 0;
+        double color[4] = {0, 0, 0, 0};
+    };
 
+    void ContourStats::compute(const Mat &img, const vector<vector<Point>> &contours,
+                               vector<ContourStats> &stats, Mat &labels) {
+        CV_Assert(img.depth() == CV_8U && img.channels() <= 4);
+
+        stats.assign(contours.size(), ContourStats());
+        if (contours.empty()) return;
+
+        labels.create(img.size(), CV_32S);
+        labels.setTo(0);
+
+        //label every contour; only the union of their bounds needs to be scanned afterwards
+        Rect frame(Point(0, 0), img.size());
+        Rect region;
+        for (size_t i = 0; i < contours.size(); i++) {
+            stats[i].bounds = boundingRect(contours[i]) & frame;
+            if (stats[i].bounds.empty()) continue;
+            drawContours(labels, contours, (int) i, Scalar((double) (i + 1)), cv::FILLED);
+            region = region.empty() ? stats[i].bounds : (region | stats[i].bounds);
+        }
+
+        vector<ContourSums> sums(contours.size());
+        int channels = img.channels();
+        for (int y = region.y; y < region.y + region.height; y++) {
+            const int *label = labels.ptr<int>(y);
+            const uchar *pixel = img.ptr<uchar>(y);
+            for (int x = region.x; x < region.x + region.width; x++) {
+                int id = label[x];
+                if (id == 0) continue;
+
+                ContourSums &s = sums[id - 1];
+                double dx = x - stats[id - 1].bounds.x;
+                double dy = y - stats[id - 1].bounds.y;
+                s.n++;
+                s.x += dx;
+                s.y += dy;
+                s.xx += dx * dx;
+                s.xy += dx * dy;
+                s.yy += dy * dy;
+                s.xxx += dx * dx * dx;
+                s.xxy += dx * dx * dy;
+                s.xyy += dx * dy * dy;
+                s.yyy += dy * dy * dy;
+                const uchar *p = pixel + x * channels;
+                for (int c = 0; c < channels; c++) s.color[c] += p[c];
+            }
+        }
+
+        for (size_t i = 0; i < contours.size(); i++) {
+            ContourSums &s = sums[i];
+            ContourStats &result = stats[i];
+            result.pixels = s.n;
+            if (s.n == 0) continue;
+
+            result.moments = Moments(s.n, s.x, s.y, s.xx, s.xy, s.yy, s.xxx, s.xxy, s.xyy, s.yyy);
+            result.centroid = Point2d(result.bounds.x + s.x / s.n, result.bounds.y + s.y / s.n);
+            for (int c = 0; c < channels; c++) result.meanColor[c] = s.color[c] / s.n;
+        }
+    }
 }
@@ -0,0 +1,183 @@
+#include "robosub/recorder.h"
+
+namespace robosub {
+    Recorder::Recorder() {
+    }
+
+    Recorder::~Recorder() {
+        stop();
+    }
+
+    int Recorder::addStream(const StreamConfig &config) {
+        if (config.queueLength < 1) throw std::invalid_argument("Queue length must be at least 1");
+
+        std::shared_ptr<Stream> stream = std::make_shared<Stream>();
+        stream->config = config;
+
+        if (config.format != MJPEG_AVI && !stream->log.open(config.path, config.preallocateBytes))
+            throw std::runtime_error("Could not open recording file " + config.path);
+
+        stream->thread = std::thread(writerLoop, stream.get());
+
+        std::lock_guard<std::mutex> guard(streamsLock);
+        streams.push_back(stream);
+        return (int) streams.size() - 1;
+    }
+
+    std::shared_ptr<Recorder::Stream> Recorder::getStream(int stream) {
+        std::lock_guard<std::mutex> guard(streamsLock);
+        if (stream < 0 || stream >= (int) streams.size()) return std::shared_ptr<Stream>();
+        return streams[stream];
+    }
+
+    bool Recorder::record(int streamId, const Mat &frame, long long timestamp) {
+        std::shared_ptr<Stream> stream = getStream(streamId);
+        if (!stream || frame.empty()) return false;
+        if (timestamp < 0) timestamp = Time::micros();
+
+        stream->received++;
+        Mat buffer;
+        {
+            std::unique_lock<std::mutex> lock(stream->lock);
+            if (stream->stopping) return false;
+
+            size_t capacity = (size_t) stream->config.queueLength;
+            if (stream->queue.size() + stream->reserved >= capacity) {
+                switch (stream->config.dropPolicy) {
+                    case DROP_NEWEST:
+                        stream->dropped++;
+                        return false;
+                    case DROP_OLDEST:
+                        if (!stream->queue.empty()) {
+                            //reuse the dropped frame's buffer
+                            buffer = stream->queue.front().frame;
+                            stream->queue.pop_front();
+                            stream->dropped++;
+                            break;
+                        }
+                        //every slot is reserved by other producers; wait like BLOCK
+                    case BLOCK:
+                        stream->notFull.wait(lock, [&stream, capacity]() {
+                            return stream->stopping || stream->queue.size() + stream->reserved < capacity;
+                        });
+                        if (stream->stopping) return false;
+                        break;
+                }
+            }
+
+            if (buffer.empty() && !stream->spare.empty()) {
+                buffer = stream->spare.back();
+                stream->spare.pop_back();
+            }
+            stream->reserved++;
+        }
+
+        //copy outside of the lock so the writer is never blocked by a producer
+        frame.copyTo(buffer);
+
+        {
+            std::lock_guard<std::mutex> guard(stream->lock);
+            stream->reserved--;
+            Entry entry;
+            entry.frame = buffer;
+            entry.timestamp = timestamp;
+            stream->queue.push_back(entry);
+            if (stream->queue.size() > stream->maxQueueDepth) stream->maxQueueDepth = stream->queue.size();
+        }
+        stream->notEmpty.notify_one();
+        return true;
+    }
+
+    void Recorder::writerLoop(Stream *stream) {
+        while (true) {
+            Entry entry;
+            {
+                std::unique_lock<std::mutex> lock(stream->lock);
+                stream->notEmpty.wait(lock, [stream]() {
+                    return stream->stopping || !stream->queue.empty();
+                });
+                if (stream->queue.empty()) break; //stopping and fully flushed
+                entry = stream->queue.front();
+                stream->queue.pop_front();
+            }
+            stream->notFull.notify_one();
+
+            if (writeFrame(stream, entry)) stream->written++;
+            else stream->writeErrors++;
+
+            std::lock_guard<std::mutex> guard(stream->lock);
+            stream->spare.push_back(entry.frame);
+        }
+
+        finishStream(stream);
+    }
+
+    bool Recorder::writeFrame(Stream *stream, Entry &entry) {
+        Mat &frame = entry.frame;
+
+        if (stream->config.format == MJPEG_AVI) {
+            if (!stream->writer.isOpened()) {
+                //size the container from the first frame instead of assuming a resolution
+                stream->writer.open(stream->config.path, cv::VideoWriter::fourcc('M', 'J', 'P', 'G'),
+                                    stream->config.frameRate, frame.size(), frame.channels() > 1);
+                if (!stream->writer.isOpened()) return false;
+            }
+            stream->writer.write(frame);
+            return true;
+        }
+
+        return stream->log.write((uint32_t) stream->config.logStreamId, frame, entry.timestamp,
+                                 stream->config.format == JPEG ? framelog::JPEG : framelog::RAW,
+                                 stream->config.jpegQuality);
+    }
+
+    void Recorder::finishStream(Stream *stream) {
+        if (stream->writer.isOpened()) stream->writer.release();
+        if (stream->log.isOpen()) stream->log.close();
+    }
+
+    void Recorder::closeStream(int streamId) {
+        std::shared_ptr<Stream> stream = getStream(streamId);
+        if (!stream) return;
+
+        {
+            std::lock_guard<std::mutex> guard(stream->lock);
+            stream->stopping = true;
+        }
+        stream->notEmpty.notify_all();
+        stream->notFull.notify_all();
+        if (stream->thread.joinable()) stream->thread.join();
+    }
+
+    void Recorder::stop() {
+        int count;
+        {
+            std::lock_guard<std::mutex> guard(streamsLock);
+            count = (int) streams.size();
+        }
+        for (int i = 0; i < count; i++) closeStream(i);
+    }
+
+    bool Recorder::isOpen(int streamId) {
+        std::shared_ptr<Stream> stream = getStream(streamId);
+        if (!stream) return false;
+        std::lock_guard<std::mutex> guard(stream->lock);
+        return !stream->stopping;
+    }
+
+    Recorder::Stats Recorder::getStats(int streamId) {
+        Stats stats;
+        std::shared_ptr<Stream> stream = getStream(streamId);
+        if (!stream) return stats;
+
+        stats.received = stream->received;
+        stats.written = stream->written;
+        stats.dropped = stream->dropped;
+        stats.writeErrors = stream->writeErrors;
+
+        std::lock_guard<std::mutex> guard(stream->lock);
+        stats.queueDepth = stream->queue.size();
+        stats.maxQueueDepth = stream->maxQueueDepth;
+        return stats;
+    }
+}
@@ -0,0 +1,122 @@
+#include "robosub/streamadapter.h"
+
+#include <stdexcept>
+
+namespace robosub {
+    //weight of a new observation in the moving averages
+    static const double SMOOTHING = 0.2;
+
+    StreamAdapter::StreamAdapter(const Settings &settings) {
+        if (settings.presets.empty()) throw std::invalid_argument("StreamAdapter needs at least one preset");
+        this->settings = settings;
+    }
+
+    StreamAdapter::Settings StreamAdapter::defaultSettings() {
+        Settings settings;
+        settings.presets = {
+                {Size(1280, 720), 30},
+                {Size(960, 540), 30},
+                {Size(640, 360), 30},
+                {Size(640, 360), 15},
+                {Size(320, 180), 15},
+                {Size(320, 180), 5}
+        };
+        return settings;
+    }
+
+    void StreamAdapter::reset() {
+        congestedSince = -1;
+        clearSince = -1;
+        //observations made at the old preset say little about the new one
+        queuedFrames = 0;
+        sendFraction = 0;
+        lastFeedback = -1;
+        receivedFrameRate = -1;
+    }
+
+    void StreamAdapter::reportSend(long long queuedBytes, long long frameBytes, long long sendMicros) {
+        long long now = Time::micros();
+
+        double queued = frameBytes > 0 && queuedBytes > 0 ? (double) queuedBytes / (double) frameBytes : 0;
+        double interval = 1e6 / getPreset().frameRate;
+        queuedFrames += SMOOTHING * (queued - queuedFrames);
+        sendFraction += SMOOTHING * ((double) sendMicros / interval - sendFraction);
+
+        if (lastSend >= 0 && now > lastSend) {
+            double rate = 1e6 / (double) (now - lastSend);
+            sentFrameRate = sentFrameRate <= 0 ? rate : sentFrameRate + SMOOTHING * (rate - sentFrameRate);
+        }
+        lastSend = now;
+    }
+
+    void StreamAdapter::reportFeedback(double receivedFrameRate) {
+        this->receivedFrameRate = receivedFrameRate;
+        lastFeedback = Time::micros();
+    }
+
+    bool StreamAdapter::update() {
+        long long now = Time::micros();
+
+        bool feedback = lastFeedback >= 0 && now - lastFeedback < (long long) (settings.feedbackTimeout * 1e6);
+        double delivery = feedback && sentFrameRate > 0 ? receivedFrameRate / sentFrameRate : 1.0;
+
+        bool congested = queuedFrames > settings.maxQueuedFrames
+                         || sendFraction > settings.maxSendFraction
+                         || delivery < settings.minDeliveryRatio;
+        //only count the link as clear with a wide margin below every threshold
+        bool clear = queuedFrames < settings.maxQueuedFrames / 4
+                     && sendFraction < settings.maxSendFraction / 2
+                     && delivery >= (1.0 + settings.minDeliveryRatio) / 2;
+
+        if (!congested) congestedSince = -1;
+        else if (congestedSince < 0) congestedSince = now;
+        if (!clear) clearSince = -1;
+        else if (clearSince < 0) clearSince = now;
+
+        int count = getPresetCount();
+        if (congestedSince >= 0 && now - congestedSince >= (long long) (settings.downgradeDelay * 1e6)
+            && preset < count - 1) {
+            preset++;
+            reset();
+            return true;
+        }
+        if (clearSince >= 0 && now - clearSince >= (long long) (settings.upgradeDelay * 1e6) && preset > 0) {
+            preset--;
+            reset();
+            return true;
+        }
+        return false;
+    }
+
+    int StreamAdapter::getPresetIndex() {
+        return preset;
+    }
+
+    int StreamAdapter::getPresetCount() {
+        return (int) settings.presets.size();
+    }
+
+    StreamAdapter::Preset StreamAdapter::getPreset() {
+        return settings.presets[preset];
+    }
+
+    void StreamAdapter::setPresetIndex(int index) {
+        if (index < 0 || index >= getPresetCount()) throw std::out_of_range("Preset index out of range");
+        preset = index;
+        reset();
+    }
+
+    double StreamAdapter::getQueuedFrames() {
+        return queuedFrames;
+    }
+
+    double StreamAdapter::getSentFrameRate() {
+        return sentFrameRate;
+    }
+
+    double StreamAdapter::getReceivedFrameRate() {
+        long long now = Time::micros();
+        if (lastFeedback < 0 || now - lastFeedback >= (long long) (settings.feedbackTimeout * 1e6)) return -1;
+        return receivedFrameRate;
+    }
+}
@@ -0,0 +1,81 @@
+#include "robosub/threadpool.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace robosub {
+    //pool the calling thread works for, and its index there; a thread belongs to at most one pool
+    static thread_local const ThreadPool *workerPool = nullptr;
+    static thread_local int workerIndex = -1;
+
+    ThreadPool::ThreadPool(int threads) {
+        if (threads <= 0) threads = (int) std::thread::hardware_concurrency();
+        if (threads <= 0) threads = 1;
+
+        for (int i = 0; i < threads; i++) {
+            workers.push_back(std::thread(&ThreadPool::workerLoop, this, i));
+        }
+    }
+
+    ThreadPool::~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            stopping = true;
+        }
+        available.notify_all();
+        for (std::thread &worker : workers) {
+            if (worker.joinable()) worker.join();
+        }
+    }
+
+    void ThreadPool::workerLoop(int index) {
+        workerPool = this;
+        workerIndex = index;
+        while (true) {
+            std::function<void()> task;
+            {
+                std::unique_lock<std::mutex> guard(lock);
+                available.wait(guard, [this]() { return stopping || !tasks.empty(); });
+                if (tasks.empty()) return; //stopping and drained
+                task = std::move(tasks.front());
+                tasks.pop_front();
+            }
+            task();
+        }
+    }
+
+    int ThreadPool::getThreadCount() {
+        return (int) workers.size();
+    }
+
+    int ThreadPool::currentWorker() const {
+        return workerPool == this ? workerIndex : -1;
+    }
+
+    void ThreadPool::enqueue(std::function<void()> task) {
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            if (stopping) throw std::runtime_error("ThreadPool is stopping");
+            tasks.push_back(std::move(task));
+        }
+        available.notify_one();
+    }
+
+    void ThreadPool::parallelFor(int begin, int end, const std::function<void(int)> &body) {
+        if (currentWorker() >= 0) {
+            //waiting on the pool from inside one of its own workers could block every thread
+            //(workers of other pools just wait; this pool's threads are not theirs)
+            for (int i = begin; i < end; i++) body(i);
+            return;
+        }
+
+        vector<std::future<void>> pending;
+        pending.reserve((size_t) max(end - begin, 0));
+        for (int i = begin; i < end; i++) {
+            pending.push_back(submit([&body, i]() { body(i); }));
+        }
+        //let every task finish before rethrowing, since they all reference body
+        for (std::future<void> &f : pending) f.wait();
+        for (std::future<void> &f : pending) f.get();
+    }
+}
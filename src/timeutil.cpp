@@ -1,5 +1,12 @@
 #include "robosub/timeutil.h"
 
+#include <chrono>
+#include <cmath>
+#include <cerrno>
+#include <ctime>
+#include <algorithm>
+#include <stdexcept>
+
 namespace robosub {
 
 #include <sys/timeb.h>
@@ -33,12 +40,27 @@ namespace robosub {
     }
 
     long long Time::millis() {
-        return std::chrono::system_clock::now().time_since_epoch() /
+        return std::chrono::steady_clock::now().time_since_epoch() /
                std::chrono::milliseconds(1);
     }
 
 #endif
 
+    long long Time::micros() {
+        return std::chrono::steady_clock::now().time_since_epoch() /
+               std::chrono::microseconds(1);
+    }
+
+    long long Time::nanos() {
+        return std::chrono::steady_clock::now().time_since_epoch() /
+               std::chrono::nanoseconds(1);
+    }
+
+    long long Time::epochMillis() {
+        return std::chrono::system_clock::now().time_since_epoch() /
+               std::chrono::milliseconds(1);
+    }
+
     void Time::waitMicros(long long micros) {
         this_thread::sleep_for(std::chrono::microseconds(micros));
     }
@@ -64,10 +86,102 @@ namespace robosub {
     }
 
     void Stopwatch::reset() {
-        resetTime = Time::millis();
+        resetTime = Time::nanos();
     }
 
     long long Stopwatch::elapsed() {
-        return Time::millis() - resetTime;
+        return (Time::nanos() - resetTime) / 1000000ll;
+    }
+
+    long long Stopwatch::elapsedMicros() {
+        return (Time::nanos() - resetTime) / 1000ll;
+    }
+
+    PeriodicTimer::PeriodicTimer(long long periodMicros) {
+        if (periodMicros <= 0) throw std::invalid_argument("Timer period must be positive");
+        periodNanos = periodMicros * 1000ll;
+        reset();
+    }
+
+    PeriodicTimer PeriodicTimer::fromFrequency(double hz) {
+        if (hz <= 0) throw std::invalid_argument("Timer frequency must be positive");
+        return PeriodicTimer((long long) std::llround(1000000.0 / hz));
+    }
+
+    void PeriodicTimer::sleepUntil(long long deadlineNanos) {
+#if defined(UNIX)
+        //steady_clock is CLOCK_MONOTONIC on Linux, so deadlines share a time base with Time::nanos()
+        struct timespec ts;
+        ts.tv_sec = (time_t) (deadlineNanos / 1000000000ll);
+        ts.tv_nsec = (long) (deadlineNanos % 1000000000ll);
+        while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, nullptr) == EINTR);
+#else
+        this_thread::sleep_until(std::chrono::steady_clock::time_point(std::chrono::nanoseconds(deadlineNanos)));
+#endif
+    }
+
+    int PeriodicTimer::wait() {
+        long long now = Time::nanos();
+        int missed = 0;
+
+        if (now > nextDeadline) {
+            //already late: run immediately and realign to the next deadline on the original grid
+            missed = (int) ((now - nextDeadline) / periodNanos);
+            overruns++;
+            missedPeriods += missed;
+            nextDeadline += (missed + 1) * periodNanos;
+        } else {
+            sleepUntil(nextDeadline);
+
+            long long latency = Time::nanos() - nextDeadline;
+            if (jitterSamples == 0 || latency < jitterMin) jitterMin = latency;
+            if (jitterSamples == 0 || latency > jitterMax) jitterMax = latency;
+            jitterSum += (double) latency;
+            jitterSqSum += (double) latency * (double) latency;
+            jitterSamples++;
+
+            nextDeadline += periodNanos;
+        }
+
+        ticks++;
+        return missed;
+    }
+
+    void PeriodicTimer::reset() {
+        nextDeadline = Time::nanos() + periodNanos;
+        ticks = 0;
+        overruns = 0;
+        missedPeriods = 0;
+        jitterSamples = 0;
+        jitterMin = 0;
+        jitterMax = 0;
+        jitterSum = 0;
+        jitterSqSum = 0;
+    }
+
+    void PeriodicTimer::setPeriodMicros(long long periodMicros) {
+        if (periodMicros <= 0) throw std::invalid_argument("Timer period must be positive");
+        nextDeadline += periodMicros * 1000ll - periodNanos;
+        periodNanos = periodMicros * 1000ll;
+    }
+
+    long long PeriodicTimer::getPeriodMicros() {
+        return periodNanos / 1000ll;
+    }
+
+    PeriodicTimer::Stats PeriodicTimer::getStats() {
+        Stats stats;
+        stats.ticks = ticks;
+        stats.overruns = overruns;
+        stats.missedPeriods = missedPeriods;
+        if (jitterSamples > 0) {
+            double mean = jitterSum / (double) jitterSamples;
+            double variance = jitterSqSum / (double) jitterSamples - mean * mean;
+            stats.jitterMin = (double) jitterMin / 1000.0;
+            stats.jitterMax = (double) jitterMax / 1000.0;
+            stats.jitterMean = mean / 1000.0;
+            stats.jitterStdDev = std::sqrt(std::max(variance, 0.0)) / 1000.0;
+        }
+        return stats;
     }
 }
@@ -8,59 +8,45 @@ namespace robosub {
         fps->frame();
     }
 
-    bool Camera::testLiveStream() {
-        if (!isOpen()) return false;
-        liveStream = cap->get(cv::CAP_PROP_POS_FRAMES) < 0 || cap->get(cv::CAP_PROP_FPS) == 0;
-        init = true;
-        return liveStream;
+    Camera::Camera(int index) : Camera(new CaptureFrameSource(index)) {
     }
 
-    Camera::Camera(int index) {
-        cap = new VideoCapture(index);
-        fps = new FPS();
-        frame = 0;
-        startTime = 0;
-        lastTime = Time::millis();
-        testLiveStream();
+    Camera::Camera(string file) : Camera(new CaptureFrameSource(file)) {
     }
 
-    Camera::Camera(string file) {
-        cap = new VideoCapture(file);
-        cap->set(cv::CAP_PROP_FOURCC,
-                 cv::VideoWriter::fourcc('M', 'J', 'P', 'G')); //THIS MAKES IT WORK WITH > 1 CAMERA!!!!!
-
+    Camera::Camera(FrameSource *source) {
+        this->source = source;
         fps = new FPS();
         frame = 0;
         startTime = 0;
         lastTime = Time::millis();
-        testLiveStream();
     }
 
     Camera::~Camera() {
-        delete cap;
+        delete source;
         delete fps;
     }
 
     bool Camera::isOpen() {
-        return cap->isOpened();
+        return source->isOpen();
     }
 
     bool Camera::grabFrame() {
-        return cap->grab();
+        return source->grab();
     }
 
     bool Camera::getGrabbedFrame(Mat &img) {
-        if (!cap->retrieve(img)) return false;
+        if (!source->retrieve(img)) return false;
         updateRetrieveTime();
         return true;
     }
 
     bool Camera::retrieveFrameBGR(Mat &img) {
 #ifdef WINDOWS
-        if (!cap->retrieve(img)) return false;
+        if (!source->retrieve(img)) return false;
 #else
-        if (!cap->grab()) return false;
-        if (!cap->retrieve(img)) return false;
+        if (!source->grab()) return false;
+        if (!source->retrieve(img)) return false;
 #endif
         updateRetrieveTime();
         return true;
@@ -68,10 +54,10 @@ namespace robosub {
 
     bool Camera::retrieveFrameGrey(Mat &img) {
 #ifdef WINDOWS
-        if (!cap->retrieve(img)) return false;
+        if (!source->retrieve(img)) return false;
 #else
-        if (!cap->grab()) return false;
-        if (!cap->retrieve(img)) return false;
+        if (!source->grab()) return false;
+        if (!source->retrieve(img)) return false;
 #endif
         updateRetrieveTime();
         cvtColor(img, img, COLOR_BGR2GRAY, CV_8UC1);
@@ -144,6 +130,11 @@ namespace robosub {
 
     Mat Camera::undistort(Mat &frame, CalibrationData &calib) {
         Mat output;
+        undistort(frame, output, calib);
+        return output;
+    }
+
+    void Camera::undistort(Mat &frame, Mat &output, CalibrationData &calib) {
         switch (calib.model) {
             case CalibrationData::Model::PINHOLE:
                 cv::undistort(frame, output, calib.cameraMatrix, calib.distortionMatrix, calib.cameraMatrix);
@@ -153,7 +144,19 @@ namespace robosub {
                                             calib.cameraMatrix);
                 break;
         }
-        return output;
+    }
+
+    void Camera::initUndistortMaps(Size frameSize, CalibrationData &calib, Mat &map1, Mat &map2) {
+        switch (calib.model) {
+            case CalibrationData::Model::PINHOLE:
+                initUndistortRectifyMap(calib.cameraMatrix, calib.distortionMatrix, Mat(), calib.cameraMatrix,
+                                        frameSize, CV_16SC2, map1, map2);
+                break;
+            case CalibrationData::Model::FISHEYE:
+                cv::fisheye::initUndistortRectifyMap(calib.cameraMatrix, calib.distortionMatrix, Matx33d::eye(),
+                                                     calib.cameraMatrix, frameSize, CV_16SC2, map1, map2);
+                break;
+        }
     }
 
     void Camera::undistortPoints(InputArray &points, OutputArray &pointsOptimal, CalibrationData &calib) {
@@ -162,18 +165,17 @@ namespace robosub {
 
     double Camera::getFrameRate() {
         if (isLiveStream()) return fps->fps();
-        return cap->get(cv::CAP_PROP_FPS);
+        return source->getFrameRate();
     }
 
     cv::Size Camera::getFrameSize() {
         if (!isOpen()) return cv::Size(0, 0);
-        return cv::Size(cap->get(cv::CAP_PROP_FRAME_WIDTH), cap->get(cv::CAP_PROP_FRAME_HEIGHT));
+        return source->getFrameSize();
     }
 
     cv::Size Camera::setFrameSize(cv::Size size) {
         if (isOpen()) {
-            cap->set(cv::CAP_PROP_FRAME_WIDTH, size.width);
-            cap->set(cv::CAP_PROP_FRAME_HEIGHT, size.height);
+            return source->setFrameSize(size);
         }
         return getFrameSize();
     }
@@ -184,21 +186,24 @@ namespace robosub {
 
     long Camera::getPositionFrame() {
         if (isLiveStream()) return frame;
-        return cap->get(cv::CAP_PROP_POS_FRAMES);
+        return source->getPositionFrame();
     }
 
     double Camera::getPositionSeconds() {
         if (isLiveStream()) return (lastTime - startTime) / 1000.0;
-        return cap->get(cv::CAP_PROP_POS_MSEC) / 1000.0;
+        return source->getPositionSeconds();
     }
 
     long Camera::getFrameCount() {
         if (isLiveStream()) return 0;
-        return cap->get(cv::CAP_PROP_FRAME_COUNT);
+        return source->getFrameCount();
     }
 
     bool Camera::isLiveStream() {
-        if (!init) return testLiveStream();
-        return liveStream;
+        return source->isLiveStream();
+    }
+
+    FrameSource *Camera::getSource() {
+        return source;
     }
 }
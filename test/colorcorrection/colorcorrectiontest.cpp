@@ -0,0 +1,73 @@
+#include <opencv2/opencv.hpp>
+#include <robosub/robosub.h>
+
+using namespace std;
+using namespace robosub;
+
+static double channelSpread(const Mat &img) {
+    Scalar m = mean(img);
+    return max(m[0], max(m[1], m[2])) - min(m[0], min(m[1], m[2]));
+}
+
+//corrects synthetic frames with a strong blue-green cast, checks that the channel means move together,
+//and times the per-frame cost with and without an estimate
+int main(int argc, char **argv) {
+    const String keys =
+            "{help ?    |      | print this message                              }"
+            "{r repeat  | 200  | number of timed frames                          }"
+            "{p patch   |      | use white patch instead of gray world           }"
+            "{s show    |      | display the frames                              }";
+
+    CommandLineParser parser(argc, argv, keys);
+    parser.about("Color Correction Test");
+
+    if (parser.has("help")) {
+        parser.printMessage();
+        return 0;
+    }
+
+    SyntheticFrameSource::Settings sourceSettings;
+    sourceSettings.shapeCount = 8;
+    SyntheticFrameSource source(sourceSettings);
+
+    ColorCorrector::Settings settings;
+    if (parser.has("patch")) settings.method = ColorCorrector::WHITE_PATCH;
+    ColorCorrector corrector(settings);
+
+    Mat frame, corrected;
+    source.grab();
+    source.retrieve(frame);
+    corrector.apply(frame, corrected);
+
+    Vec3d gains = corrector.getGains();
+    double before = channelSpread(frame), after = channelSpread(corrected);
+    cout << "gains B " << Util::toStringWithPrecision(gains[0]) << ", G " << Util::toStringWithPrecision(gains[1])
+         << ", R " << Util::toStringWithPrecision(gains[2]) << endl;
+    cout << "spread of channel means: " << Util::toStringWithPrecision(before) << " before, "
+         << Util::toStringWithPrecision(after) << " after" << endl;
+
+    //steady state: one estimate every updateInterval frames, a table lookup otherwise
+    int repeat = max(parser.get<int>("repeat"), 1);
+    long long lookupMicros = 0, estimateMicros = 0;
+    for (int r = 0; r < repeat; r++) {
+        Stopwatch stopwatch;
+        corrector.apply(frame, corrected);
+        lookupMicros += stopwatch.elapsedMicros();
+    }
+    for (int r = 0; r < repeat; r++) {
+        Stopwatch stopwatch;
+        corrector.estimate(frame);
+        estimateMicros += stopwatch.elapsedMicros();
+    }
+    cout << frame.size() << ": " << Util::toStringWithPrecision(lookupMicros / 1000.0 / repeat)
+         << " ms per corrected frame, " << Util::toStringWithPrecision(estimateMicros / 1000.0 / repeat)
+         << " ms per estimate" << endl;
+
+    if (parser.has("show")) {
+        imshow("Original", frame);
+        imshow("Corrected", corrected);
+        waitKey(0);
+    }
+
+    return after < before ? 0 : 1;
+}
@@ -0,0 +1,119 @@
+#include <opencv2/opencv.hpp>
+#include <robosub/robosub.h>
+
+using namespace std;
+using namespace robosub;
+
+//segments a synthetic frame with colored blobs into several color classes with one lookup table pass,
+//compares the time against one cvtColor + inRange pass per class, and checks the connected components
+//against cv::connectedComponentsWithStats on the same labels
+int main(int argc, char **argv) {
+    const String keys =
+            "{help ?    |      | print this message                              }"
+            "{b blobs   | 40   | number of blobs of each color                   }"
+            "{r repeat  | 20   | number of timed runs of each method             }"
+            "{s show    |      | display the frame and the labels                }";
+
+    CommandLineParser parser(argc, argv, keys);
+    parser.about("Color Segmentation Benchmark");
+
+    if (parser.has("help")) {
+        parser.printMessage();
+        return 0;
+    }
+
+    int blobs = parser.get<int>("blobs");
+    int repeat = max(parser.get<int>("repeat"), 1);
+
+    ColorSegmenter segmenter;
+    segmenter.MIN_AREA = 20;
+    segmenter.addClass("red", Scalar(170, 120, 70), Scalar(10, 255, 255));
+    segmenter.addClass("orange", Scalar(11, 120, 70), Scalar(25, 255, 255));
+    segmenter.addClass("yellow", Scalar(26, 120, 70), Scalar(35, 255, 255));
+    segmenter.addClass("green", Scalar(45, 120, 70), Scalar(80, 255, 255));
+    const Scalar drawColors[] = {Scalar(30, 30, 220), Scalar(20, 130, 240), Scalar(30, 220, 230), Scalar(40, 200, 40)};
+
+    SyntheticFrameSource::Settings settings;
+    settings.shapeCount = 0;
+    SyntheticFrameSource source(settings);
+    Mat frame;
+    source.grab();
+    source.retrieve(frame);
+
+    RNG rng(0x5eed);
+    for (int c = 0; c < segmenter.getClassCount(); c++) {
+        for (int i = 0; i < blobs; i++) {
+            Point center(rng.uniform(12, frame.cols - 12), rng.uniform(12, frame.rows - 12));
+            circle(frame, center, rng.uniform(4, 12), drawColors[c], cv::FILLED);
+        }
+    }
+
+    //one HSV conversion and one threshold per class, as the old color tracking test did
+    Mat hsv;
+    vector<Mat> masks((size_t) segmenter.getClassCount());
+    Stopwatch stopwatch;
+    for (int r = 0; r < repeat; r++) {
+        for (int c = 0; c < segmenter.getClassCount(); c++) {
+            const ColorSegmenter::ColorClass &colorClass = segmenter.getClass(c + 1);
+            cvtColor(frame, hsv, COLOR_BGR2HSV);
+            if (colorClass.hsvLow[0] <= colorClass.hsvHigh[0]) {
+                inRange(hsv, colorClass.hsvLow, colorClass.hsvHigh, masks[c]);
+            } else {
+                Mat wrapped;
+                inRange(hsv, colorClass.hsvLow, Scalar(180, colorClass.hsvHigh[1], colorClass.hsvHigh[2]), masks[c]);
+                inRange(hsv, Scalar(0, colorClass.hsvLow[1], colorClass.hsvLow[2]), colorClass.hsvHigh, wrapped);
+                masks[c] |= wrapped;
+            }
+        }
+    }
+    double thresholdMicros = (double) stopwatch.elapsedMicros() / repeat;
+
+    Mat labels;
+    vector<ColorSegmenter::Component> components;
+    segmenter.compile();
+    stopwatch.reset();
+    for (int r = 0; r < repeat; r++) {
+        segmenter.segment(frame, components, labels);
+    }
+    double segmentMicros = (double) stopwatch.elapsedMicros() / repeat;
+
+    //pixels where the quantized table disagrees with exact HSV thresholds
+    long long differing = 0;
+    for (int c = 0; c < segmenter.getClassCount(); c++) {
+        Mat exact = masks[c] != 0, quantized = labels == (c + 1);
+        differing += countNonZero(exact != quantized);
+    }
+
+    //the union-find components must match OpenCV's labeling of each class
+    int mismatches = 0;
+    for (int c = 0; c < segmenter.getClassCount(); c++) {
+        Mat componentLabels, stats, centroids;
+        int count = connectedComponentsWithStats(labels == (c + 1), componentLabels, stats, centroids, 8);
+        vector<int> expected;
+        for (int i = 1; i < count; i++) {
+            if (stats.at<int>(i, CC_STAT_AREA) >= segmenter.MIN_AREA) expected.push_back(stats.at<int>(i, CC_STAT_AREA));
+        }
+        vector<int> found;
+        for (const ColorSegmenter::Component &component : components) {
+            if (component.classId == c + 1) found.push_back(component.area);
+        }
+        sort(expected.begin(), expected.end());
+        sort(found.begin(), found.end());
+        if (expected != found) mismatches++;
+
+        cout << segmenter.getClass(c + 1).name << ": " << found.size() << " components" << endl;
+    }
+
+    cout << "per-class thresholds: " << Util::toStringWithPrecision(thresholdMicros / 1000.0) << " ms" << endl;
+    cout << "lookup table + components: " << Util::toStringWithPrecision(segmentMicros / 1000.0) << " ms" << endl;
+    cout << "pixels differing from exact HSV thresholds: " << differing << " of " << frame.total() << endl;
+
+    if (parser.has("show")) {
+        Mat display = labels * (255 / max(segmenter.getClassCount(), 1));
+        imshow("Frame", frame);
+        imshow("Labels", display);
+        waitKey(0);
+    }
+
+    return mismatches == 0 ? 0 : 1;
+}
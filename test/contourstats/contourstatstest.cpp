@@ -0,0 +1,103 @@
+#include <opencv2/opencv.hpp>
+#include <robosub/robosub.h>
+
+using namespace std;
+using namespace robosub;
+
+//compares contour statistics computed with full-frame masks, ROI masks and one batch label pass
+//on a frame full of small blobs, and checks that all three agree
+int main(int argc, char **argv) {
+    const String keys =
+            "{help ?    |      | print this message                              }"
+            "{b blobs   | 300  | number of blobs drawn in the frame              }"
+            "{r repeat  | 5    | number of timed runs of each method             }"
+            "{s show    |      | display the frame                               }";
+
+    CommandLineParser parser(argc, argv, keys);
+    parser.about("Contour Statistics Benchmark");
+
+    if (parser.has("help")) {
+        parser.printMessage();
+        return 0;
+    }
+
+    int blobs = parser.get<int>("blobs");
+    int repeat = max(parser.get<int>("repeat"), 1);
+
+    //synthetic background with noise, then many small dark blobs so findContours returns hundreds of contours
+    SyntheticFrameSource::Settings settings;
+    settings.shapeCount = 0;
+    SyntheticFrameSource source(settings);
+    Mat frame;
+    source.grab();
+    source.retrieve(frame);
+
+    RNG rng(0x5eed);
+    for (int i = 0; i < blobs; i++) {
+        Point center(rng.uniform(8, frame.cols - 8), rng.uniform(8, frame.rows - 8));
+        circle(frame, center, rng.uniform(2, 7), Scalar(rng.uniform(0, 60), rng.uniform(0, 60), rng.uniform(0, 60)),
+               cv::FILLED);
+    }
+
+    Mat gray, binary;
+    cvtColor(frame, gray, COLOR_BGR2GRAY);
+    threshold(gray, binary, 80, 255, THRESH_BINARY_INV);
+    vector<vector<Point>> contours;
+    vector<Vec4i> hierarchy;
+    findContours(binary, contours, hierarchy, RETR_EXTERNAL, CHAIN_APPROX_SIMPLE);
+    cout << contours.size() << " contours in a " << frame.size() << " frame" << endl;
+
+    vector<Scalar> fullMeans(contours.size()), roiMeans(contours.size());
+    vector<ContourStats> batch;
+
+    //full-frame mask per contour (previous behavior)
+    Stopwatch stopwatch;
+    for (int r = 0; r < repeat; r++) {
+        for (size_t i = 0; i < contours.size(); i++) {
+            Contour c = Contour(contours[i]);
+            fullMeans[i] = mean(frame, c.getMask(frame.size()));
+        }
+    }
+    double fullMicros = (double) stopwatch.elapsedMicros() / repeat;
+
+    //bounding box mask per contour, one scratch buffer
+    Mat scratch;
+    stopwatch.reset();
+    for (int r = 0; r < repeat; r++) {
+        for (size_t i = 0; i < contours.size(); i++) {
+            Contour c = Contour(contours[i]);
+            roiMeans[i] = c.averageColor(frame, scratch);
+        }
+    }
+    double roiMicros = (double) stopwatch.elapsedMicros() / repeat;
+
+    //every contour in one pass over a label image
+    Mat labels;
+    stopwatch.reset();
+    for (int r = 0; r < repeat; r++) {
+        ContourStats::compute(frame, contours, batch, labels);
+    }
+    double batchMicros = (double) stopwatch.elapsedMicros() / repeat;
+
+    double roiError = 0, batchError = 0;
+    for (size_t i = 0; i < contours.size(); i++) {
+        for (int c = 0; c < 3; c++) {
+            roiError = max(roiError, abs(roiMeans[i][c] - fullMeans[i][c]));
+            batchError = max(batchError, abs(batch[i].meanColor[c] - fullMeans[i][c]));
+        }
+    }
+
+    cout << "full-frame masks: " << Util::toStringWithPrecision(fullMicros / 1000.0) << " ms" << endl;
+    cout << "ROI masks:        " << Util::toStringWithPrecision(roiMicros / 1000.0) << " ms, max error "
+         << Util::toStringWithPrecision(roiError) << endl;
+    cout << "batch labels:     " << Util::toStringWithPrecision(batchMicros / 1000.0) << " ms, max error "
+         << Util::toStringWithPrecision(batchError) << endl;
+
+    if (parser.has("show")) {
+        imshow("Frame", frame);
+        waitKey(0);
+    }
+
+    //overlapping blobs merge into one contour, so the methods must agree exactly
+    return roiError < 1e-6 && batchError < 1e-6 ? 0 : 1;
+}
@@ -0,0 +1,119 @@
+#include <opencv2/opencv.hpp>
+#include <robosub/robosub.h>
+
+using namespace std;
+using namespace robosub;
+
+//per-pixel floating point blend, as Drawing::transparentImage used to work
+static void referenceBlend(Mat &src, const Mat &overlay, const Point &location) {
+    for (int y = max(location.y, 0); y < src.rows && y - location.y < overlay.rows; ++y) {
+        for (int x = max(location.x, 0); x < src.cols && x - location.x < overlay.cols; ++x) {
+            const uchar *o = overlay.ptr<uchar>(y - location.y) + (x - location.x) * overlay.channels();
+            uchar *p = src.ptr<uchar>(y) + x * src.channels();
+            double opacity = o[3] / 255.0;
+            for (int c = 0; opacity > 0 && c < src.channels(); ++c) {
+                p[c] = (uchar) (p[c] * (1. - opacity) + o[c] * opacity);
+            }
+        }
+    }
+}
+
+//blends random overlays onto random frames at positions that clip every edge, checks the result against
+//the floating point blend and times both, then times text labels drawn with putText and with HudOverlay
+int main(int argc, char **argv) {
+    const String keys =
+            "{help ?    |      | print this message                              }"
+            "{r repeat  | 50   | number of timed runs                            }";
+
+    CommandLineParser parser(argc, argv, keys);
+    parser.about("Drawing Test");
+
+    if (parser.has("help")) {
+        parser.printMessage();
+        return 0;
+    }
+
+    int repeat = max(parser.get<int>("repeat"), 1);
+    RNG rng(0x5eed);
+    int maxError = 0;
+
+    const Size overlaySizes[] = {Size(37, 11), Size(300, 40), Size(1280, 720)};
+    const Point locations[] = {Point(0, 0), Point(-13, -7), Point(1270, 715), Point(100, 600), Point(-200, 300)};
+
+    for (int channels : {3, 4}) {
+        for (const Size &overlaySize : overlaySizes) {
+            Mat frame(720, 1280, CV_8UC(channels)), overlay(overlaySize, CV_8UC4);
+            rng.fill(frame, RNG::UNIFORM, Scalar::all(0), Scalar::all(256));
+            rng.fill(overlay, RNG::UNIFORM, Scalar::all(0), Scalar::all(256));
+
+            for (const Point &location : locations) {
+                Mat expected = frame.clone(), actual = frame.clone();
+                referenceBlend(expected, overlay, location);
+                Drawing::transparentImage(&actual, &overlay, location);
+
+                Mat difference;
+                absdiff(expected, actual, difference);
+                double error;
+                minMaxLoc(difference.reshape(1), nullptr, &error);
+                maxError = max(maxError, (int) error);
+            }
+
+            Mat target = frame.clone();
+            Stopwatch stopwatch;
+            for (int r = 0; r < repeat; r++) referenceBlend(target, overlay, Point(0, 0));
+            double referenceMicros = (double) stopwatch.elapsedMicros() / repeat;
+            stopwatch.reset();
+            for (int r = 0; r < repeat; r++) Drawing::transparentImage(&target, &overlay, Point(0, 0));
+            double blendMicros = (double) stopwatch.elapsedMicros() / repeat;
+
+            cout << channels << " channels, " << overlaySize << " overlay: reference "
+                 << Util::toStringWithPrecision(referenceMicros / 1000.0) << " ms, transparentImage "
+                 << Util::toStringWithPrecision(blendMicros / 1000.0) << " ms" << endl;
+        }
+    }
+
+    cout << "max difference from the floating point blend: " << maxError << endl;
+
+    //status labels as video-control draws them: putText every frame against the cached overlay
+    Mat frame(720, 1280, CV_8UC3, Scalar(90, 70, 30)), textFrame, hudFrame;
+    HudOverlay hud;
+    HudOverlay::Style style;
+    style.thickness = 2;
+    int fpsLabel = hud.addLabel(Point(16, 48), Drawing::Anchor::BOTTOM_LEFT, style);
+    int rateLabel = hud.addLabel(Point(16, 16), Drawing::Anchor::BOTTOM_LEFT, style);
+    long long textMicros = 0, hudMicros = 0;
+    int outside = 0;
+
+    for (int r = 0; r < repeat; r++) {
+        String fps = Util::toStringWithPrecision(29.0 + (r % 20) / 10.0) + " fps";
+        String rate = Util::toStringWithPrecision(4.0 + (r % 7) / 4.0) + " Mbps";
+        frame.copyTo(textFrame);
+        frame.copyTo(hudFrame);
+
+        Stopwatch stopwatch;
+        Drawing::text(textFrame, fps, Point(16, 48), Scalar(255, 255, 255), Drawing::Anchor::BOTTOM_LEFT, 0.5);
+        Drawing::text(textFrame, rate, Point(16, 16), Scalar(255, 255, 255), Drawing::Anchor::BOTTOM_LEFT, 0.5);
+        textMicros += stopwatch.elapsedMicros();
+
+        stopwatch.reset();
+        hud.setText(fpsLabel, fps);
+        hud.setText(rateLabel, rate);
+        hud.draw(hudFrame);
+        hudMicros += stopwatch.elapsedMicros();
+
+        //the overlay may only touch its label rectangles
+        Mat changed;
+        absdiff(frame, hudFrame, changed);
+        cvtColor(changed, changed, COLOR_BGR2GRAY);
+        changed(hud.getBounds(fpsLabel, frame.size())).setTo(Scalar(0));
+        changed(hud.getBounds(rateLabel, frame.size())).setTo(Scalar(0));
+        outside += countNonZero(changed);
+    }
+
+    cout << "labels with putText: " << Util::toStringWithPrecision(textMicros / 1000.0 / repeat)
+         << " ms/frame, cached overlay: " << Util::toStringWithPrecision(hudMicros / 1000.0 / repeat) << " ms/frame"
+         << endl;
+    cout << outside << " pixels changed outside the label rectangles" << endl;
+
+    return maxError <= 1 && outside == 0 ? 0 : 1;
+}
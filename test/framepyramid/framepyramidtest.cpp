@@ -0,0 +1,83 @@
+#include <opencv2/opencv.hpp>
+#include <robosub/robosub.h>
+
+using namespace std;
+using namespace robosub;
+
+//checks that pyramid levels match a direct pyrDown chain and are built only once however many stages read them,
+//then times three stages that each want a small copy of the frame, with and without a shared pyramid
+int main(int argc, char **argv) {
+    const String keys =
+            "{help ?    |      | print this message                              }"
+            "{r repeat  | 200  | number of timed frames                          }";
+
+    CommandLineParser parser(argc, argv, keys);
+    parser.about("Frame Pyramid Test");
+
+    if (parser.has("help")) {
+        parser.printMessage();
+        return 0;
+    }
+
+    SyntheticFrameSource::Settings settings;
+    SyntheticFrameSource source(settings);
+    Mat frame;
+    source.grab();
+    source.retrieve(frame);
+
+    int failures = 0;
+    FramePyramid pyramid(frame);
+    if (pyramid.getBuiltLevels() != 1) {
+        cout << "levels were built before they were used" << endl;
+        failures++;
+    }
+
+    Mat expected = frame;
+    for (int i = 1; i <= 3; i++) {
+        pyrDown(expected, expected);
+        const Mat &level = pyramid.level(i);
+        if (level.size() != pyramid.levelSize(i) || norm(level, expected, NORM_INF) != 0) {
+            cout << "level " << i << " differs from pyrDown" << endl;
+            failures++;
+        }
+    }
+    pyramid.level(2);
+    pyramid.levelAtMost(frame.cols / 4);
+    if (pyramid.getBuiltLevels() != 4) {
+        cout << "reading a level again rebuilt it" << endl;
+        failures++;
+    }
+
+    FrameQualityMonitor quality;
+    FrameQualityMonitor::Metrics direct = quality.analyze(frame), shared = quality.analyze(pyramid);
+    if (direct.focus != shared.focus || direct.p50 != shared.p50 || direct.analysisSize != shared.analysisSize) {
+        cout << "quality metrics differ on the shared pyramid" << endl;
+        failures++;
+    }
+
+    //quality at 320, a half size stream copy and a quarter size thumbnail
+    int repeat = max(parser.get<int>("repeat"), 1);
+    Mat half, quarter, scratch;
+    Stopwatch stopwatch;
+    for (int r = 0; r < repeat; r++) {
+        quality.analyze(frame);
+        pyrDown(frame, half);
+        pyrDown(frame, scratch);
+        pyrDown(scratch, quarter);
+    }
+    double separateMs = stopwatch.elapsedMicros() / 1000.0 / repeat;
+
+    stopwatch.reset();
+    for (int r = 0; r < repeat; r++) {
+        pyramid.reset(frame);
+        quality.analyze(pyramid);
+        half = pyramid.level(1);
+        quarter = pyramid.level(2);
+    }
+    double sharedMs = stopwatch.elapsedMicros() / 1000.0 / repeat;
+
+    cout << frame.size() << ": " << Util::toStringWithPrecision(separateMs) << " ms per frame with separate copies, "
+         << Util::toStringWithPrecision(sharedMs) << " ms with a shared pyramid" << endl;
+
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,72 @@
+#include <opencv2/opencv.hpp>
+#include <robosub/robosub.h>
+
+using namespace std;
+using namespace robosub;
+
+//measures a clean synthetic frame and degraded copies of it (blurred, dark, overexposed, murky),
+//checks that each degradation is flagged and prints the time per frame
+int main(int argc, char **argv) {
+    const String keys =
+            "{help ?    |      | print this message                              }"
+            "{r repeat  | 200  | number of timed runs                            }";
+
+    CommandLineParser parser(argc, argv, keys);
+    parser.about("Frame Quality Test");
+
+    if (parser.has("help")) {
+        parser.printMessage();
+        return 0;
+    }
+
+    SyntheticFrameSource::Settings settings;
+    settings.shapeCount = 12;
+    SyntheticFrameSource source(settings);
+    Mat clean;
+    source.grab();
+    source.retrieve(clean);
+
+    Mat blurred, dark, bright, murky;
+    GaussianBlur(clean, blurred, Size(0, 0), 8);
+    clean.convertTo(dark, -1, 0.1);
+    clean.convertTo(bright, -1, 1.0, 200);
+    addWeighted(clean, 0.25, Mat(clean.size(), clean.type(), Scalar(140, 140, 140)), 0.75, 0, murky);
+
+    struct Case {
+        String name;
+        Mat frame;
+        int expected;
+    };
+    vector<Case> cases = {
+            {"clean",       clean,   0},
+            {"blurred",     blurred, FrameQualityMonitor::BLURRY},
+            {"dark",        dark,    FrameQualityMonitor::UNDEREXPOSED},
+            {"overexposed", bright,  FrameQualityMonitor::OVEREXPOSED},
+            {"murky",       murky,   FrameQualityMonitor::TURBID}
+    };
+
+    FrameQualityMonitor monitor;
+    int failures = 0;
+    for (Case &c : cases) {
+        FrameQualityMonitor::Metrics m = monitor.analyze(c.frame);
+        cout << c.name << ": focus " << Util::toStringWithPrecision(m.focus) << ", median " << m.p50
+             << ", contrast " << m.contrast << ", turbidity " << Util::toStringWithPrecision(m.turbidity)
+             << " -> " << (m.usable() ? String("usable") : FrameQualityMonitor::describe(m.problems)) << endl;
+
+        //clean frames must have no problems; degraded ones must at least show their own
+        bool ok = c.expected == 0 ? m.usable() : (m.problems & c.expected) != 0;
+        if (!ok) {
+            cout << "  expected " << (c.expected == 0 ? String("usable") : FrameQualityMonitor::describe(c.expected))
+                 << endl;
+            failures++;
+        }
+    }
+
+    int repeat = max(parser.get<int>("repeat"), 1);
+    Stopwatch stopwatch;
+    for (int r = 0; r < repeat; r++) monitor.analyze(clean);
+    cout << clean.size() << " frame analyzed at " << monitor.getMetrics().analysisSize << " in "
+         << Util::toStringWithPrecision(stopwatch.elapsedMicros() / 1000.0 / repeat) << " ms" << endl;
+
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,76 @@
+#include <opencv2/opencv.hpp>
+#include <robosub/robosub.h>
+
+using namespace std;
+using namespace robosub;
+
+//plays a frame source through Camera and reports the delivered frame rate
+//with no input, renders synthetic frames so the test runs on machines without cameras
+int main(int argc, char **argv) {
+    const String keys =
+            "{help ?   |       | print this message                                  }"
+            "{v video  |       | video file to replay                                }"
+            "{i images |       | image sequence to replay, e.g. samples/*.png        }"
+            "{l log    |       | frame log (.rsfl) to replay with recorded timing    }"
+            "{r record |       | write the delivered frames to a frame log           }"
+            "{f fast   |       | deliver frames as fast as possible                  }"
+            "{n frames | 300   | number of frames to read                            }"
+            "{s show   |       | display frames                                      }";
+
+    CommandLineParser parser(argc, argv, keys);
+    parser.about("Frame Source Test");
+
+    if (parser.has("help")) {
+        parser.printMessage();
+        return 0;
+    }
+
+    ReplayFrameSource::Playback playback = parser.has("fast") ? ReplayFrameSource::AS_FAST_AS_POSSIBLE
+                                                               : ReplayFrameSource::REALTIME;
+    FrameSource *source;
+    if (parser.has("video")) {
+        source = new FileReplayFrameSource(parser.get<String>("video"), playback);
+    } else if (parser.has("log")) {
+        source = new FrameLogFrameSource(parser.get<String>("log"), -1, playback);
+    } else if (parser.has("images")) {
+        source = new ImageSequenceFrameSource(parser.get<String>("images"), 30.0, playback);
+    } else {
+        source = new SyntheticFrameSource(SyntheticFrameSource::Settings(), playback);
+    }
+
+    Camera cam(source);
+    if (!cam.isOpen()) {
+        cout << "Frame source failed to open." << endl;
+        return 1;
+    }
+    cout << "Frame size " << cam.getFrameSize() << " at " << cam.getFrameRate() << " fps, "
+         << cam.getFrameCount() << " frames" << endl;
+
+    int frames = parser.get<int>("frames");
+    bool show = parser.has("show");
+    FrameLogWriter log;
+    if (parser.has("record") && !log.open(parser.get<String>("record"))) {
+        cout << "Could not open frame log for writing." << endl;
+        return 1;
+    }
+    Mat frame;
+    int grabbed = 0;
+    Stopwatch stopwatch;
+
+    for (int i = 0; i < frames; i++) {
+        if (!cam.retrieveFrameBGR(frame)) break;
+        grabbed++;
+        if (log.isOpen()) log.write(0, frame);
+
+        if (show) {
+            imshow("Frame", frame);
+            if (waitKey(1) >= 0) break;
+        }
+    }
+
+    long long elapsed = stopwatch.elapsedMicros();
+    //the source may run out before the requested count
+    cout << grabbed << " frames in " << elapsed / 1000 << " ms ("
+         << Util::toStringWithPrecision(grabbed * 1000000.0 / (double) max(elapsed, 1LL)) << " fps)" << endl;
+    return 0;
+}
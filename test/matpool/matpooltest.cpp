@@ -0,0 +1,84 @@
+#include <opencv2/opencv.hpp>
+#include <robosub/robosub.h>
+
+using namespace std;
+using namespace robosub;
+
+//one frame of the onboard vision path: capture, pyramid, quality, shape finding
+static void processFrame(SyntheticFrameSource &source, ShapeFinder &finder, FrameQualityMonitor &quality,
+                         FramePyramid &pyramid, Mat &frame, ShapeFindResult &result) {
+    source.grab();
+    source.retrieve(frame);
+    pyramid.reset(frame);
+    quality.analyze(pyramid);
+    Mat input = frame.clone();
+    finder.processFrame(input, result);
+}
+
+//runs the vision path on synthetic frames with a MatPool installed, checks that buffers stop coming from the
+//system once the first frames have been seen, and compares the time per frame with the default allocator
+int main(int argc, char **argv) {
+    const String keys =
+            "{help ?    |      | print this message                              }"
+            "{n frames  | 200  | timed frames                                    }"
+            "{w warmup  | 10   | frames before the counters are reset            }";
+
+    CommandLineParser parser(argc, argv, keys);
+    parser.about("Mat Pool Test");
+
+    if (parser.has("help")) {
+        parser.printMessage();
+        return 0;
+    }
+
+    const int frames = max(parser.get<int>("frames"), 1);
+    SyntheticFrameSource::Settings settings;
+    Camera::CalibrationData calibration(settings.frameSize, Camera::CalibrationData::PINHOLE);
+
+    long long defaultMicros;
+    {
+        SyntheticFrameSource source(settings);
+        ShapeFinder finder(calibration);
+        FrameQualityMonitor quality;
+        FramePyramid pyramid;
+        Mat frame;
+        ShapeFindResult result;
+        Stopwatch stopwatch;
+        for (int i = 0; i < frames; i++) processFrame(source, finder, quality, pyramid, frame, result);
+        defaultMicros = stopwatch.elapsedMicros();
+    }
+
+    MatPool pool;
+    pool.install();
+    long long pooledMicros;
+    MatPool::Stats stats;
+    {
+        SyntheticFrameSource source(settings);
+        ShapeFinder finder(calibration);
+        FrameQualityMonitor quality;
+        FramePyramid pyramid;
+        Mat frame;
+        ShapeFindResult result;
+        for (int i = 0; i < parser.get<int>("warmup"); i++) {
+            processFrame(source, finder, quality, pyramid, frame, result);
+        }
+        pool.resetStats();
+
+        Stopwatch stopwatch;
+        for (int i = 0; i < frames; i++) processFrame(source, finder, quality, pyramid, frame, result);
+        pooledMicros = stopwatch.elapsedMicros();
+        stats = pool.getStats();
+    }
+    pool.uninstall();
+
+    cout << stats.allocations / frames << " buffers per frame, hit rate "
+         << Util::toStringWithPrecision(stats.hitRate() * 100.0) << "%, " << stats.systemAllocations
+         << " from the system in " << frames << " frames" << endl;
+    cout << "peak " << Util::toStringWithPrecision(stats.peakBytes / 1048576.0) << " MiB held, "
+         << Util::toStringWithPrecision(stats.peakBytesInUse / 1048576.0) << " MiB in use" << endl;
+    cout << Util::toStringWithPrecision(defaultMicros / 1000.0 / frames) << " ms/frame with the default allocator, "
+         << Util::toStringWithPrecision(pooledMicros / 1000.0 / frames) << " ms/frame pooled" << endl;
+
+    //a steady frame loop should be served from the pool almost entirely
+    return stats.systemAllocations * 20 <= (unsigned long long) frames ? 0 : 1;
+}
@@ -0,0 +1,104 @@
+#include <opencv2/opencv.hpp>
+#include <robosub/robosub.h>
+
+using namespace std;
+using namespace robosub;
+
+struct LabeledFrame {
+    Mat image;
+    int counts[4];
+};
+
+static vector<LabeledFrame> samples;
+static Camera::CalibrationData calibration;
+
+//thread-safe: a finder and result per call, and processFrame() only replaces the header of its input copy
+static double countError(const ParameterSet &parameters) {
+    ShapeFinder finder(calibration);
+    finder.MIN_AREA = parameters.at("MIN_AREA");
+    finder.SQUARE_RATIO_THRESHOLD = parameters.at("SQUARE_RATIO_THRESHOLD");
+    finder.TRIANGLE_RATIO_THRESHOLD = parameters.at("TRIANGLE_RATIO_THRESHOLD");
+    finder.IMAGE_BLACK_THRESHOLD = parameters.at("IMAGE_BLACK_THRESHOLD");
+
+    double error = 0;
+    for (const LabeledFrame &sample : samples) {
+        ShapeFindResult result;
+        Mat input = sample.image;
+        finder.processFrame(input, result);
+        error += abs((int) result.triangles.size() - sample.counts[SyntheticFrameSource::TRIANGLE]);
+        error += abs((int) result.squares.size() - sample.counts[SyntheticFrameSource::SQUARE]);
+        error += abs((int) result.rectangles.size() - sample.counts[SyntheticFrameSource::RECTANGLE]);
+        error += abs((int) result.circles.size() - sample.counts[SyntheticFrameSource::CIRCLE]);
+    }
+    return error;
+}
+
+//tunes a few ShapeFinder parameters against synthetic frames with known shape counts, once on one thread and
+//once on the pool, and checks that the same seed gives the same parameters either way
+int main(int argc, char **argv) {
+    const String keys =
+            "{help ?    |      | print this message                              }"
+            "{n samples | 4    | synthetic frames in the sample set              }"
+            "{t threads | 0    | tuner threads (0 for one per core)              }"
+            "{p population | 30 | members of every generation                  }";
+
+    CommandLineParser parser(argc, argv, keys);
+    parser.about("Parallel Parameter Tuning Test");
+
+    if (parser.has("help")) {
+        parser.printMessage();
+        return 0;
+    }
+
+    SyntheticFrameSource::Settings settings;
+    settings.frameSize = Size(640, 360);
+    settings.shapeCount = 8;
+    SyntheticFrameSource source(settings);
+    calibration = Camera::CalibrationData(settings.frameSize, Camera::CalibrationData::PINHOLE);
+    for (int i = 0; i < parser.get<int>("samples"); i++) {
+        LabeledFrame sample;
+        source.grab();
+        source.retrieve(sample.image);
+        for (int type = SyntheticFrameSource::TRIANGLE; type <= SyntheticFrameSource::CIRCLE; type++) {
+            sample.counts[type] = source.countShapes((SyntheticFrameSource::ShapeType) type);
+        }
+        samples.push_back(sample);
+    }
+
+    ShapeFinder defaults(calibration);
+    map<string, ParameterMetadata> parameters = {
+            {"MIN_AREA",                 ParameterMetadata(defaults.MIN_AREA, 0, 100)},
+            {"SQUARE_RATIO_THRESHOLD",   ParameterMetadata(defaults.SQUARE_RATIO_THRESHOLD, 0, 1)},
+            {"TRIANGLE_RATIO_THRESHOLD", ParameterMetadata(defaults.TRIANGLE_RATIO_THRESHOLD, 0, 1)},
+            {"IMAGE_BLACK_THRESHOLD",    ParameterMetadata(defaults.IMAGE_BLACK_THRESHOLD, 0, 300)}
+    };
+
+    ParameterTuner serial(1), parallel(parser.get<int>("threads"));
+    serial.setPopulationSize(parser.get<int>("population"));
+    parallel.setPopulationSize(parser.get<int>("population"));
+
+    Stopwatch stopwatch;
+    map<string, double> serialBest = serial.tuneParameters(parameters, countError);
+    long long serialMicros = stopwatch.elapsedMicros();
+
+    stopwatch.reset();
+    map<string, double> parallelBest = parallel.tuneParameters(parameters, countError);
+    long long parallelMicros = stopwatch.elapsedMicros();
+
+    cout << "one thread: " << Util::toStringWithPrecision(serialMicros / 1e6) << " s, pool: "
+         << Util::toStringWithPrecision(parallelMicros / 1e6) << " s; " << parallel.getEvaluationCount()
+         << " parameter sets scored, " << parallel.getCacheHitCount() << " reused" << endl;
+    for (auto const &parameter : parallelBest) {
+        cout << "\t" << parameter.first << ": " << parameter.second << " (default: "
+             << parameters.at(parameter.first).initValue << ")" << endl;
+    }
+    ParameterSchema schema(parameters);
+    vector<double> best(schema.size()), initial(schema.size());
+    schema.fromMap(parallelBest, best.data());
+    schema.initialValues(initial.data());
+    cout << "error " << countError(ParameterSet(schema, best.data())) << ", defaults "
+         << countError(ParameterSet(schema, initial.data())) << endl;
+
+    //same seed, same populations: the thread count must not change the result
+    return serialBest == parallelBest ? 0 : 1;
+}
@@ -0,0 +1,89 @@
+#include <opencv2/opencv.hpp>
+#include <robosub/robosub.h>
+
+using namespace std;
+using namespace robosub;
+
+//camera -> detect -> telemetry on synthetic frames over backpressure edges (every frame arrives, in order),
+//with a slow display on a latest-only edge from the detector at the same time (frames are dropped there,
+//the detector never waits)
+//There is no separate undistort stage: ShapeFinder undistorts each cache-sized band as it preprocesses it.
+int main(int argc, char **argv) {
+    const String keys =
+            "{help ?    |      | print this message                              }"
+            "{n frames  | 120  | frames produced by the camera stage             }"
+            "{d detect  | 2    | detector workers                                }";
+
+    CommandLineParser parser(argc, argv, keys);
+    parser.about("Pipeline Test");
+
+    if (parser.has("help")) {
+        parser.printMessage();
+        return 0;
+    }
+
+    const int frames = parser.get<int>("frames");
+    const int detectors = max(parser.get<int>("detect"), 1);
+    SyntheticFrameSource::Settings settings;
+    SyntheticFrameSource source(settings);
+    Camera::CalibrationData calibration(settings.frameSize, Camera::CalibrationData::PINHOLE);
+
+    vector<ShapeFinder *> finders;
+    for (int i = 0; i < detectors; i++) finders.push_back(new ShapeFinder(calibration));
+
+    long long lastSequence = -1;
+    int received = 0, outOfOrder = 0, displayed = 0;
+
+    Pipeline pipeline;
+    int camera = pipeline.addSource("camera", [&](PipelineItem &item) -> bool {
+        if (item.sequence >= frames) return false;
+        return source.grab() && source.retrieve(item.image);
+    });
+    int detect = pipeline.addStage("detect", [&](PipelineItem &item) -> bool {
+        //each worker has its own finder, since ShapeFinder keeps per-frame buffers
+        static atomic<int> nextFinder(0);
+        thread_local int finder = nextFinder++ % detectors;
+        //processing replaces the frame with its undistorted grayscale version; later stages keep the camera frame
+        Mat input = item.image.clone();
+        ShapeFindResult result;
+        finders[finder]->processFrame(input, result);
+        item.results["shapes"] = result.triangles.size() + result.squares.size() + result.rectangles.size() +
+                                 result.circles.size();
+        return true;
+    }, detectors);
+    int telemetry = pipeline.addStage("telemetry", [&](PipelineItem &item) -> bool {
+        //several detectors may finish out of order; single-worker stages in front of them may not
+        received++;
+        if (detectors == 1 && item.sequence <= lastSequence) outOfOrder++;
+        lastSequence = max(lastSequence, item.sequence);
+        return true;
+    });
+    int display = pipeline.addStage("display", [&](PipelineItem &item) -> bool {
+        robosub::Time::waitMicros(40000);
+        displayed++;
+        return true;
+    });
+
+    pipeline.connect(camera, detect, Pipeline::BLOCK);
+    pipeline.connect(detect, telemetry, Pipeline::BLOCK);
+    pipeline.connect(detect, display, Pipeline::LATEST_ONLY, 1);
+
+    Stopwatch stopwatch;
+    pipeline.start();
+    pipeline.wait();
+    double seconds = stopwatch.elapsedMicros() / 1e6;
+
+    for (const Pipeline::StageStats &stats : pipeline.getStats()) {
+        cout << stats.name << ": " << stats.processed << " items, " << stats.dropped << " dropped, "
+             << Util::toStringWithPrecision(stats.meanMicros / 1000.0) << " ms each, latency "
+             << Util::toStringWithPrecision(stats.meanLatencyMicros / 1000.0) << " ms" << endl;
+    }
+    cout << Util::toStringWithPrecision(received / max(seconds, 1e-6)) << " frames/s end to end, "
+         << displayed << " of " << received << " displayed" << endl;
+
+    for (ShapeFinder *finder : finders) delete finder;
+
+    //backpressure edges lose nothing; the latest-only display must have skipped frames rather than stall
+    bool ok = received == frames && outOfOrder == 0 && displayed < received;
+    return ok ? 0 : 1;
+}
@@ -27,10 +27,10 @@ static int getTrackbar(char *name) {
 }
 
 static void updateSample(TuningSample<int> *sample) {
-    sample->sampleData->insert({"N_SQUARES", N_SQUARES});
-    sample->sampleData->insert({"N_CIRCLES", N_CIRCLES});
-    sample->sampleData->insert({"N_RECTANGLES", N_RECTANGLES});
-    sample->sampleData->insert({"N_TRIANGLES", N_TRIANGLES});
+    sample->sampleData["N_SQUARES"] = N_SQUARES;
+    sample->sampleData["N_CIRCLES"] = N_CIRCLES;
+    sample->sampleData["N_RECTANGLES"] = N_RECTANGLES;
+    sample->sampleData["N_TRIANGLES"] = N_TRIANGLES;
 }
 
 
@@ -90,19 +90,22 @@ void setParameters(ShapeFinder &sf, map<string, double> parameters) {
     sf.CONTOUR_BLACK_THRESHOLD = parameters.at("CONTOUR_BLACK_THRESHOLD");
 }
 
+//runs on the tuner's threads: every call has its own finder and result, and processFrame() only replaces
+//the header of its copy of a sample image
 double parameterEvaluationFunction(map<string, double> parameters) {
     ShapeFinder sf(CALIBRATION_DATA);
     setParameters(sf, std::move(parameters));
 
     double error = 0;
-    for (auto sample: *TUNING_SAMPLES) {
-        auto result = new ShapeFindResult();
-        sf.processFrame(sample.image, *result);
-
-        error += abs(result->getLastSquareCount() - sample.sampleData->at("N_SQUARES"));
-        error += abs(result->getLastCircleCount() - sample.sampleData->at("N_CIRCLES"));
-        error += abs(result->getLastRectangleCount() - sample.sampleData->at("N_RECTANGLES"));
-        error += abs(result->getLastTriangleCount() - sample.sampleData->at("N_TRIANGLES"));
+    for (const TuningSample<int> &sample: *TUNING_SAMPLES) {
+        ShapeFindResult result;
+        Mat input = sample.image;
+        sf.processFrame(input, result);
+
+        error += abs(result.getLastSquareCount() - sample.sampleData.at("N_SQUARES"));
+        error += abs(result.getLastCircleCount() - sample.sampleData.at("N_CIRCLES"));
+        error += abs(result.getLastRectangleCount() - sample.sampleData.at("N_RECTANGLES"));
+        error += abs(result.getLastTriangleCount() - sample.sampleData.at("N_TRIANGLES"));
     }
 
     return error;
@@ -185,6 +188,11 @@ int main(int argc, char **argv) {
         } else if (keyPress == 108) {                       // Load tuning samples
             *TUNING_SAMPLES = mg.load(&fromString);
             cout << "Finished loading saved tuning samples!" << endl;
+        } else if (keyPress == 112) {                       // Pack saved tuning samples into one file
+            if (mg.pack(&fromString))
+                cout << "Packed tuning samples into " << mg.getPackedPath() << endl;
+            else
+                cout << "Could not pack the tuning samples" << endl;
         } else if (keyPress >= 65 && keyPress <= 122) {     // Exit
             cout << "Received kill command. Exiting" << endl;
             break;
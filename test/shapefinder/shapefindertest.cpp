@@ -0,0 +1,176 @@
+#include <opencv2/opencv.hpp>
+#include <robosub/robosub.h>
+#include <robosub/image-processing/shape_recognition.h>
+
+using namespace std;
+using namespace robosub;
+
+static void addTimings(ShapeFinder::Timings &sum, const ShapeFinder::Timings &t) {
+    sum.convert += t.convert;
+    sum.blur += t.blur;
+    sum.edges += t.edges;
+    sum.morphology += t.morphology;
+    sum.contours += t.contours;
+    sum.classify += t.classify;
+    sum.total += t.total;
+}
+
+static void printTimings(const String &name, const ShapeFinder::Timings &t, int frames) {
+    double n = (double) max(frames, 1) * 1000.0;
+    cout << name << " (ms/frame): convert " << Util::toStringWithPrecision(t.convert / n)
+         << ", blur " << Util::toStringWithPrecision(t.blur / n)
+         << ", edges " << Util::toStringWithPrecision(t.edges / n)
+         << ", morphology " << Util::toStringWithPrecision(t.morphology / n)
+         << ", contours " << Util::toStringWithPrecision(t.contours / n)
+         << ", classify " << Util::toStringWithPrecision(t.classify / n)
+         << ", total " << Util::toStringWithPrecision(t.total / n) << endl;
+}
+
+static bool sameShapes(const vector<vector<Point>> &a, const vector<vector<Point>> &b) {
+    if (a.size() != b.size()) return false;
+    for (size_t i = 0; i < a.size(); i++) {
+        if (a[i].size() != b[i].size()) return false;
+        for (size_t j = 0; j < a[i].size(); j++) {
+            if (a[i][j] != b[i][j]) return false;
+        }
+    }
+    return true;
+}
+
+static bool sameResults(ShapeFindResult &a, ShapeFindResult &b) {
+    return sameShapes(a.triangles, b.triangles) && sameShapes(a.squares, b.squares) &&
+           sameShapes(a.rectangles, b.rectangles) && sameShapes(a.circles, b.circles) &&
+           a.getLastSquareCount() == b.getLastSquareCount() &&
+           ShapeFindResult::getCountMode(a.squareCounts) == ShapeFindResult::getCountMode(b.squareCounts);
+}
+
+//processes frames of several synthetic cameras one by one and as batches on a thread pool,
+//checks that both find identical shapes and prints the throughput of each
+//A second batch is driven from a task of another pool, as a pipeline stage would do.
+static int runBatch(const SyntheticFrameSource::Settings &settings, int cameras, int frames) {
+    vector<SyntheticFrameSource *> sources;
+    for (int c = 0; c < cameras; c++) {
+        SyntheticFrameSource::Settings cameraSettings = settings;
+        cameraSettings.seed = settings.seed + (unsigned long long) c;
+        sources.push_back(new SyntheticFrameSource(cameraSettings));
+    }
+
+    Camera::CalibrationData calibration(settings.frameSize, Camera::CalibrationData::PINHOLE);
+    vector<ShapeFinder *> serialFinders;
+    vector<ShapeFindResult> serialResults((size_t) cameras);
+    for (int c = 0; c < cameras; c++) serialFinders.push_back(new ShapeFinder(calibration));
+    ShapeFinderBatch batch(ShapeFinder(calibration), 0);
+    ShapeFinderBatch nestedBatch(ShapeFinder(calibration), 0);
+    ThreadPool caller(2);
+
+    //processing replaces each job's frame with its grayscale version, so every batch gets its own jobs
+    vector<ShapeFindJob> jobs((size_t) cameras), nestedJobs((size_t) cameras);
+    vector<ShapeFindBatchResult> batchResults, nestedResults;
+    vector<Mat> serialInputs((size_t) cameras);
+    long long serialMicros = 0, batchMicros = 0;
+    int mismatches = 0, processed = 0;
+    Mat frame;
+
+    for (int i = 0; i < frames; i++) {
+        for (int c = 0; c < cameras; c++) {
+            if (!sources[c]->grab() || !sources[c]->retrieve(frame)) break;
+            frame.copyTo(serialInputs[c]);
+            jobs[c].sourceId = c;
+            jobs[c].timestamp = robosub::Time::micros();
+            frame.copyTo(jobs[c].frame);
+            nestedJobs[c].sourceId = c;
+            nestedJobs[c].timestamp = jobs[c].timestamp;
+            frame.copyTo(nestedJobs[c].frame);
+        }
+
+        Stopwatch stopwatch;
+        for (int c = 0; c < cameras; c++) serialFinders[c]->processFrame(serialInputs[c], serialResults[c]);
+        serialMicros += stopwatch.elapsedMicros();
+
+        stopwatch.reset();
+        batch.process(jobs, batchResults);
+        batchMicros += stopwatch.elapsedMicros();
+        caller.submit([&]() { nestedBatch.process(nestedJobs, nestedResults); }).get();
+        processed += cameras;
+
+        for (int c = 0; c < cameras; c++) {
+            if (!sameResults(serialResults[c], batchResults[c].result)) {
+                cout << "Frame " << i << ", camera " << c << ": serial and batch results differ" << endl;
+                mismatches++;
+            } else if (!sameResults(serialResults[c], nestedResults[c].result)) {
+                cout << "Frame " << i << ", camera " << c << ": batch run from another pool differs" << endl;
+                mismatches++;
+            }
+        }
+    }
+
+    cout << "serial: " << Util::toStringWithPrecision(processed * 1e6 / max(serialMicros, 1LL)) << " frames/s" << endl;
+    cout << "batch:  " << Util::toStringWithPrecision(processed * 1e6 / max(batchMicros, 1LL)) << " frames/s" << endl;
+    cout << mismatches << " of " << processed << " frames differ" << endl;
+
+    for (SyntheticFrameSource *source : sources) delete source;
+    for (ShapeFinder *finder : serialFinders) delete finder;
+    return mismatches == 0 ? 0 : 1;
+}
+
+//runs synthetic frames through the tiled and the full-frame ShapeFinder paths,
+//checks that they find identical shapes and prints the per-stage timings of both
+int main(int argc, char **argv) {
+    const String keys =
+            "{help ?   |      | print this message                    }"
+            "{n frames | 60   | number of frames to process           }"
+            "{w width  | 1280 | frame width                           }"
+            "{h height | 720  | frame height                          }"
+            "{b batch  | 0    | compare serial and batched processing of this many cameras }";
+
+    CommandLineParser parser(argc, argv, keys);
+    parser.about("Shape Finder Test");
+
+    if (parser.has("help")) {
+        parser.printMessage();
+        return 0;
+    }
+
+    SyntheticFrameSource::Settings settings;
+    settings.frameSize = Size(parser.get<int>("width"), parser.get<int>("height"));
+    if (parser.get<int>("batch") > 0) {
+        return runBatch(settings, parser.get<int>("batch"), parser.get<int>("frames"));
+    }
+
+    SyntheticFrameSource source(settings);
+
+    Camera::CalibrationData calibration(settings.frameSize, Camera::CalibrationData::PINHOLE);
+    ShapeFinder tiled(calibration);
+    ShapeFinder legacy(calibration);
+    legacy.TILED_PREPROCESSING = false;
+
+    ShapeFindResult tiledResult, legacyResult;
+    ShapeFinder::Timings tiledTimings, legacyTimings;
+    int frames = parser.get<int>("frames");
+    int mismatches = 0;
+    Mat frame, tiledInput, legacyInput;
+
+    for (int i = 0; i < frames; i++) {
+        if (!source.grab() || !source.retrieve(frame)) break;
+        frame.copyTo(tiledInput);
+        frame.copyTo(legacyInput);
+
+        tiled.processFrame(tiledInput, tiledResult);
+        legacy.processFrame(legacyInput, legacyResult);
+        addTimings(tiledTimings, tiled.getTimings());
+        addTimings(legacyTimings, legacy.getTimings());
+
+        if (!sameShapes(tiledResult.triangles, legacyResult.triangles) ||
+            !sameShapes(tiledResult.squares, legacyResult.squares) ||
+            !sameShapes(tiledResult.rectangles, legacyResult.rectangles) ||
+            !sameShapes(tiledResult.circles, legacyResult.circles)) {
+            cout << "Frame " << i << ": tiled and full-frame results differ" << endl;
+            mismatches++;
+        }
+    }
+
+    printTimings("tiled", tiledTimings, frames);
+    printTimings("full-frame", legacyTimings, frames);
+    cout << mismatches << " of " << frames << " frames differ" << endl;
+    return mismatches == 0 ? 0 : 1;
+}
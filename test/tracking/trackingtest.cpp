@@ -0,0 +1,102 @@
+#include <opencv2/opencv.hpp>
+#include <robosub/robosub.h>
+
+using namespace std;
+using namespace robosub;
+
+//tracks the drifting shapes of a synthetic stream, comparing the cost of running ShapeFinder on every frame
+//with ShapeTracker, which runs it on the whole frame only when the tracks need a new detection and
+//searches around the predicted shapes otherwise
+int main(int argc, char **argv) {
+    const String keys =
+            "{help ?     |      | print this message                              }"
+            "{n frames   | 300  | number of frames to process                     }"
+            "{k interval | 5    | frames between full detections                  }"
+            "{s show     |      | display the tracks                              }";
+
+    CommandLineParser parser(argc, argv, keys);
+    parser.about("Shape Tracking Test");
+
+    if (parser.has("help")) {
+        parser.printMessage();
+        return 0;
+    }
+
+    SyntheticFrameSource::Settings settings;
+    SyntheticFrameSource source(settings);
+    Camera::CalibrationData calibration(settings.frameSize, Camera::CalibrationData::PINHOLE);
+    ShapeFinder everyFrame(calibration), tracked(calibration);
+
+    ObjectTracker::Settings trackerSettings;
+    trackerSettings.detectionInterval = parser.get<int>("interval");
+    ShapeTracker tracker(tracked, trackerSettings);
+
+    ShapeFindResult fullResult, trackedResult;
+    Mat frame, fullInput, trackedInput;
+    long long fullMicros = 0, trackedMicros = 0, regionMicros = 0;
+    int frames = parser.get<int>("frames"), detections = 0, maxId = 0, processed = 0;
+    //shapes the full frame finds inside the searched regions, and how many of those the region search found
+    int expectedInRegions = 0, foundInRegions = 0;
+
+    for (int i = 0; i < frames; i++) {
+        if (!source.grab() || !source.retrieve(frame)) break;
+        frame.copyTo(fullInput);
+        frame.copyTo(trackedInput);
+
+        Stopwatch stopwatch;
+        everyFrame.processFrame(fullInput, fullResult);
+        fullMicros += stopwatch.elapsedMicros();
+
+        vector<Rect> regions = tracker.getTracker().getSearchRegions(tracker.SEARCH_PADDING, frame.size());
+        stopwatch.reset();
+        tracker.processFrame(trackedInput, trackedResult);
+        long long micros = stopwatch.elapsedMicros();
+        trackedMicros += micros;
+        if (tracker.ranDetection()) {
+            detections++;
+        } else {
+            regionMicros += micros;
+            //regions are taken before processFrame() predicts, so only count shapes well inside them
+            for (const ObjectTracker::Detection &d : ShapeTracker::toDetections(fullResult)) {
+                for (const Rect &r : regions) {
+                    Rect inner(r.x + 8, r.y + 8, r.width - 16, r.height - 16);
+                    if (inner.width <= 0 || inner.height <= 0 || (d.bounds & inner) != d.bounds) continue;
+                    expectedInRegions++;
+                    for (const ObjectTracker::Detection &t : ShapeTracker::toDetections(trackedResult)) {
+                        if (ObjectTracker::intersectionOverUnion(d.bounds, t.bounds) > 0.5) {
+                            foundInRegions++;
+                            break;
+                        }
+                    }
+                    break;
+                }
+            }
+        }
+        processed++;
+
+        for (const ObjectTracker::Track &track : tracker.getTracks()) maxId = max(maxId, track.id);
+
+        if (parser.has("show")) {
+            for (const ObjectTracker::Track &track : tracker.getTracks()) {
+                cv::rectangle(frame, track.bounds, Scalar(0, 255, 0), 2);
+                Drawing::text(frame, to_string(track.id), track.bounds.tl(), Scalar(0, 255, 0), Drawing::TOP_LEFT,
+                              0.6);
+            }
+            imshow("Tracks", frame);
+            if (waitKey(1) == 27) break;
+        }
+    }
+
+    cout << "every frame: " << Util::toStringWithPrecision(fullMicros / 1000.0 / max(processed, 1)) << " ms/frame"
+         << endl;
+    cout << "tracked:     " << Util::toStringWithPrecision(trackedMicros / 1000.0 / max(processed, 1))
+         << " ms/frame, full detection on " << detections << " of " << processed << " frames" << endl;
+    int searches = processed - detections;
+    cout << "region search: " << Util::toStringWithPrecision(regionMicros / 1000.0 / max(searches, 1))
+         << " ms/frame, found " << foundInRegions << " of " << expectedInRegions << " shapes" << endl;
+    cout << maxId << " track ids for " << settings.shapeCount << " shapes" << endl;
+
+    //the point of tracking is to skip most full detections at steady state, without losing what they find
+    bool regionsAgree = foundInRegions * 10 >= expectedInRegions * 9;
+    return detections * 2 < processed && regionsAgree ? 0 : 1;
+}
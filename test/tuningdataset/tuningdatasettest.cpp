@@ -0,0 +1,79 @@
+#include <opencv2/opencv.hpp>
+#include <robosub/robosub.h>
+
+using namespace std;
+using namespace robosub;
+
+static string intToString(int value) {
+    return to_string(value);
+}
+
+static int intFromString(string value) {
+    return stoi(value);
+}
+
+//saves synthetic tuning samples in the directory layout, packs them into one file, and compares how long
+//TuningSampleManager takes to load each; the packed samples must match the ones decoded from the directories
+int main(int argc, char **argv) {
+    const String keys =
+            "{help ?      |                  | print this message                              }"
+            "{n samples   | 50               | synthetic frames in the sample set              }"
+            "{d directory | tuning-dataset/  | where the samples are saved                     }";
+
+    CommandLineParser parser(argc, argv, keys);
+    parser.about("Tuning Dataset Test");
+
+    if (parser.has("help")) {
+        parser.printMessage();
+        return 0;
+    }
+
+    string directory = parser.get<String>("directory");
+    mkdir(directory.c_str(), S_IRWXU | S_IRWXG | S_IROTH | S_IXOTH);
+
+    SyntheticFrameSource::Settings settings;
+    SyntheticFrameSource source(settings);
+    vector<TuningSample<int>> captured(parser.get<int>("samples"));
+    for (TuningSample<int> &sample : captured) {
+        source.grab();
+        source.retrieve(sample.image);
+        sample.sampleData["N_TRIANGLES"] = source.countShapes(SyntheticFrameSource::TRIANGLE);
+        sample.sampleData["N_SQUARES"] = source.countShapes(SyntheticFrameSource::SQUARE);
+        sample.sampleData["N_RECTANGLES"] = source.countShapes(SyntheticFrameSource::RECTANGLE);
+        sample.sampleData["N_CIRCLES"] = source.countShapes(SyntheticFrameSource::CIRCLE);
+    }
+
+    TuningSampleManager<int> manager(directory);
+    if (!manager.save(captured.data(), (int) captured.size(), &intToString)) {
+        cout << "Could not save the samples to " << directory << endl;
+        return 1;
+    }
+
+    Stopwatch stopwatch;
+    vector<TuningSample<int>> fromDirectories = manager.load(&intFromString);
+    long long directoryMicros = stopwatch.elapsedMicros();
+
+    if (!manager.pack(&intFromString)) {
+        cout << "Could not pack the samples" << endl;
+        return 1;
+    }
+
+    stopwatch.reset();
+    vector<TuningSample<int>> fromPacked = manager.load(&intFromString);
+    long long packedMicros = stopwatch.elapsedMicros();
+
+    bool same = fromPacked.size() == fromDirectories.size() && fromPacked.size() == captured.size();
+    for (size_t i = 0; same && i < fromPacked.size(); i++) {
+        same = fromPacked[i].dataset && fromPacked[i].sampleData == captured[i].sampleData &&
+               fromPacked[i].image.size() == fromDirectories[i].image.size() &&
+               fromPacked[i].image.type() == fromDirectories[i].image.type() &&
+               cv::norm(fromPacked[i].image, fromDirectories[i].image, NORM_INF) == 0;
+    }
+
+    cout << fromDirectories.size() << " samples: directories " << Util::toStringWithPrecision(directoryMicros / 1000.0)
+         << " ms, packed " << Util::toStringWithPrecision(packedMicros / 1000.0) << " ms ("
+         << manager.getPackedPath() << ")" << endl;
+    cout << (same ? "packed samples match" : "packed samples differ") << endl;
+
+    return same && packedMicros < directoryMicros ? 0 : 1;
+}
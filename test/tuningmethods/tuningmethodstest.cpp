@@ -0,0 +1,95 @@
+#include <opencv2/opencv.hpp>
+#include <robosub/robosub.h>
+
+using namespace std;
+using namespace robosub;
+
+struct LabeledFrame {
+    Mat image;
+    int counts[4];
+};
+
+static vector<LabeledFrame> samples;
+static Camera::CalibrationData calibration;
+
+//error of a parameter set on one sample; a finder and result per call, so it can run on several threads
+static double sampleError(const ParameterSet &parameters, int index) {
+    ShapeFinder finder(calibration);
+    finder.MIN_AREA = parameters.at("MIN_AREA");
+    finder.SQUARE_RATIO_THRESHOLD = parameters.at("SQUARE_RATIO_THRESHOLD");
+    finder.TRIANGLE_RATIO_THRESHOLD = parameters.at("TRIANGLE_RATIO_THRESHOLD");
+    finder.IMAGE_BLACK_THRESHOLD = parameters.at("IMAGE_BLACK_THRESHOLD");
+
+    const LabeledFrame &sample = samples[index];
+    ShapeFindResult result;
+    Mat input = sample.image;
+    finder.processFrame(input, result);
+    return abs((int) result.triangles.size() - sample.counts[SyntheticFrameSource::TRIANGLE]) +
+           abs((int) result.squares.size() - sample.counts[SyntheticFrameSource::SQUARE]) +
+           abs((int) result.rectangles.size() - sample.counts[SyntheticFrameSource::RECTANGLE]) +
+           abs((int) result.circles.size() - sample.counts[SyntheticFrameSource::CIRCLE]);
+}
+
+//tunes ShapeFinder parameters against synthetic frames with every tuning method, comparing the final error with
+//the evaluations it took, and writes the convergence trace of each method to <prefix><method>.csv
+int main(int argc, char **argv) {
+    const String keys =
+            "{help ?    |         | print this message                              }"
+            "{n samples | 9       | synthetic frames in the sample set              }"
+            "{b budget  | 100     | evaluations CMA-ES may spend                    }"
+            "{o output  | tuning- | prefix of the trace files                       }";
+
+    CommandLineParser parser(argc, argv, keys);
+    parser.about("Tuning Methods Test");
+
+    if (parser.has("help")) {
+        parser.printMessage();
+        return 0;
+    }
+
+    SyntheticFrameSource::Settings settings;
+    settings.frameSize = Size(640, 360);
+    settings.shapeCount = 8;
+    SyntheticFrameSource source(settings);
+    calibration = Camera::CalibrationData(settings.frameSize, Camera::CalibrationData::PINHOLE);
+    for (int i = 0; i < parser.get<int>("samples"); i++) {
+        LabeledFrame sample;
+        source.grab();
+        source.retrieve(sample.image);
+        for (int type = SyntheticFrameSource::TRIANGLE; type <= SyntheticFrameSource::CIRCLE; type++) {
+            sample.counts[type] = source.countShapes((SyntheticFrameSource::ShapeType) type);
+        }
+        samples.push_back(sample);
+    }
+
+    ShapeFinder defaults(calibration);
+    map<string, ParameterMetadata> parameters = {
+            {"MIN_AREA",                 ParameterMetadata(defaults.MIN_AREA, 0, 100)},
+            {"SQUARE_RATIO_THRESHOLD",   ParameterMetadata(defaults.SQUARE_RATIO_THRESHOLD, 0, 1)},
+            {"TRIANGLE_RATIO_THRESHOLD", ParameterMetadata(defaults.TRIANGLE_RATIO_THRESHOLD, 0, 1)},
+            {"IMAGE_BLACK_THRESHOLD",    ParameterMetadata(defaults.IMAGE_BLACK_THRESHOLD, 0, 300)}
+    };
+
+    const TuningMethods methods[] = {GENETIC_ALGORITHM, CMA_ES, SUCCESSIVE_HALVING};
+    const string names[] = {"genetic", "cmaes", "halving"};
+    double errors[3], costs[3];
+
+    ParameterTuner tuner;
+    tuner.setEvaluationBudget(parser.get<double>("budget"));
+    for (int m = 0; m < 3; m++) {
+        Stopwatch stopwatch;
+        tuner.tuneOnSamples(parameters, sampleError, (int) samples.size(), methods[m]);
+        long long micros = stopwatch.elapsedMicros();
+        errors[m] = tuner.getBestError();
+        costs[m] = tuner.getEvaluationCost();
+        tuner.writeTrace(parser.get<String>("output") + names[m] + ".csv");
+
+        cout << names[m] << ": error " << errors[m] << " after " << Util::toStringWithPrecision(costs[m])
+             << " evaluations (" << Util::toStringWithPrecision(micros / 1e6) << " s)" << endl;
+    }
+
+    //the point of the other methods is to match the genetic algorithm at a fraction of its evaluations
+    bool cheaper = costs[1] < costs[0] && costs[2] < costs[0];
+    bool asGood = errors[1] <= errors[0] && errors[2] <= errors[0];
+    return cheaper && asGood ? 0 : 1;
+}
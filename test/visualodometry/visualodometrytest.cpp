@@ -0,0 +1,99 @@
+#include <opencv2/opencv.hpp>
+#include <robosub/robosub.h>
+
+using namespace std;
+using namespace robosub;
+
+//flies a camera over a large random texture with known motion and compares VisualOdometry's estimates with it,
+//and reports the time every frame took against the budget
+int main(int argc, char **argv) {
+    const String keys =
+            "{help ?   |      | print this message                              }"
+            "{n frames | 300  | number of frames to process                     }"
+            "{b budget | 4    | CPU budget per frame in milliseconds            }"
+            "{s show   |      | display the tracked frames                      }";
+
+    CommandLineParser parser(argc, argv, keys);
+    parser.about("Visual Odometry Test");
+
+    if (parser.has("help")) {
+        parser.printMessage();
+        return 0;
+    }
+
+    Mat texture(2400, 2400, CV_8UC3);
+    randu(texture, Scalar::all(0), Scalar::all(256));
+    GaussianBlur(texture, texture, Size(), 2);
+
+    VisualOdometry::Settings settings;
+    settings.budgetMillis = parser.get<double>("budget");
+    VisualOdometry odometry(settings);
+
+    const Size frameSize(640, 480);
+    const Point2d center(frameSize.width / 2.0, frameSize.height / 2.0);
+    Point2d position(texture.cols / 2.0, texture.rows / 2.0);
+    double heading = 0;
+    Point2d step;
+    double turn = 0;
+
+    Mat frame;
+    int frames = parser.get<int>("frames"), estimates = 0, processed = 0;
+    double translationError = 0, maxTranslationError = 0, yawError = 0;
+    long long totalMicros = 0, maxMicros = 0;
+    for (int i = 0; i < frames; i++) {
+        //camera pose: frame pixel p shows texture pixel position + R(heading) (p - center)
+        double c = cos(heading), s = sin(heading);
+        Mat pose = (Mat_<double>(2, 3) << c, -s, position.x - (c * center.x - s * center.y),
+                s, c, position.y - (s * center.x + c * center.y));
+        warpAffine(texture, frame, pose, frameSize, INTER_LINEAR | WARP_INVERSE_MAP);
+
+        VisualOdometry::Motion motion = odometry.process(frame, i * 33333ll);
+        if (i > 0) {
+            processed++;
+            if (motion.valid) {
+                estimates++;
+                double error = cv::norm(motion.translation - step);
+                translationError += error;
+                maxTranslationError = max(maxTranslationError, error);
+                yawError += abs(motion.yaw - turn);
+            }
+        }
+        //the first frames settle the corner count to the budget
+        if (i >= 10) {
+            totalMicros += motion.processingMicros;
+            maxMicros = max(maxMicros, motion.processingMicros);
+        }
+
+        if (parser.has("show")) {
+            Drawing::text(frame, Util::toStringWithPrecision(motion.translation.x) + ", " +
+                                 Util::toStringWithPrecision(motion.translation.y) + " px, " +
+                                 Util::toStringWithPrecision(motion.yaw * 180 / CV_PI) + " deg",
+                          Point(10, 10), Scalar(0, 255, 0), Drawing::TOP_LEFT, 0.6);
+            imshow("Visual Odometry", frame);
+            if (waitKey(1) == 27) break;
+        }
+
+        //move in the camera's own axes, as the vehicle would
+        step = Point2d(3 + 2 * sin(i / 20.0), 1.5 * cos(i / 15.0));
+        turn = 0.01 * sin(i / 25.0);
+        position += Point2d(c * step.x - s * step.y, s * step.x + c * step.y);
+        heading += turn;
+    }
+
+    int timed = max(frames - 10, 1);
+    double meanError = translationError / max(estimates, 1);
+    double meanYawError = yawError / max(estimates, 1);
+    double meanMillis = totalMicros / 1000.0 / timed;
+    cout << estimates << " of " << processed << " frames estimated" << endl;
+    cout << "translation error: " << Util::toStringWithPrecision(meanError, 3) << " px mean, "
+         << Util::toStringWithPrecision(maxTranslationError, 3) << " px max" << endl;
+    cout << "yaw error: " << Util::toStringWithPrecision(meanYawError * 180 / CV_PI, 4) << " deg mean" << endl;
+    cout << "time: " << Util::toStringWithPrecision(meanMillis) << " ms mean, "
+         << Util::toStringWithPrecision(maxMicros / 1000.0) << " ms max, budget " << settings.budgetMillis
+         << " ms (" << odometry.getFeatureLimit() << " corners, " << odometry.getLevelOffset()
+         << " levels down)" << endl;
+
+    //the time depends on the machine and its load, so it is only reported
+    bool accurate = estimates == processed && meanError < 0.5 && meanYawError < 0.005;
+    return accurate ? 0 : 1;
+}
@@ -10,9 +10,16 @@
 extern bool running;
 extern bool refresh;
 extern mutex drawLock;
-extern VideoWriter videoFiles[];
+extern robosub::Recorder recorder;
+extern int recordStreams[];
 
 const int NUMFEEDS = 2;
 const int PORT[5] = {8500, 8501, 8502, 8503, 8504};
 const String VIDEO_ADDR = "127.0.0.1";
+//frames buffered per feed while the recording is flushed to disk
+const int RECORD_QUEUE_LENGTH = 30;
+//milliseconds between frame rate reports sent back to the robot
+const int FEEDBACK_INTERVAL = 1000;
+//remove the underwater color cast from the displayed feeds; recordings are never corrected
+const bool COLOR_CORRECTION = true;
 extern String FILE_PREFIX;
\ No newline at end of file
@@ -11,7 +11,8 @@ void video();
 bool running = true;
 bool refresh = false;
 mutex drawLock;
-VideoWriter videoFiles[8];
+robosub::Recorder recorder;
+int recordStreams[8] = {-1, -1, -1, -1, -1, -1, -1, -1};
 
 String FILE_PREFIX;
 
@@ -30,6 +31,8 @@ int main(int argc, char *argv[]) {
     }
     FILE_PREFIX = parser.get<String>("p") + "/";
     cout << FILE_PREFIX << endl;
+    //frame buffers are reused instead of reallocated for every received frame
+    robosub::MatPool::shared().install();
     video();
 
     return 0;
@@ -4,33 +4,89 @@ using namespace std;
 using namespace robosub;
 
 const int VERIFICATION_CODE = 1234567890;
+//leads the feedback message that lets the robot adapt the stream to the link
+const int FEEDBACK_CODE = 1234567891;
 const String ADDR = VIDEO_ADDR;
 
 const int TIMEOUT_LIMIT = 50;
 
+//status labels, color correction and corrected display buffer of each feed, guarded by drawLock
+HudOverlay hud[NUMFEEDS];
+ColorCorrector colorCorrection[NUMFEEDS];
+Mat correctedFrame[NUMFEEDS];
+const int HUD_FPS = 0;
+const int HUD_BITRATE = 1;
+
 
 void catchSignal(int signal) {
     running = false;
 }
 
+void openRecording(int index) {
+    if (recordStreams[index] >= 0) return;
+
+    Recorder::StreamConfig config;
+    config.path = FILE_PREFIX + String(Util::toStringWithPrecision(PORT[index])) + "video.rsfl";
+    //frame logs keep the real frame size and arrival times, and replay with FrameLogFrameSource
+    config.format = Recorder::JPEG;
+    config.logStreamId = PORT[index];
+    config.queueLength = RECORD_QUEUE_LENGTH;
+    config.dropPolicy = Recorder::DROP_OLDEST;
+    recordStreams[index] = recorder.addStream(config);
+    cout << "Created video file " << config.path << endl;
+}
+
+void saveRecordings() {
+    //flushes every queued frame before closing the files
+    recorder.stop();
+    for (int i = 0; i < NUMFEEDS; i++) {
+        if (recordStreams[i] < 0) continue;
+        Recorder::Stats stats = recorder.getStats(recordStreams[i]);
+        cout << PORT[i] << " Saved file: " << stats.written << " frames written, " << stats.dropped
+             << " dropped, max queue depth " << stats.maxQueueDepth << endl;
+    }
+}
+
 void drawFrame(int rows, int cols, char *framedata, float framesPerSecond, float bitsPerSecond, int port, int index) {
-    drawLock.lock();
     Mat frame = Mat(rows, cols, CV_8UC3, framedata);
+    //recordings keep the camera's own pixels; the frame is copied into the recorder queue and the
+    //disk write happens on the recorder's thread
+    recorder.record(recordStreams[index], frame);
 
-    Drawing::text(frame,
-                  String(Util::toStringWithPrecision(framesPerSecond)) + String(" fps"),
-                  Point(16, 48), Scalar(255, 255, 255), Drawing::Anchor::BOTTOM_LEFT, 0.5
-    );
-    Drawing::text(frame,
-                  String(Util::toStringWithPrecision((bitsPerSecond) / 1024.0f / 1024.0f) + String(" Mbps")),
-                  Point(16, 16), Scalar(255, 255, 255), Drawing::Anchor::BOTTOM_LEFT, 0.5
-    );
+    drawLock.lock();
+    //only the displayed copy is corrected and labelled
+    Mat display = frame;
+    if (COLOR_CORRECTION) {
+        colorCorrection[index].apply(frame, correctedFrame[index]);
+        display = correctedFrame[index];
+    }
 
-    imshow(String("Port ") + String(Util::toStringWithPrecision(port, 0)), frame);
-    videoFiles[index].write(frame);
+    //labels are rasterized once per new value and blended in place
+    HudOverlay &overlay = hud[index];
+    if (overlay.getLabelCount() == 0) {
+        HudOverlay::Style style;
+        style.thickness = 2;
+        overlay.addLabel(Point(16, 48), Drawing::Anchor::BOTTOM_LEFT, style);
+        overlay.addLabel(Point(16, 16), Drawing::Anchor::BOTTOM_LEFT, style);
+    }
+    overlay.setText(HUD_FPS, String(Util::toStringWithPrecision(framesPerSecond)) + String(" fps"));
+    overlay.setText(HUD_BITRATE,
+                    String(Util::toStringWithPrecision((bitsPerSecond) / 1024.0f / 1024.0f) + String(" Mbps")));
+    overlay.draw(display);
+
+    imshow(String("Port ") + String(Util::toStringWithPrecision(port, 0)), display);
     drawLock.unlock();
 }
 
+void sendFeedback(NetworkTcpClient &client, float framesPerSecond) {
+    char feedback[16];
+    *(int *) (feedback + 0) = FEEDBACK_CODE;
+    *(int *) (feedback + 4) = (int) (framesPerSecond * 1000.0f);
+    *(int *) (feedback + 8) = 0;
+    *(int *) (feedback + 12) = 0;
+    client.sendBuffer(feedback, sizeof(feedback));
+}
+
 void drawError(int rows, int cols, int port) {
     drawLock.lock();
 
@@ -66,9 +122,11 @@ void cameraThread(int port, int index) {
         } else {
             cout << "Connected." << endl;
 
+            //received frames land in one buffer that is only reallocated when the frame size changes
+            Mat frameBuffer;
             char *framedata = nullptr;
 
-            char *headerdata = (char *) malloc(16);
+            char headerdata[16];
 
             int waitingOnRestOfFrame = 0;
             int framedatalen = 0;
@@ -76,6 +134,7 @@ void cameraThread(int port, int index) {
 
             int previousDataRemaining = 0;
             int timeoutCounter = 0;
+            Stopwatch feedbackTimer;
             while (running) {
                 if (waitingOnRestOfFrame == 0) {
                     int headerlen = -1;
@@ -100,11 +159,8 @@ void cameraThread(int port, int index) {
 
                             framedatalen = rows * cols * 3;
 
-                            if (framedata != nullptr) {
-                                free(framedata);
-                            }
-
-                            framedata = (char *) malloc(framedatalen);
+                            frameBuffer.create(rows, cols, CV_8UC3);
+                            framedata = (char *) frameBuffer.data;
 
                             int recvdatalen = -1;
                             ecode = client.receiveBuffer(framedata, framedatalen, recvdatalen);
@@ -118,23 +174,11 @@ void cameraThread(int port, int index) {
 //                                cout<<"waiting on 2 "<<waitingOnRestOfFrame<<endl;
 
                                 if (waitingOnRestOfFrame == 0) {
-                                    if (!videoFiles[index].isOpened()) {
-                                        cout << rows << " " << cols;
-
-                                        videoFiles[index] = VideoWriter(
-                                                FILE_PREFIX + String(Util::toStringWithPrecision(PORT[index])) +
-                                                "video.avi", cv::VideoWriter::fourcc('M', 'J', 'P', 'G'), 10,
-                                                Size(1280, 720));
-                                        cout << "Created video file" << videoFiles[index].isOpened() << endl;
-                                    }
+                                    openRecording(index);
                                     drawFrame(rows, cols, framedata, framesPerSecond, bitsPerSecond, port, index);
                                     char c = (char) waitKey(1);
                                     if (c == 's') {
-                                        for (int i = 0; i < NUMFEEDS; i++) {
-                                            while (videoFiles[i].isOpened())
-                                                videoFiles[i].release();
-                                            cout << PORT[i] << "Saved file" << videoFiles[i].isOpened() << endl;
-                                        }
+                                        saveRecordings();
                                         running = false;
                                     }
 
@@ -166,23 +210,11 @@ void cameraThread(int port, int index) {
                         }
                         previousDataRemaining = waitingOnRestOfFrame;
                         if (waitingOnRestOfFrame == 0) {
-                            if (!videoFiles[index].isOpened()) {
-                                cout << rows << " " << cols;
-
-                                videoFiles[index] = VideoWriter(
-                                        FILE_PREFIX + String(Util::toStringWithPrecision(PORT[index])) + "video.avi",
-                                        cv::VideoWriter::fourcc('M', 'J', 'P', 'G'), 10, Size(1280, 720));
-                                cout << "Created video file" << videoFiles[index].isOpened() << endl;
-                            }
-
+                            openRecording(index);
                             drawFrame(rows, cols, framedata, framesPerSecond, bitsPerSecond, port, index);
                             char c = (char) waitKey(1);
                             if (c == 's') {
-                                for (int i = 0; i < NUMFEEDS; i++) {
-                                    while (videoFiles[i].isOpened())
-                                        videoFiles[i].release();
-                                    cout << PORT[i] << "Saved file" << videoFiles[i].isOpened() << endl;
-                                }
+                                saveRecordings();
                                 running = false;
                             }
                         }
@@ -190,6 +222,11 @@ void cameraThread(int port, int index) {
                     }
                 }
 
+                if (feedbackTimer.elapsed() >= FEEDBACK_INTERVAL) {
+                    sendFeedback(client, framesPerSecond);
+                    feedbackTimer.reset();
+                }
+
                 robosub::Time::waitMillis(1);
             }
         }